@@ -1,18 +1,20 @@
 #include "appimage_icon.hpp"
-#include "appimage_icon_paths.hpp"
+#include <application/appimage_metadata.hpp>
 #include <application/extract_icon.hpp>
 #include <application/generate_desktop.hpp>
+#include <application/squashfs_image.hpp>
+#include <infrastructure/persistence/atomic_file.hpp>
 #include <QProcess>
 #include <QStandardPaths>
 #include <QTemporaryDir>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
-#include <algorithm>
-#include <array>
-#include <cctype>
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -20,22 +22,7 @@ namespace appimage_manager::daemon {
 
 namespace {
 
-bool looks_like_image(const fs::path& p) {
-  std::ifstream f(p, std::ios::binary);
-  if (!f)
-    return false;
-  std::array<std::uint8_t, 8> buf{};
-  if (!f.read(reinterpret_cast<char*>(buf.data()), buf.size()))
-    return false;
-  if (buf[0] == 0x89 && buf[1] == 0x50 && buf[2] == 0x4E && buf[3] == 0x47)
-    return true;
-  if (buf[0] == '<' && (buf[1] == '?' || buf[1] == 's') &&
-      (buf[2] == 'x' || buf[2] == 'v') && (buf[3] == 'm' || buf[3] == 'g'))
-    return true;
-  if (buf[0] == '<' && buf[1] == 's' && buf[2] == 'v' && buf[3] == 'g')
-    return true;
-  return false;
-}
+constexpr int max_symlink_hops = 8;
 
 QString unsquashfs_path() {
   QString p = QStandardPaths::findExecutable(QStringLiteral("unsquashfs"));
@@ -44,192 +31,161 @@ QString unsquashfs_path() {
   return QStringLiteral("/usr/bin/unsquashfs");
 }
 
+std::optional<std::string> read_extracted(const fs::path& root, const std::string& rel_path) {
+  fs::path p = root / rel_path;
+  for (int hops = 0; fs::is_symlink(p) && hops < max_symlink_hops; ++hops) {
+    fs::path target = fs::read_symlink(p);
+    p = target.is_absolute() ? root / target.relative_path() : p.parent_path() / target;
+  }
+  if (!fs::is_regular_file(p))
+    return std::nullopt;
+  std::ifstream in(p, std::ios::binary);
+  if (!in)
+    return std::nullopt;
+  std::ostringstream content;
+  content << in.rdbuf();
+  return content.str();
 }
 
-std::string extract_icon_from_appimage(const std::string& appimage_path,
-                                       const std::string& icons_dir,
-                                       const std::string& record_id) {
-  auto offset_opt = application::get_appimage_squashfs_offset(appimage_path);
-  if (!offset_opt.has_value())
-    return {};
+std::optional<application::AppImageContents> read_contents_with_unsquashfs(const std::string& appimage_path,
+                                                                           std::uint64_t offset) {
   QTemporaryDir temp_dir;
   if (!temp_dir.isValid())
-    return {};
+    return std::nullopt;
   std::string temp_path = temp_dir.path().toStdString();
   std::string list_path = (fs::path(temp_path) / "extract_list").string();
-  {
-    std::ofstream list_file(list_path);
-    if (!list_file)
-      return {};
-    list_file << ".DirIcon\n";
-  }
-  QProcess proc;
-  proc.setProgram(unsquashfs_path());
-  proc.setArguments({
-    QStringLiteral("-o"), QString::number(offset_opt.value()),
-    QStringLiteral("-follow-symlinks"),
-    QStringLiteral("-d"), QString::fromStdString(temp_path),
-    QStringLiteral("-ef"), QString::fromStdString(list_path),
-    QString::fromStdString(appimage_path)
-  });
-  proc.start();
-  if (!proc.waitForFinished(30000))
-    return {};
-  int code = proc.exitCode();
-  if (code == 1)
-    return {};
-  fs::path extracted = fs::path(temp_path) / ".DirIcon";
-  fs::path icon_file = extracted;
-  if (fs::exists(extracted)) {
-    if (fs::is_symlink(extracted)) {
-      fs::path target = fs::read_symlink(extracted);
-      icon_file = extracted.parent_path() / target;
-    }
-    if (fs::is_regular_file(icon_file) && !looks_like_image(icon_file))
-      icon_file = fs::path();
-  }
-  auto run_unsquashfs_ef = [&](const std::string& entry) {
-    std::ofstream out(list_path);
+  fs::path root = fs::path(temp_path) / "root";
+  auto extract = [&](const std::vector<std::string>& entries) {
+    std::ofstream out(list_path, std::ios::trunc);
     if (!out)
       return false;
-    out << entry << "\n";
+    for (const auto& entry : entries)
+      out << entry << "\n";
     out.close();
     QProcess p;
     p.setProgram(unsquashfs_path());
     p.setArguments({
-      QStringLiteral("-o"), QString::number(offset_opt.value()),
+      QStringLiteral("-o"), QString::number(offset),
       QStringLiteral("-follow-symlinks"),
-      QStringLiteral("-d"), QString::fromStdString(temp_path),
+      QStringLiteral("-f"),
+      QStringLiteral("-d"), QString::fromStdString(root.string()),
       QStringLiteral("-ef"), QString::fromStdString(list_path),
       QString::fromStdString(appimage_path)
     });
     p.start();
-    return p.waitForFinished(15000) && p.exitCode() != 1;
+    return p.waitForFinished(30000) && p.exitCode() != 1;
   };
-  auto try_stem_png = [&]() {
-    std::string stem = fs::path(appimage_path).stem().string();
-    fs::path stem_icon = fs::path(temp_path) / (stem + ".png");
-    if (fs::is_regular_file(stem_icon)) {
-      icon_file = stem_icon;
-      return true;
-    }
-    if (!run_unsquashfs_ef(stem + ".png"))
-      return false;
-    if (fs::is_regular_file(stem_icon)) {
-      icon_file = stem_icon;
-      return true;
-    }
-    return false;
-  };
-  auto parse_icon_from_desktop = [](const fs::path& desktop_path) -> std::string {
-    std::ifstream in(desktop_path);
-    if (!in)
-      return {};
-    std::string line;
-    while (std::getline(in, line)) {
-      if (line.size() >= 5 && line.compare(0, 5, "Icon=") == 0) {
-        std::string value(line.begin() + 5, line.end());
-        std::size_t start = value.find_first_not_of(" \t");
-        if (start != std::string::npos)
-          value = value.substr(start);
-        std::size_t end = value.find_last_not_of(" \t");
-        if (end != std::string::npos)
-          value = value.substr(0, end + 1);
-        return value;
-      }
-    }
-    return {};
-  };
-  auto try_desktop_icon = [&]() {
-    QProcess list_proc;
-    list_proc.setProgram(unsquashfs_path());
-    list_proc.setArguments({
-      QStringLiteral("-o"), QString::number(offset_opt.value()),
-      QStringLiteral("-l"), QString::fromStdString(appimage_path)
-    });
-    list_proc.start();
-    if (!list_proc.waitForFinished(10000))
-      return false;
-    QByteArray out = list_proc.readAllStandardOutput();
-    std::string root_desktop;
-    std::string applications_desktop;
-    std::string fallback_desktop;
-    for (const QByteArray& line : out.split('\n')) {
-      std::string s = line.constData();
-      while (!s.empty() && (s.back() == '\r' || s.back() == '\n'))
-        s.pop_back();
-      if (s.size() >= 8u && s.compare(s.size() - 8, 8, ".desktop") == 0) {
-        std::size_t prefix = s.find("squashfs-root/");
-        std::string candidate = prefix != std::string::npos ? s.substr(prefix + 14) : s;
-        std::size_t path_start = candidate.find_first_not_of(" \t");
-        if (path_start != std::string::npos) {
-          std::size_t path_end = candidate.find_last_not_of(" \t");
-          candidate = candidate.substr(path_start, path_end != std::string::npos ? path_end - path_start + 1 : std::string::npos);
-        }
-        if (candidate.find('/') == std::string::npos && root_desktop.empty())
-          root_desktop = std::move(candidate);
-        else if (candidate.find("usr/share/applications/") == 0u && applications_desktop.empty())
-          applications_desktop = std::move(candidate);
-        else if (fallback_desktop.empty())
-          fallback_desktop = std::move(candidate);
-      }
-    }
-    std::string desktop_rel_path = !root_desktop.empty() ? root_desktop : (!applications_desktop.empty() ? applications_desktop : fallback_desktop);
-    if (desktop_rel_path.empty() || !run_unsquashfs_ef(desktop_rel_path))
-      return false;
-    fs::path desktop_path = fs::path(temp_path) / desktop_rel_path;
-    std::string icon_value = parse_icon_from_desktop(desktop_path);
-    if (icon_value.empty())
-      return false;
-    auto try_icon_path = [&](const std::string& rel_path) {
-      if (!run_unsquashfs_ef(rel_path))
-        return false;
-      fs::path p = fs::path(temp_path) / rel_path;
-      if (fs::is_regular_file(p)) {
-        icon_file = p;
-        return true;
-      }
-      return false;
-    };
-    if (icon_value.find('/') != std::string::npos) {
-      std::string rel_path = icon_value;
-      if (!rel_path.empty() && rel_path.front() == '/')
-        rel_path.erase(0, 1);
-      if (!rel_path.empty() && try_icon_path(rel_path))
-        return true;
-    }
-    std::string icon_name = icon_value;
-    std::size_t slash = icon_name.rfind('/');
-    if (slash != std::string::npos)
-      icon_name = icon_name.substr(slash + 1);
-    std::size_t dot = icon_name.rfind('.');
-    if (dot != std::string::npos && dot > 0)
-      icon_name = icon_name.substr(0, dot);
-    for (const auto& [prefix, ext] : icon_search_paths) {
-      std::string rel = std::string(prefix) + icon_name + std::string(ext);
-      if (try_icon_path(rel))
-        return true;
+
+  QProcess list_proc;
+  list_proc.setProgram(unsquashfs_path());
+  list_proc.setArguments({
+    QStringLiteral("-o"), QString::number(offset),
+    QStringLiteral("-l"), QString::fromStdString(appimage_path)
+  });
+  list_proc.start();
+  if (!list_proc.waitForFinished(10000) || list_proc.exitCode() == 1)
+    return std::nullopt;
+  std::vector<std::string> paths;
+  for (const QByteArray& line : list_proc.readAllStandardOutput().split('\n')) {
+    std::string s = line.constData();
+    while (!s.empty() && (s.back() == '\r' || s.back() == '\n'))
+      s.pop_back();
+    std::size_t prefix = s.find("squashfs-root/");
+    std::string candidate = prefix != std::string::npos ? s.substr(prefix + 14) : s;
+    std::size_t path_start = candidate.find_first_not_of(" \t");
+    if (path_start == std::string::npos)
+      continue;
+    std::size_t path_end = candidate.find_last_not_of(" \t");
+    paths.push_back(candidate.substr(path_start, path_end - path_start + 1));
+  }
+  std::unordered_set<std::string> present(paths.begin(), paths.end());
+
+  std::string desktop_path = application::pick_desktop_entry(paths);
+  std::string metainfo_path = application::pick_metainfo_entry(paths);
+  std::vector<std::string> wanted;
+  for (const auto& entry : {std::string(".DirIcon"), desktop_path, metainfo_path}) {
+    if (!entry.empty() && present.count(entry))
+      wanted.push_back(entry);
+  }
+  if (!wanted.empty() && !extract(wanted))
+    return std::nullopt;
+
+  application::AppImageContents contents;
+  std::string icon_value;
+  if (!desktop_path.empty()) {
+    if (auto desktop = read_extracted(root, desktop_path))
+      icon_value = application::parse_desktop_entry(*desktop, contents.metadata);
+  }
+  if (!metainfo_path.empty()) {
+    if (auto metainfo = read_extracted(root, metainfo_path))
+      application::parse_appstream(*metainfo, contents.metadata);
+  }
+  if (auto dir_icon = read_extracted(root, ".DirIcon"); dir_icon && application::looks_like_image_data(*dir_icon)) {
+    contents.icon_entry = ".DirIcon";
+    contents.icon_data = std::move(*dir_icon);
+    return contents;
+  }
+  for (const auto& candidate : application::icon_candidates(appimage_path, icon_value)) {
+    if (!present.count(candidate) || !extract({candidate}))
+      continue;
+    if (auto data = read_extracted(root, candidate)) {
+      contents.icon_entry = candidate;
+      contents.icon_data = std::move(*data);
+      break;
     }
-    return false;
-  };
-  if (!fs::is_regular_file(icon_file) && !try_stem_png() && !try_desktop_icon())
-    return {};
-  fs::path copy_src = icon_file;
-  while (fs::is_symlink(copy_src)) {
-    copy_src = copy_src.parent_path() / fs::read_symlink(copy_src);
   }
-  if (!fs::is_regular_file(copy_src))
+  return contents;
+}
+
+std::string write_icon(const application::AppImageContents& contents,
+                       const std::string& icons_dir,
+                       const std::string& record_id) {
+  if (contents.icon_data.empty()) {
+    application::remove_icon(record_id, icons_dir);
     return {};
-  fs::create_directories(icons_dir);
-  std::string ext = copy_src.extension().string();
+  }
+  std::string ext = fs::path(contents.icon_entry).extension().string();
   if (ext.empty())
-    ext = ".png";
+    ext = contents.icon_data.compare(0, 1, "<") == 0 ? ".svg" : ".png";
   std::string dest = application::icon_file_path(record_id, icons_dir, ext);
-  std::error_code ec;
-  fs::copy(copy_src, dest, fs::copy_options::overwrite_existing, ec);
-  if (ec)
+  if (!infrastructure::write_file_atomically(dest, contents.icon_data))
     return {};
+  std::error_code ec;
+  for (const char* other : {".png", ".svg"}) {
+    std::string stale = application::icon_file_path(record_id, icons_dir, other);
+    if (stale != dest)
+      fs::remove(stale, ec);
+  }
   return dest;
 }
 
 }
+
+std::optional<domain::AppImageMetadata> refresh_appimage_metadata(const domain::AppImageRecord& record,
+                                                                  const std::string& icons_dir,
+                                                                  application::AppImageProbeCache* probe_cache) {
+  std::optional<application::AppImageProbe> probe = probe_cache ? probe_cache->probe(record.path)
+                                                                 : application::probe_appimage(record.path);
+  if (!probe)
+    return std::nullopt;
+  const domain::AppImageMetadata& current = record.metadata;
+  if (current.content_hash == probe->content_hash &&
+      (current.icon_path.empty() || fs::is_regular_file(current.icon_path)))
+    return std::nullopt;
+  application::SquashfsImage image(record.path, probe->squashfs_offset);
+  std::optional<application::AppImageContents> contents;
+  if (image.is_open())
+    contents = application::read_appimage_contents(image, record.path);
+  if (!contents)
+    contents = read_contents_with_unsquashfs(record.path, probe->squashfs_offset);
+  if (!contents)
+    return std::nullopt;
+  domain::AppImageMetadata metadata = std::move(contents->metadata);
+  metadata.icon_path = write_icon(*contents, icons_dir, record.id);
+  if (metadata.icon_path.empty() && !contents->icon_data.empty())
+    return std::nullopt;
+  metadata.content_hash = probe->content_hash;
+  return metadata;
+}
+
+}
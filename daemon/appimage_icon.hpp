@@ -1,11 +1,14 @@
 #pragma once
 
+#include <domain/entities/app_image_record.hpp>
+#include <application/appimage_probe_cache.hpp>
+#include <optional>
 #include <string>
 
 namespace appimage_manager::daemon {
 
-std::string extract_icon_from_appimage(const std::string& appimage_path,
-                                       const std::string& icons_dir,
-                                       const std::string& record_id);
+std::optional<domain::AppImageMetadata> refresh_appimage_metadata(const domain::AppImageRecord& record,
+                                                                  const std::string& icons_dir,
+                                                                  application::AppImageProbeCache* probe_cache = nullptr);
 
 }
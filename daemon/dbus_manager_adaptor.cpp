@@ -4,13 +4,32 @@
 #include <domain/entities/launch_settings.hpp>
 #include <application/generate_desktop.hpp>
 #include <QDBusConnection>
+#include <QDBusMetaType>
+#include <QTimer>
+#include <QUuid>
 #include <QVariantMap>
+#include <algorithm>
 #include <filesystem>
 
 namespace appimage_manager::daemon {
 
 namespace {
 
+constexpr std::size_t finished_jobs_kept = 64;
+constexpr std::size_t change_log_size = 4096;
+
+enum RecordField : unsigned {
+  field_id = 1u << 0,
+  field_path = 1u << 1,
+  field_name = 1u << 2,
+  field_install_type = 1u << 3,
+  field_added_at = 1u << 4,
+  field_version = 1u << 5,
+  field_summary = 1u << 6,
+  all_fields = field_id | field_path | field_name | field_install_type | field_added_at |
+               field_version | field_summary,
+};
+
 QString install_type_to_string(domain::InstallType t) {
   switch (t) {
     case domain::InstallType::Downloaded: return QStringLiteral("Downloaded");
@@ -40,6 +59,74 @@ domain::InstallType string_to_install_type(const QString& s) {
   return domain::InstallType::Downloaded;
 }
 
+unsigned parse_fields(const QStringList& fields) {
+  if (fields.isEmpty())
+    return all_fields;
+  unsigned mask = 0;
+  for (const QString& f : fields) {
+    if (f == QLatin1String("id")) mask |= field_id;
+    else if (f == QLatin1String("path")) mask |= field_path;
+    else if (f == QLatin1String("name")) mask |= field_name;
+    else if (f == QLatin1String("install_type")) mask |= field_install_type;
+    else if (f == QLatin1String("added_at")) mask |= field_added_at;
+    else if (f == QLatin1String("version")) mask |= field_version;
+    else if (f == QLatin1String("summary")) mask |= field_summary;
+  }
+  return mask;
+}
+
+DBusRecord to_dbus_record(const domain::AppImageRecord& r, unsigned mask) {
+  DBusRecord out;
+  if (mask & field_id) out.id = QString::fromStdString(r.id);
+  if (mask & field_path) out.path = QString::fromStdString(r.path);
+  if (mask & field_name) out.name = QString::fromStdString(r.name);
+  if (mask & field_install_type) out.install_type = install_type_to_string(r.install_type);
+  if (mask & field_added_at) out.added_at = QString::fromStdString(r.added_at);
+  if (mask & field_version) out.version = QString::fromStdString(r.metadata.version);
+  if (mask & field_summary) out.summary = QString::fromStdString(r.metadata.summary);
+  return out;
+}
+
+QStringList to_string_list(const std::vector<std::string>& items) {
+  QStringList list;
+  for (const auto& item : items)
+    list.append(QString::fromStdString(item));
+  return list;
+}
+
+QVariantMap record_to_map(const domain::AppImageRecord& r) {
+  QVariantMap m;
+  m.insert(QStringLiteral("id"), QString::fromStdString(r.id));
+  m.insert(QStringLiteral("path"), QString::fromStdString(r.path));
+  m.insert(QStringLiteral("name"), QString::fromStdString(r.name));
+  m.insert(QStringLiteral("install_type"), install_type_to_string(r.install_type));
+  m.insert(QStringLiteral("added_at"), QString::fromStdString(r.added_at));
+  m.insert(QStringLiteral("version"), QString::fromStdString(r.metadata.version));
+  m.insert(QStringLiteral("summary"), QString::fromStdString(r.metadata.summary));
+  m.insert(QStringLiteral("display_name"), QString::fromStdString(r.metadata.name));
+  m.insert(QStringLiteral("categories"), to_string_list(r.metadata.categories));
+  m.insert(QStringLiteral("mime_types"), to_string_list(r.metadata.mime_types));
+  m.insert(QStringLiteral("startup_wm_class"), QString::fromStdString(r.metadata.startup_wm_class));
+  m.insert(QStringLiteral("icon_path"), QString::fromStdString(r.metadata.icon_path));
+  return m;
+}
+
+}
+
+QDBusArgument& operator<<(QDBusArgument& argument, const DBusRecord& record) {
+  argument.beginStructure();
+  argument << record.id << record.path << record.name << record.install_type << record.added_at
+           << record.version << record.summary;
+  argument.endStructure();
+  return argument;
+}
+
+const QDBusArgument& operator>>(const QDBusArgument& argument, DBusRecord& record) {
+  argument.beginStructure();
+  argument >> record.id >> record.path >> record.name >> record.install_type >> record.added_at
+           >> record.version >> record.summary;
+  argument.endStructure();
+  return argument;
 }
 
 DBusManagerAdaptor::DBusManagerAdaptor(domain::RegistryRepository& registry,
@@ -53,18 +140,68 @@ DBusManagerAdaptor::DBusManagerAdaptor(domain::RegistryRepository& registry,
   , config_repository_(&config_repository)
   , launch_settings_repository_(&launch_settings_repository)
   , applications_dir_(applications_dir)
-  , watcher_(watcher) {}
+  , watcher_(watcher)
+  , epoch_(QUuid::createUuid().toString(QUuid::WithoutBraces)) {
+  qDBusRegisterMetaType<DBusRecord>();
+  qDBusRegisterMetaType<QList<DBusRecord>>();
+  if (!watcher_)
+    return;
+  connect(watcher_, &DirectoryWatcher::record_added, this, &DBusManagerAdaptor::on_record_added);
+  connect(watcher_, &DirectoryWatcher::record_removed, this, &DBusManagerAdaptor::on_record_removed);
+  connect(watcher_, &DirectoryWatcher::record_updated, this, &DBusManagerAdaptor::on_record_updated);
+  connect(watcher_, &DirectoryWatcher::rescan_progress, this, [this](int done, int total) {
+    for (uint job_id : rescan_jobs_)
+      Q_EMIT JobProgress(job_id, static_cast<uint>(done), static_cast<uint>(total));
+    Q_EMIT StatusChanged(GetStatus());
+  });
+  connect(watcher_, &DirectoryWatcher::rescan_finished, this, [this] {
+    std::vector<uint> jobs = std::move(rescan_jobs_);
+    rescan_jobs_.clear();
+    for (uint job_id : jobs)
+      finish_job(job_id, true);
+    Q_EMIT StatusChanged(GetStatus());
+  });
+  if (IconWorkerPool* pool = watcher_->icon_worker_pool()) {
+    connect(pool, &IconWorkerPool::job_finished, this, &DBusManagerAdaptor::on_desktop_ready);
+    connect(pool, &IconWorkerPool::metadata_changed, this, &DBusManagerAdaptor::on_record_updated);
+  }
+}
 
 QVariantList DBusManagerAdaptor::GetAllRecords() const {
   QVariantList list;
-  for (const auto& r : registry_->all()) {
-    QVariantMap m;
-    m.insert(QStringLiteral("id"), QString::fromStdString(r.id));
-    m.insert(QStringLiteral("path"), QString::fromStdString(r.path));
-    m.insert(QStringLiteral("name"), QString::fromStdString(r.name));
-    m.insert(QStringLiteral("install_type"), install_type_to_string(r.install_type));
-    m.insert(QStringLiteral("added_at"), QString::fromStdString(r.added_at));
-    list.append(m);
+  for (const auto& r : registry_->all())
+    list.append(record_to_map(r));
+  return list;
+}
+
+QList<DBusRecord> DBusManagerAdaptor::GetRecords(uint offset, uint limit, const QStringList& fields) const {
+  QList<DBusRecord> list;
+  unsigned mask = parse_fields(fields);
+  auto records = registry_->page(offset, limit);
+  list.reserve(static_cast<qsizetype>(records.size()));
+  for (const auto& r : records)
+    list.append(to_dbus_record(r, mask));
+  return list;
+}
+
+QList<DBusRecord> DBusManagerAdaptor::GetRecordsSince(const QString& epoch, qulonglong generation,
+                                                      QStringList& removed_ids, qulonglong& current_generation,
+                                                      bool& reset, QString& current_epoch) const {
+  current_generation = generation_;
+  current_epoch = epoch_;
+  qulonglong oldest = change_log_.empty() ? generation_ : change_log_.front().first - 1;
+  reset = epoch != epoch_ || generation > generation_ || generation < oldest;
+  if (reset)
+    return GetRecords(0, 0, {});
+  std::unordered_set<std::string> seen;
+  QList<DBusRecord> list;
+  for (auto it = change_log_.rbegin(); it != change_log_.rend() && it->first > generation; ++it) {
+    if (!seen.insert(it->second).second)
+      continue;
+    if (auto record = registry_->by_id(it->second))
+      list.append(to_dbus_record(*record, all_fields));
+    else
+      removed_ids.append(QString::fromStdString(it->second));
   }
   return list;
 }
@@ -78,7 +215,8 @@ QStringList DBusManagerAdaptor::GetWatchDirectories() const {
 }
 
 void DBusManagerAdaptor::SetWatchDirectories(const QStringList& directories) {
-  domain::Config config;
+  domain::Config config = config_repository_->load();
+  config.watch_directories.clear();
   for (const QString& d : directories)
     config.watch_directories.push_back(d.toStdString());
   config_repository_->save(config);
@@ -86,12 +224,20 @@ void DBusManagerAdaptor::SetWatchDirectories(const QStringList& directories) {
     watcher_->set_config(config);
 }
 
-void DBusManagerAdaptor::TriggerRescan() {
-  if (watcher_)
-    watcher_->trigger_rescan();
+uint DBusManagerAdaptor::TriggerRescan() {
+  uint job_id = start_job();
+  if (watcher_) {
+    rescan_jobs_.push_back(job_id);
+    watcher_->start_rescan();
+  } else {
+    QTimer::singleShot(0, this, [this, job_id] { finish_job(job_id, true); });
+  }
+  return job_id;
 }
 
 QString DBusManagerAdaptor::GetStatus() const {
+  if (watcher_ && watcher_->is_rescanning())
+    return QStringLiteral("indexing %1/%2").arg(watcher_->rescan_done()).arg(watcher_->rescan_total());
   return QStringLiteral("running");
 }
 
@@ -113,7 +259,7 @@ QVariantMap DBusManagerAdaptor::GetLaunchSettings(const QString& app_id) const {
   return m;
 }
 
-void DBusManagerAdaptor::SetLaunchSettings(const QString& app_id, const QString& args,
+uint DBusManagerAdaptor::SetLaunchSettings(const QString& app_id, const QString& args,
                                           const QStringList& env, const QString& sandbox) {
   domain::LaunchSettings settings;
   settings.args = args.toStdString();
@@ -121,32 +267,56 @@ void DBusManagerAdaptor::SetLaunchSettings(const QString& app_id, const QString&
     settings.env.push_back(e.toStdString());
   settings.sandbox = string_to_sandbox(sandbox);
   launch_settings_repository_->save(app_id.toStdString(), settings);
-  auto record = registry_->by_id(app_id.toStdString());
-  if (record) {
-    std::string icons_dir = (std::filesystem::path(applications_dir_).parent_path() / "appimage-manager" / "icons").string();
-    std::string icon_path = application::icon_file_path(record->id, icons_dir);
-    if (!std::filesystem::is_regular_file(icon_path))
-      icon_path.clear();
-    application::generate_desktop(*record, settings, applications_dir_, icon_path);
-  }
+  uint job_id = start_job();
+  QTimer::singleShot(0, this, [this, job_id, id = app_id.toStdString(), settings] {
+    auto record = registry_->by_id(id);
+    if (!record) {
+      finish_job(job_id, true);
+      return;
+    }
+    if (watcher_ && watcher_->icon_worker_pool()) {
+      desktop_jobs_[record->id].push_back(job_id);
+      watcher_->icon_worker_pool()->enqueue(*record, settings);
+      return;
+    }
+    note_desktop_change(application::generate_desktop(*record, settings, applications_dir_));
+    finish_job(job_id, true);
+  });
+  return job_id;
 }
 
-bool DBusManagerAdaptor::RemoveAppImage(const QString& app_id) {
+uint DBusManagerAdaptor::RemoveAppImage(const QString& app_id) {
   std::string id = app_id.toStdString();
-  auto record = registry_->by_id(id);
-  if (!record)
-    return false;
-  
-  std::error_code ec;
-  std::filesystem::remove(record->path, ec);
-  application::remove_desktop(id, record->name, applications_dir_);
-  launch_settings_repository_->remove(id);
-  registry_->remove(id);
-  
-  if (watcher_)
-    watcher_->trigger_rescan();
-  
-  return true;
+  if (!registry_->by_id(id))
+    return 0;
+  uint job_id = start_job();
+  QTimer::singleShot(0, this, [this, job_id, id] {
+    auto record = registry_->by_id(id);
+    if (!record) {
+      finish_job(job_id, false);
+      return;
+    }
+    {
+      domain::RegistryBatch batch(*registry_);
+      domain::LaunchSettingsBatch settings_batch(*launch_settings_repository_);
+      if (watcher_ && watcher_->icon_worker_pool())
+        watcher_->icon_worker_pool()->forget(id);
+      if (watcher_ && watcher_->probe_cache())
+        watcher_->probe_cache()->forget(record->path);
+      std::error_code ec;
+      std::filesystem::remove(record->path, ec);
+      if (!record->metadata.icon_path.empty())
+        std::filesystem::remove(record->metadata.icon_path, ec);
+      note_desktop_change(application::remove_desktop(id, record->name, applications_dir_));
+      launch_settings_repository_->remove(id);
+      registry_->remove(id);
+    }
+    on_record_removed(QString::fromStdString(id));
+    if (watcher_)
+      watcher_->start_rescan();
+    finish_job(job_id, true);
+  });
+  return job_id;
 }
 
 bool DBusManagerAdaptor::SetRecordName(const QString& app_id, const QString& name) {
@@ -158,14 +328,14 @@ bool DBusManagerAdaptor::SetRecordName(const QString& app_id, const QString& nam
   std::string old_name = record->name;
   record->name = new_name;
   registry_->save(*record);
-  application::remove_desktop(id, old_name, applications_dir_);
+  bool desktop_changed = application::remove_desktop(id, old_name, applications_dir_);
   auto settings = launch_settings_repository_->load(id);
   domain::LaunchSettings ls = settings.value_or(domain::LaunchSettings{});
-  std::string icons_dir = (std::filesystem::path(applications_dir_).parent_path() / "appimage-manager" / "icons").string();
-  std::string icon_path = application::icon_file_path(record->id, icons_dir);
-  if (!std::filesystem::is_regular_file(icon_path))
-    icon_path.clear();
-  application::generate_desktop(*record, ls, applications_dir_, icon_path);
+  desktop_changed |= application::generate_desktop(*record, ls, applications_dir_);
+  note_desktop_change(desktop_changed);
+  if (watcher_ && watcher_->icon_worker_pool() && watcher_->icon_worker_pool()->is_pending(id))
+    watcher_->icon_worker_pool()->enqueue(*record, ls);
+  Q_EMIT RecordUpdated(record_to_map(*record), record_changed(record->id));
   return true;
 }
 
@@ -174,7 +344,92 @@ bool DBusManagerAdaptor::SetInstallType(const QString& app_id, const QString& in
   if (!record) return false;
   record->install_type = string_to_install_type(install_type);
   registry_->save(*record);
+  Q_EMIT RecordUpdated(record_to_map(*record), record_changed(record->id));
   return true;
 }
 
+bool DBusManagerAdaptor::WaitForJob(uint job_id, const QDBusMessage& message) {
+  if (running_jobs_.count(job_id)) {
+    message.setDelayedReply(true);
+    job_waiters_[job_id].push_back(message);
+    return false;
+  }
+  for (const auto& [finished_id, success] : finished_jobs_)
+    if (finished_id == job_id)
+      return success;
+  return false;
+}
+
+qulonglong DBusManagerAdaptor::GetGeneration() const {
+  return generation_;
+}
+
+QString DBusManagerAdaptor::GetEpoch() const {
+  return epoch_;
+}
+
+uint DBusManagerAdaptor::start_job() {
+  uint job_id = next_job_id_++;
+  if (next_job_id_ == 0)
+    next_job_id_ = 1;
+  running_jobs_.insert(job_id);
+  return job_id;
+}
+
+void DBusManagerAdaptor::finish_job(uint job_id, bool success) {
+  if (!running_jobs_.erase(job_id))
+    return;
+  finished_jobs_.emplace_back(job_id, success);
+  if (finished_jobs_.size() > finished_jobs_kept)
+    finished_jobs_.pop_front();
+  Q_EMIT JobFinished(job_id, success);
+  auto it = job_waiters_.find(job_id);
+  if (it == job_waiters_.end())
+    return;
+  std::vector<QDBusMessage> waiters = std::move(it->second);
+  job_waiters_.erase(it);
+  for (const QDBusMessage& message : waiters)
+    QDBusConnection::sessionBus().send(message.createReply(success));
+}
+
+void DBusManagerAdaptor::on_desktop_ready(const QString& record_id) {
+  std::string id = record_id.toStdString();
+  if (watcher_->icon_worker_pool()->is_pending(id))
+    return;
+  auto it = desktop_jobs_.find(id);
+  if (it == desktop_jobs_.end())
+    return;
+  std::vector<uint> jobs = std::move(it->second);
+  desktop_jobs_.erase(it);
+  for (uint job_id : jobs)
+    finish_job(job_id, true);
+}
+
+void DBusManagerAdaptor::on_record_added(const QString& record_id) {
+  auto record = registry_->by_id(record_id.toStdString());
+  if (record)
+    Q_EMIT RecordAdded(record_to_map(*record), epoch_, record_changed(record->id));
+}
+
+void DBusManagerAdaptor::on_record_removed(const QString& record_id) {
+  Q_EMIT RecordRemoved(record_id, epoch_, record_changed(record_id.toStdString()));
+}
+
+void DBusManagerAdaptor::on_record_updated(const QString& record_id) {
+  if (auto record = registry_->by_id(record_id.toStdString()))
+    Q_EMIT RecordUpdated(record_to_map(*record), epoch_, record_changed(record->id));
+}
+
+qulonglong DBusManagerAdaptor::record_changed(const std::string& record_id) {
+  change_log_.emplace_back(++generation_, record_id);
+  if (change_log_.size() > change_log_size)
+    change_log_.pop_front();
+  return generation_;
+}
+
+void DBusManagerAdaptor::note_desktop_change(bool changed) {
+  if (changed && watcher_ && watcher_->desktop_database())
+    watcher_->desktop_database()->mark_changed();
+}
+
 }
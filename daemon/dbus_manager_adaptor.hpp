@@ -6,15 +6,38 @@
 #include <domain/repositories/launch_settings_repository.hpp>
 #include <directory_watcher.hpp>
 #include <QDBusAbstractAdaptor>
+#include <QDBusArgument>
+#include <QDBusMessage>
+#include <QList>
+#include <QMetaType>
 #include <QVariantList>
 #include <QVariantMap>
 #include <QStringList>
 #include <QString>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace appimage_manager::daemon {
 
 class DirectoryWatcher;
 
+struct DBusRecord {
+  QString id;
+  QString path;
+  QString name;
+  QString install_type;
+  QString added_at;
+  QString version;
+  QString summary;
+};
+
+QDBusArgument& operator<<(QDBusArgument& argument, const DBusRecord& record);
+const QDBusArgument& operator>>(const QDBusArgument& argument, DBusRecord& record);
+
 class DBusManagerAdaptor : public QDBusAbstractAdaptor {
   Q_OBJECT
   Q_CLASSINFO("D-Bus Interface", "org.appimage.Manager1")
@@ -28,23 +51,57 @@ public:
 
 public Q_SLOTS:
   QVariantList GetAllRecords() const;
+  QList<DBusRecord> GetRecords(uint offset, uint limit, const QStringList& fields) const;
+  QList<DBusRecord> GetRecordsSince(const QString& epoch, qulonglong generation, QStringList& removed_ids,
+                                    qulonglong& current_generation, bool& reset, QString& current_epoch) const;
   QStringList GetWatchDirectories() const;
   void SetWatchDirectories(const QStringList& directories);
-  void TriggerRescan();
+  uint TriggerRescan();
   QString GetStatus() const;
   QVariantMap GetLaunchSettings(const QString& app_id) const;
-  void SetLaunchSettings(const QString& app_id, const QString& args,
+  uint SetLaunchSettings(const QString& app_id, const QString& args,
                          const QStringList& env, const QString& sandbox);
-  bool RemoveAppImage(const QString& app_id);
+  uint RemoveAppImage(const QString& app_id);
   bool SetRecordName(const QString& app_id, const QString& name);
   bool SetInstallType(const QString& app_id, const QString& install_type);
+  bool WaitForJob(uint job_id, const QDBusMessage& message);
+  qulonglong GetGeneration() const;
+  QString GetEpoch() const;
+
+Q_SIGNALS:
+  void JobProgress(uint job_id, uint done, uint total);
+  void JobFinished(uint job_id, bool success);
+  void RecordAdded(const QVariantMap& record, const QString& epoch, qulonglong generation);
+  void RecordRemoved(const QString& app_id, const QString& epoch, qulonglong generation);
+  void RecordUpdated(const QVariantMap& record, const QString& epoch, qulonglong generation);
+  void StatusChanged(const QString& status);
 
 private:
+  uint start_job();
+  void finish_job(uint job_id, bool success);
+  void on_desktop_ready(const QString& record_id);
+  void on_record_added(const QString& record_id);
+  void on_record_removed(const QString& record_id);
+  void on_record_updated(const QString& record_id);
+  qulonglong record_changed(const std::string& record_id);
+  void note_desktop_change(bool changed);
+
   domain::RegistryRepository* registry_;
   domain::ConfigRepository* config_repository_;
   domain::LaunchSettingsRepository* launch_settings_repository_;
   std::string applications_dir_;
   DirectoryWatcher* watcher_;
+  QString epoch_;
+  qulonglong generation_{0};
+  std::deque<std::pair<qulonglong, std::string>> change_log_;
+  uint next_job_id_{1};
+  std::unordered_set<uint> running_jobs_;
+  std::deque<std::pair<uint, bool>> finished_jobs_;
+  std::unordered_map<uint, std::vector<QDBusMessage>> job_waiters_;
+  std::vector<uint> rescan_jobs_;
+  std::unordered_map<std::string, std::vector<uint>> desktop_jobs_;
 };
 
 }
+
+Q_DECLARE_METATYPE(appimage_manager::daemon::DBusRecord)
@@ -0,0 +1,55 @@
+#include "desktop_database.hpp"
+#include <QProcess>
+#include <QStandardPaths>
+#include <QStringList>
+
+namespace appimage_manager::daemon {
+
+namespace {
+
+constexpr int refresh_delay_ms = 1000;
+
+}
+
+DesktopDatabase::DesktopDatabase(const std::string& applications_dir, QObject* parent)
+  : QObject(parent)
+  , applications_dir_(applications_dir) {
+  refresh_timer_.setSingleShot(true);
+  refresh_timer_.setInterval(refresh_delay_ms);
+  connect(&refresh_timer_, &QTimer::timeout, this, &DesktopDatabase::refresh);
+}
+
+void DesktopDatabase::begin() {
+  ++batch_depth_;
+  refresh_timer_.stop();
+}
+
+void DesktopDatabase::commit() {
+  if (batch_depth_ == 0 || --batch_depth_ > 0)
+    return;
+  if (dirty_)
+    refresh_timer_.start();
+}
+
+void DesktopDatabase::mark_changed() {
+  dirty_ = true;
+  if (batch_depth_ == 0)
+    refresh_timer_.start();
+}
+
+int DesktopDatabase::refresh_count() const {
+  return refresh_count_;
+}
+
+void DesktopDatabase::refresh() {
+  if (batch_depth_ > 0 || !dirty_)
+    return;
+  dirty_ = false;
+  ++refresh_count_;
+  QString program = QStandardPaths::findExecutable(QStringLiteral("update-desktop-database"));
+  if (!program.isEmpty())
+    QProcess::startDetached(program, {QStringLiteral("-q"), QString::fromStdString(applications_dir_)});
+  Q_EMIT refreshed();
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <string>
+
+namespace appimage_manager::daemon {
+
+class DesktopDatabase : public QObject {
+  Q_OBJECT
+public:
+  explicit DesktopDatabase(const std::string& applications_dir, QObject* parent = nullptr);
+
+  void begin();
+  void commit();
+  void mark_changed();
+  int refresh_count() const;
+
+signals:
+  void refreshed();
+
+private Q_SLOTS:
+  void refresh();
+
+private:
+  std::string applications_dir_;
+  int batch_depth_{0};
+  bool dirty_{false};
+  int refresh_count_{0};
+  QTimer refresh_timer_;
+};
+
+}
@@ -3,8 +3,13 @@
 #include "desktop_notification.hpp"
 #include <domain/entities/config.hpp>
 #include <domain/entities/launch_settings.hpp>
+#include <application/watch_tree.hpp>
+#include <QMetaObject>
+#include <QTimer>
 #include <filesystem>
+#include <optional>
 #include <algorithm>
+#include <iterator>
 #include <iostream>
 #include <cctype>
 
@@ -15,12 +20,11 @@ namespace appimage_manager::daemon {
 namespace {
 
 constexpr std::string_view appimage_suffix = ".AppImage";
+constexpr int poll_interval_ms = 30000;
+constexpr std::size_t rescan_chunk_size = 64;
+constexpr std::size_t rescan_queue_capacity = 16;
 
-bool is_appimage_path(const std::string& path) {
-  fs::path p(path);
-  if (!fs::is_regular_file(p))
-    return false;
-  std::string name = p.filename().string();
+bool has_appimage_suffix(const std::string& name) {
   if (name.size() < appimage_suffix.size())
     return false;
   std::string suffix(name.end() - static_cast<std::ptrdiff_t>(appimage_suffix.size()), name.end());
@@ -28,6 +32,11 @@ bool is_appimage_path(const std::string& path) {
     [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
 }
 
+bool is_appimage_path(const std::string& path) {
+  fs::path p(path);
+  return fs::is_regular_file(p) && has_appimage_suffix(p.filename().string());
+}
+
 }
 
 DirectoryWatcher::DirectoryWatcher(domain::RegistryRepository& registry,
@@ -39,80 +48,510 @@ DirectoryWatcher::DirectoryWatcher(domain::RegistryRepository& registry,
   , registry_(&registry)
   , launch_settings_repository_(&launch_settings_repository)
   , applications_dir_(applications_dir)
+  , icons_dir_((fs::path(applications_dir).parent_path() / "appimage-manager" / "icons").string())
   , self_path_(self_path)
   , scan_(registry) {
-  connect(&watcher_, &QFileSystemWatcher::directoryChanged, this, &DirectoryWatcher::on_directory_changed);
+  connect(&inotify_, &InotifyWatcher::file_written, this, &DirectoryWatcher::on_file_changed);
+  connect(&inotify_, &InotifyWatcher::file_removed, this, &DirectoryWatcher::on_file_changed);
+  connect(&inotify_, &InotifyWatcher::directory_added, this, &DirectoryWatcher::on_directory_added);
+  flush_timer_.setSingleShot(true);
+  connect(&flush_timer_, &QTimer::timeout, this, &DirectoryWatcher::flush_pending_changes);
+  clock_.start();
+  connect(&inotify_, &InotifyWatcher::directory_lost, this, &DirectoryWatcher::on_directory_lost);
+  connect(&inotify_, &InotifyWatcher::overflowed, this, &DirectoryWatcher::on_events_overflowed);
+  poll_timer_.setInterval(poll_interval_ms);
+  connect(&poll_timer_, &QTimer::timeout, this, &DirectoryWatcher::poll_directories);
+  scan_.set_on_moved([this](const domain::AppImageRecord& record, const domain::AppImageRecord& previous) {
+    on_moved(record, previous);
+  });
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+  rescan_pipeline_.reset();
 }
 
 void DirectoryWatcher::set_config(const domain::Config& config) {
-  for (const QString& path : watcher_.directories())
-    watcher_.removePath(path);
+  inotify_.clear();
+  tracked_.clear();
+  polled_.clear();
+  poll_timer_.stop();
+  watch_limit_warned_ = false;
+  pending_.clear();
+  flush_timer_.stop();
   config_ = config;
-  for (const auto& dir : config_.watch_directories) {
-    if (fs::is_directory(fs::path(dir)))
-      watcher_.addPath(QString::fromStdString(dir));
+  for (const auto& root : config_.watch_directories)
+    track_tree(root, root, false);
+}
+
+void DirectoryWatcher::set_probe_cache(application::AppImageProbeCache* probe_cache) {
+  probe_cache_ = probe_cache;
+  scan_.set_probe_cache(probe_cache);
+}
+
+application::AppImageProbeCache* DirectoryWatcher::probe_cache() const {
+  return probe_cache_;
+}
+
+void DirectoryWatcher::set_snapshot_repository(domain::DirectorySnapshotRepository* snapshots) {
+  snapshots_ = snapshots;
+  scan_.set_snapshot_repository(snapshots);
+}
+
+void DirectoryWatcher::set_icon_worker_pool(IconWorkerPool* icon_worker_pool) {
+  icon_worker_pool_ = icon_worker_pool;
+}
+
+IconWorkerPool* DirectoryWatcher::icon_worker_pool() const {
+  return icon_worker_pool_;
+}
+
+void DirectoryWatcher::set_desktop_database(DesktopDatabase* desktop_database) {
+  desktop_database_ = desktop_database;
+}
+
+DesktopDatabase* DirectoryWatcher::desktop_database() const {
+  return desktop_database_;
+}
+
+void DirectoryWatcher::start_rescan() {
+  if (rescanning_) {
+    rescan_requested_ = true;
+    return;
+  }
+  rescanning_ = true;
+  rescan_requested_ = false;
+  rescan_listing_.reset();
+  rescan_delta_.reset();
+  rescan_stale_.clear();
+  rescan_done_ = 0;
+  rescan_total_ = 0;
+  if (desktop_database_)
+    desktop_database_->begin();
+  if (probe_cache_)
+    probe_cache_->begin();
+  rescan_pipeline_ = std::make_unique<application::ScanPipeline>(scan_, config_, [this] {
+    QMetaObject::invokeMethod(this, [this] { schedule_rescan_next(); }, Qt::QueuedConnection);
+  }, rescan_queue_capacity);
+  Q_EMIT rescan_progress(rescan_done_, rescan_total_);
+}
+
+bool DirectoryWatcher::is_rescanning() const {
+  return rescanning_;
+}
+
+int DirectoryWatcher::rescan_done() const {
+  return rescan_done_;
+}
+
+int DirectoryWatcher::rescan_total() const {
+  return rescan_total_;
+}
+
+void DirectoryWatcher::on_listing_ready(const application::ScanDirectories::DirectoryListing& listing) {
+  rescan_total_ += static_cast<int>(listing.entries.size());
+  if (listing.missing || tracked_.count(listing.dir))
+    return;
+  std::string root = root_for(listing.dir);
+  if (!root.empty() && application::within_watch_tree(root, listing.dir, config_))
+    track_directory(listing.dir);
+}
+
+void DirectoryWatcher::schedule_rescan_next() {
+  if (!rescan_pipeline_ || rescan_scheduled_)
+    return;
+  rescan_scheduled_ = true;
+  QTimer::singleShot(0, this, &DirectoryWatcher::rescan_next);
+}
+
+void DirectoryWatcher::rescan_next() {
+  rescan_scheduled_ = false;
+  if (!rescan_pipeline_)
+    return;
+  auto ensure = [this](const domain::AppImageRecord& record) { ensure_desktop_with_icon(record); };
+  auto added = [this](const domain::AppImageRecord& record) { on_added(record); };
+  std::vector<domain::AppImageRecord> applied;
+  std::size_t budget = rescan_chunk_size;
+  {
+    domain::RegistryBatch batch(*registry_);
+    std::optional<domain::DirectorySnapshotBatch> snapshot_batch;
+    if (snapshots_)
+      snapshot_batch.emplace(*snapshots_);
+    while (budget > 0) {
+      if (!rescan_listing_) {
+        rescan_listing_ = rescan_pipeline_->try_next();
+        if (!rescan_listing_)
+          break;
+        on_listing_ready(*rescan_listing_);
+      }
+      if (!rescan_delta_)
+        rescan_delta_ = scan_.reconcile(*rescan_listing_);
+      std::size_t count = scan_.apply_delta(*rescan_delta_, applied, added, self_path_, ensure, budget);
+      rescan_done_ += static_cast<int>(count);
+      budget -= count;
+      if (rescan_delta_->pending() > 0)
+        continue;
+      scan_.save_snapshot(*rescan_listing_);
+      std::move(rescan_delta_->removed.begin(), rescan_delta_->removed.end(), std::back_inserter(rescan_stale_));
+      rescan_delta_.reset();
+      rescan_listing_.reset();
+    }
   }
+  Q_EMIT rescan_progress(rescan_done_, rescan_total_);
+  if (budget == 0)
+    schedule_rescan_next();
+  else if (rescan_pipeline_->finished())
+    finish_rescan();
 }
 
-void DirectoryWatcher::trigger_rescan() {
-  for (const auto& dir : config_.watch_directories)
-    scan_directory(dir);
+void DirectoryWatcher::finish_rescan() {
+  rescan_pipeline_.reset();
+  remove_stale_records(rescan_stale_);
+  rescan_stale_.clear();
+  rescanning_ = false;
+  if (desktop_database_)
+    desktop_database_->commit();
+  if (probe_cache_)
+    probe_cache_->commit();
+  if (rescan_requested_) {
+    start_rescan();
+    return;
+  }
   Q_EMIT records_changed();
+  Q_EMIT rescan_finished();
 }
 
 void DirectoryWatcher::on_directory_changed(const QString& path) {
   std::cerr << "appimage-manager-daemon: inotify: directory changed " << path.toStdString() << "\n";
-  scan_directory(path.toStdString());
-  remove_stale_records_for_directory(path.toStdString());
-  Q_EMIT records_changed();
+  std::string dir = path.toStdString();
+  if (config_.quiet_period_ms <= 0) {
+    resync_directory(dir);
+    Q_EMIT records_changed();
+    return;
+  }
+  PendingDirectory& pending = pending_[dir];
+  if (!pending.full_scan) {
+    pending.full_scan = true;
+    pending.snapshot = directory_snapshot(dir);
+  }
+  defer(pending);
 }
 
-void DirectoryWatcher::scan_directory(const std::string& dir_path) {
-  domain::Config single;
-  single.watch_directories.push_back(dir_path);
-  domain::LaunchSettings default_settings;
-  std::string icons_dir = (fs::path(applications_dir_).parent_path() / "appimage-manager" / "icons").string();
-  auto ensure_desktop_with_icon = [this, &default_settings, &icons_dir](const domain::AppImageRecord& record) {
-    domain::LaunchSettings settings = default_settings;
-    auto loaded = launch_settings_repository_->load(record.id);
-    if (loaded)
-      settings = *loaded;
-    std::string icon_path = application::icon_file_path(record.id, icons_dir);
-    if (!fs::is_regular_file(icon_path))
-      icon_path = extract_icon_from_appimage(record.path, icons_dir, record.id);
-    application::generate_desktop(record, settings, applications_dir_, icon_path);
-  };
-  auto on_added = [this, &ensure_desktop_with_icon](const domain::AppImageRecord& record) {
-    ensure_desktop_with_icon(record);
-    fs::path p(record.path);
-    notify_appimage_processed(p.filename().string(), p.parent_path().string());
-  };
-  scan_.execute(single, on_added, self_path_, ensure_desktop_with_icon);
+void DirectoryWatcher::on_file_changed(const QString& dir, const QString& name) {
+  if (!has_appimage_suffix(name.toStdString()))
+    return;
+  std::string path = (fs::path(dir.toStdString()) / name.toStdString()).string();
+  if (application::is_excluded(path, config_.exclude))
+    return;
+  if (config_.quiet_period_ms <= 0) {
+    if (apply_file_change(path))
+      Q_EMIT records_changed();
+    return;
+  }
+  PendingDirectory& pending = pending_[dir.toStdString()];
+  if (!pending.files.count(name.toStdString()))
+    pending.files.emplace(name.toStdString(), infrastructure::stat_file(path));
+  defer(pending);
 }
 
-void DirectoryWatcher::remove_stale_records_for_directory(const std::string& dir_path) {
-  fs::path base(dir_path);
-  if (!fs::is_directory(base))
+void DirectoryWatcher::on_directory_added(const QString& dir, const QString& name) {
+  std::string path = (fs::path(dir.toStdString()) / name.toStdString()).string();
+  std::string root = root_for(path);
+  if (root.empty() || !application::within_watch_tree(root, path, config_))
     return;
-  std::vector<std::string> current_paths;
-  for (const auto& entry : fs::directory_iterator(base)) {
-    std::string path = entry.path().string();
-    if (is_appimage_path(path))
-      current_paths.push_back(path);
+  track_tree(root, path, true);
+}
+
+void DirectoryWatcher::poll_directories() {
+  std::vector<std::string> dirs;
+  for (const auto& [dir, polled] : polled_)
+    dirs.push_back(dir);
+  for (const auto& dir : dirs) {
+    auto it = polled_.find(dir);
+    if (it == polled_.end())
+      continue;
+    if (!fs::is_directory(fs::path(dir))) {
+      on_directory_lost(QString::fromStdString(dir));
+      continue;
+    }
+    infrastructure::FileStamp stamp = infrastructure::stat_file(dir);
+    auto snapshot = directory_snapshot(dir);
+    bool changed = stamp != it->second.stamp || snapshot != it->second.snapshot;
+    bool promoted = inotify_.add_path(dir);
+    if (promoted) {
+      polled_.erase(it);
+    } else {
+      it->second.stamp = stamp;
+      it->second.snapshot = std::move(snapshot);
+    }
+    if (!changed && !promoted)
+      continue;
+    on_directory_changed(QString::fromStdString(dir));
+    std::string root = root_for(dir);
+    if (config_.recursive && !root.empty())
+      track_tree(root, dir, true);
   }
+  if (polled_.empty())
+    poll_timer_.stop();
+}
+
+void DirectoryWatcher::track_directory(const std::string& dir_path) {
+  tracked_.insert(dir_path);
+  if (inotify_.add_path(dir_path))
+    return;
+  polled_[dir_path] = PolledDirectory{infrastructure::stat_file(dir_path), directory_snapshot(dir_path)};
+  if (inotify_.watch_limit_reached() && !watch_limit_warned_) {
+    watch_limit_warned_ = true;
+    std::cerr << "appimage-manager-daemon: inotify: watch limit reached (fs.inotify.max_user_watches), "
+                 "polling remaining directories every " << poll_interval_ms / 1000 << "s\n";
+  }
+  if (!poll_timer_.isActive())
+    poll_timer_.start();
+}
+
+void DirectoryWatcher::track_tree(const std::string& root, const std::string& dir_path, bool schedule_scan) {
+  for (const auto& dir : application::collect_watch_directories(root, dir_path, config_)) {
+    if (tracked_.count(dir))
+      continue;
+    track_directory(dir);
+    if (schedule_scan)
+      on_directory_changed(QString::fromStdString(dir));
+  }
+}
+
+void DirectoryWatcher::untrack_tree(const std::string& dir_path) {
+  auto untrack = [this](std::set<std::string>::iterator it) {
+    inotify_.remove_path(*it);
+    polled_.erase(*it);
+    pending_.erase(*it);
+    return tracked_.erase(it);
+  };
+  if (auto it = tracked_.find(dir_path); it != tracked_.end())
+    untrack(it);
+  std::string prefix = dir_path + "/";
+  for (auto it = tracked_.lower_bound(prefix); it != tracked_.end() && it->compare(0, prefix.size(), prefix) == 0;)
+    it = untrack(it);
+}
+
+void DirectoryWatcher::remove_records_under(const std::string& dir_path) {
+  std::string prefix = dir_path + "/";
   auto all = registry_->all();
+  domain::RegistryBatch batch(*registry_);
+  domain::LaunchSettingsBatch settings_batch(*launch_settings_repository_);
   for (const auto& record : all) {
-    fs::path rec_path(record.path);
-    if (rec_path.parent_path() != base)
+    if (record.path.compare(0, prefix.size(), prefix) == 0)
+      remove_record(record);
+  }
+}
+
+std::string DirectoryWatcher::root_for(const std::string& dir_path) const {
+  std::string result;
+  for (const auto& root : config_.watch_directories) {
+    if (root.size() > result.size() && application::directory_depth(root, dir_path) >= 0)
+      result = root;
+  }
+  return result;
+}
+
+void DirectoryWatcher::defer(PendingDirectory& pending) {
+  pending.deadline = clock_.elapsed() + config_.quiet_period_ms;
+  if (!flush_timer_.isActive() || flush_timer_.remainingTime() > config_.quiet_period_ms)
+    flush_timer_.start(config_.quiet_period_ms);
+}
+
+void DirectoryWatcher::flush_pending_changes() {
+  qint64 now = clock_.elapsed();
+  bool changed = false;
+  std::vector<std::string> removed_files;
+  std::vector<domain::AppImageRecord> stale;
+  std::vector<std::string> lost_dirs;
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    const std::string& dir = it->first;
+    PendingDirectory& pending = it->second;
+    if (pending.deadline > now) {
+      ++it;
+      continue;
+    }
+    if (pending.lost) {
+      if (!fs::is_directory(fs::path(dir)))
+        lost_dirs.push_back(dir);
+      pending.lost = false;
+    }
+    for (auto file = pending.files.begin(); file != pending.files.end();) {
+      std::string path = (fs::path(dir) / file->first).string();
+      infrastructure::FileStamp stamp = infrastructure::stat_file(path);
+      if (stamp != file->second) {
+        file->second = stamp;
+        ++file;
+        continue;
+      }
+      if (stamp.exists)
+        changed |= apply_file_change(path);
+      else
+        removed_files.push_back(path);
+      file = pending.files.erase(file);
+    }
+    if (pending.full_scan) {
+      auto snapshot = directory_snapshot(dir);
+      if (snapshot != pending.snapshot) {
+        pending.snapshot = std::move(snapshot);
+      } else {
+        auto removed = scan_directory(dir);
+        std::move(removed.begin(), removed.end(), std::back_inserter(stale));
+        changed = true;
+        pending.full_scan = false;
+        pending.snapshot.clear();
+      }
+    }
+    if (pending.files.empty() && !pending.full_scan) {
+      it = pending_.erase(it);
       continue;
-    bool still_exists = std::find(current_paths.begin(), current_paths.end(), record.path) != current_paths.end();
-    if (!still_exists) {
-      registry_->remove_by_path(record.path);
-      std::string icons_dir = (fs::path(applications_dir_).parent_path() / "appimage-manager" / "icons").string();
-      application::remove_desktop(record.id, record.name, applications_dir_);
-      application::remove_icon(record.id, icons_dir);
     }
+    pending.deadline = now + config_.quiet_period_ms;
+    ++it;
   }
+  for (const auto& path : removed_files)
+    changed |= apply_file_change(path);
+  remove_stale_records(stale);
+  for (const auto& dir : lost_dirs)
+    remove_records_under(dir);
+  changed |= !lost_dirs.empty();
+  if (!pending_.empty()) {
+    qint64 next = pending_.begin()->second.deadline;
+    for (const auto& [dir, pending] : pending_)
+      next = std::min(next, pending.deadline);
+    flush_timer_.start(static_cast<int>(std::max<qint64>(0, next - now)));
+  }
+  if (changed)
+    Q_EMIT records_changed();
+}
+
+bool DirectoryWatcher::apply_file_change(const std::string& path) {
+  auto existing = registry_->by_path(path);
+  if (!fs::exists(fs::path(path))) {
+    if (!existing)
+      return false;
+    remove_record(*existing);
+    return true;
+  }
+  auto ensure = [this](const domain::AppImageRecord& record) { ensure_desktop_with_icon(record); };
+  auto added = [this](const domain::AppImageRecord& record) { on_added(record); };
+  return scan_.execute_file(path, added, self_path_, ensure).has_value();
+}
+
+void DirectoryWatcher::resync_directory(const std::string& dir_path) {
+  remove_stale_records(scan_directory(dir_path));
+}
+
+std::unordered_map<std::string, infrastructure::FileStamp> DirectoryWatcher::directory_snapshot(const std::string& dir_path) const {
+  std::unordered_map<std::string, infrastructure::FileStamp> snapshot;
+  std::error_code ec;
+  fs::directory_iterator it(fs::path(dir_path), ec);
+  for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+    std::string path = it->path().string();
+    if (is_appimage_path(path))
+      snapshot.emplace(path, infrastructure::stat_file(path));
+  }
+  return snapshot;
+}
+
+void DirectoryWatcher::on_directory_lost(const QString& dir) {
+  std::string path = dir.toStdString();
+  untrack_tree(path);
+  std::string root = root_for(path);
+  if (root.empty())
+    return;
+  if (fs::is_directory(fs::path(path))) {
+    track_tree(root, path, path != root);
+    return;
+  }
+  if (path == root)
+    return;
+  if (config_.quiet_period_ms <= 0) {
+    remove_records_under(path);
+    Q_EMIT records_changed();
+    return;
+  }
+  PendingDirectory& pending = pending_[path];
+  pending.lost = true;
+  defer(pending);
+}
+
+void DirectoryWatcher::on_events_overflowed() {
+  std::cerr << "appimage-manager-daemon: inotify: event queue overflowed, rescanning\n";
+  for (const auto& root : config_.watch_directories)
+    track_tree(root, root, false);
+  std::vector<std::string> dirs(tracked_.begin(), tracked_.end());
+  std::vector<domain::AppImageRecord> stale;
+  for (const auto& dir : dirs) {
+    auto removed = scan_directory(dir);
+    std::move(removed.begin(), removed.end(), std::back_inserter(stale));
+  }
+  remove_stale_records(stale);
+  Q_EMIT records_changed();
+}
+
+std::vector<domain::AppImageRecord> DirectoryWatcher::scan_directory(const std::string& dir_path) {
+  domain::Config single;
+  single.watch_directories.push_back(dir_path);
+  single.exclude = config_.exclude;
+  auto ensure = [this](const domain::AppImageRecord& record) { ensure_desktop_with_icon(record); };
+  auto added = [this](const domain::AppImageRecord& record) { on_added(record); };
+  std::vector<domain::AppImageRecord> stale;
+  auto removed = [&stale](const domain::AppImageRecord& record) { stale.push_back(record); };
+  scan_.execute(single, added, self_path_, ensure, removed);
+  return stale;
+}
+
+void DirectoryWatcher::ensure_desktop_with_icon(const domain::AppImageRecord& record) {
+  domain::LaunchSettings settings = launch_settings_repository_->load(record.id).value_or(domain::LaunchSettings{});
+  if (icon_worker_pool_) {
+    icon_worker_pool_->enqueue(record, settings);
+    return;
+  }
+  domain::AppImageRecord updated = record;
+  if (auto metadata = refresh_appimage_metadata(record, icons_dir_, probe_cache_)) {
+    updated.metadata = *metadata;
+    updated.fingerprint = metadata->content_hash;
+    registry_->save(updated);
+  }
+  if (application::generate_desktop(updated, settings, applications_dir_) && desktop_database_)
+    desktop_database_->mark_changed();
+}
+
+void DirectoryWatcher::on_added(const domain::AppImageRecord& record) {
+  ensure_desktop_with_icon(record);
+  Q_EMIT record_added(QString::fromStdString(record.id));
+  fs::path p(record.path);
+  notify_appimage_processed(p.filename().string(), p.parent_path().string());
+}
+
+void DirectoryWatcher::on_moved(const domain::AppImageRecord& record, const domain::AppImageRecord& previous) {
+  std::cerr << "appimage-manager-daemon: " << previous.path << " moved to " << record.path << "\n";
+  if (previous.name != record.name && application::remove_desktop(record.id, previous.name, applications_dir_) && desktop_database_)
+    desktop_database_->mark_changed();
+  ensure_desktop_with_icon(record);
+  Q_EMIT record_updated(QString::fromStdString(record.id));
+}
+
+void DirectoryWatcher::remove_record(const domain::AppImageRecord& record) {
+  registry_->remove_by_path(record.path);
+  if (icon_worker_pool_)
+    icon_worker_pool_->forget(record.id);
+  if (probe_cache_)
+    probe_cache_->forget(record.path);
+  launch_settings_repository_->remove(record.id);
+  if (application::remove_desktop(record.id, record.name, applications_dir_) && desktop_database_)
+    desktop_database_->mark_changed();
+  application::remove_icon(record.id, icons_dir_);
+  Q_EMIT record_removed(QString::fromStdString(record.id));
+}
+
+void DirectoryWatcher::remove_stale_records(const std::vector<domain::AppImageRecord>& stale) {
+  if (stale.empty())
+    return;
+  domain::RegistryBatch batch(*registry_);
+  domain::LaunchSettingsBatch settings_batch(*launch_settings_repository_);
+  scan_.remove_stale(stale, [this](const domain::AppImageRecord& record) { remove_record(record); });
 }
 
 }
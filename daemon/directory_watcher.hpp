@@ -3,12 +3,25 @@
 #include <domain/entities/config.hpp>
 #include <domain/repositories/registry_repository.hpp>
 #include <domain/repositories/launch_settings_repository.hpp>
+#include <domain/repositories/directory_snapshot_repository.hpp>
 #include <application/scan_directories.hpp>
+#include <application/scan_pipeline.hpp>
 #include <application/generate_desktop.hpp>
+#include <application/appimage_probe_cache.hpp>
+#include <icon_worker_pool.hpp>
+#include <desktop_database.hpp>
+#include <inotify_watcher.hpp>
+#include <infrastructure/persistence/file_stamp.hpp>
 #include <QObject>
-#include <QFileSystemWatcher>
+#include <QElapsedTimer>
 #include <QStringList>
+#include <QTimer>
+#include <memory>
+#include <optional>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace appimage_manager::daemon {
 
@@ -20,26 +33,99 @@ public:
                   const std::string& applications_dir,
                   const std::string& self_path = "",
                   QObject* parent = nullptr);
+  ~DirectoryWatcher() override;
 
   void set_config(const domain::Config& config);
-  void trigger_rescan();
+  void set_probe_cache(application::AppImageProbeCache* probe_cache);
+  application::AppImageProbeCache* probe_cache() const;
+  void set_snapshot_repository(domain::DirectorySnapshotRepository* snapshots);
+  void set_icon_worker_pool(IconWorkerPool* icon_worker_pool);
+  IconWorkerPool* icon_worker_pool() const;
+  void set_desktop_database(DesktopDatabase* desktop_database);
+  DesktopDatabase* desktop_database() const;
+  void start_rescan();
+  bool is_rescanning() const;
+  int rescan_done() const;
+  int rescan_total() const;
 
 signals:
   void records_changed();
+  void record_added(const QString& record_id);
+  void record_removed(const QString& record_id);
+  void record_updated(const QString& record_id);
+  void rescan_progress(int done, int total);
+  void rescan_finished();
 
 private Q_SLOTS:
   void on_directory_changed(const QString& path);
+  void on_file_changed(const QString& dir, const QString& name);
+  void on_directory_added(const QString& dir, const QString& name);
+  void poll_directories();
+  void flush_pending_changes();
+  void on_directory_lost(const QString& dir);
+  void on_events_overflowed();
+  void rescan_next();
 
 private:
-  void scan_directory(const std::string& dir_path);
-  void remove_stale_records_for_directory(const std::string& dir_path);
+  struct PendingDirectory {
+    std::unordered_map<std::string, infrastructure::FileStamp> files;
+    std::unordered_map<std::string, infrastructure::FileStamp> snapshot;
+    bool full_scan{false};
+    bool lost{false};
+    qint64 deadline{0};
+  };
+
+  struct PolledDirectory {
+    infrastructure::FileStamp stamp;
+    std::unordered_map<std::string, infrastructure::FileStamp> snapshot;
+  };
+
+  void track_directory(const std::string& dir_path);
+  void track_tree(const std::string& root, const std::string& dir_path, bool schedule_scan);
+  void untrack_tree(const std::string& dir_path);
+  void remove_records_under(const std::string& dir_path);
+  std::string root_for(const std::string& dir_path) const;
+  void on_listing_ready(const application::ScanDirectories::DirectoryListing& listing);
+  void schedule_rescan_next();
+  void finish_rescan();
+  void defer(PendingDirectory& pending);
+  bool apply_file_change(const std::string& path);
+  void resync_directory(const std::string& dir_path);
+  std::unordered_map<std::string, infrastructure::FileStamp> directory_snapshot(const std::string& dir_path) const;
+  std::vector<domain::AppImageRecord> scan_directory(const std::string& dir_path);
+  void remove_stale_records(const std::vector<domain::AppImageRecord>& stale);
+  void remove_record(const domain::AppImageRecord& record);
+  void ensure_desktop_with_icon(const domain::AppImageRecord& record);
+  void on_added(const domain::AppImageRecord& record);
+  void on_moved(const domain::AppImageRecord& record, const domain::AppImageRecord& previous);
 
   domain::RegistryRepository* registry_;
   domain::LaunchSettingsRepository* launch_settings_repository_;
   std::string applications_dir_;
+  std::string icons_dir_;
   std::string self_path_;
+  application::AppImageProbeCache* probe_cache_{nullptr};
+  IconWorkerPool* icon_worker_pool_{nullptr};
+  DesktopDatabase* desktop_database_{nullptr};
+  domain::DirectorySnapshotRepository* snapshots_{nullptr};
   domain::Config config_;
-  QFileSystemWatcher watcher_;
+  std::unique_ptr<application::ScanPipeline> rescan_pipeline_;
+  std::optional<application::ScanDirectories::DirectoryListing> rescan_listing_;
+  std::optional<application::DirectoryDelta> rescan_delta_;
+  std::vector<domain::AppImageRecord> rescan_stale_;
+  int rescan_done_{0};
+  int rescan_total_{0};
+  bool rescanning_{false};
+  bool rescan_requested_{false};
+  bool rescan_scheduled_{false};
+  std::unordered_map<std::string, PendingDirectory> pending_;
+  std::set<std::string> tracked_;
+  std::unordered_map<std::string, PolledDirectory> polled_;
+  QTimer poll_timer_;
+  bool watch_limit_warned_{false};
+  QTimer flush_timer_;
+  QElapsedTimer clock_;
+  InotifyWatcher inotify_;
   application::ScanDirectories scan_;
 };
 
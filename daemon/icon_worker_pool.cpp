@@ -0,0 +1,123 @@
+#include "icon_worker_pool.hpp"
+#include "appimage_icon.hpp"
+#include <application/generate_desktop.hpp>
+#include <QCoreApplication>
+#include <QEvent>
+#include <QMetaObject>
+#include <QThread>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace appimage_manager::daemon {
+
+IconWorkerPool::IconWorkerPool(const std::string& applications_dir,
+                               int concurrency,
+                               QObject* parent)
+  : QObject(parent)
+  , applications_dir_(applications_dir)
+  , icons_dir_((fs::path(applications_dir).parent_path() / "appimage-manager" / "icons").string()) {
+  set_concurrency(concurrency);
+}
+
+IconWorkerPool::~IconWorkerPool() {
+  pool_.waitForDone();
+}
+
+void IconWorkerPool::set_concurrency(int concurrency) {
+  pool_.setMaxThreadCount(concurrency > 0 ? concurrency : QThread::idealThreadCount());
+}
+
+void IconWorkerPool::set_probe_cache(application::AppImageProbeCache* probe_cache) {
+  probe_cache_ = probe_cache;
+}
+
+void IconWorkerPool::set_desktop_database(DesktopDatabase* desktop_database) {
+  desktop_database_ = desktop_database;
+}
+
+void IconWorkerPool::set_registry(domain::RegistryRepository* registry) {
+  registry_ = registry;
+}
+
+void IconWorkerPool::enqueue(const domain::AppImageRecord& record, const domain::LaunchSettings& settings) {
+  if (running_.count(record.id)) {
+    requeued_.insert_or_assign(record.id, Job{record, settings});
+    return;
+  }
+  start(Job{record, settings});
+}
+
+bool IconWorkerPool::is_pending(const std::string& record_id) const {
+  return running_.count(record_id) != 0;
+}
+
+void IconWorkerPool::forget(const std::string& record_id) {
+  requeued_.erase(record_id);
+  if (running_.count(record_id))
+    cancelled_.insert(record_id);
+}
+
+void IconWorkerPool::wait_for_done() {
+  while (!running_.empty()) {
+    pool_.waitForDone();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+  }
+}
+
+void IconWorkerPool::start(Job job) {
+  if (!batch_open_) {
+    batch_open_ = true;
+    if (desktop_database_)
+      desktop_database_->begin();
+    if (probe_cache_)
+      probe_cache_->begin();
+  }
+  running_.insert(job.record.id);
+  pool_.start([this, job = std::move(job)]() mutable {
+    auto metadata = refresh_appimage_metadata(job.record, icons_dir_, probe_cache_);
+    if (metadata)
+      job.record.metadata = *metadata;
+    bool changed = application::generate_desktop(job.record, job.settings, applications_dir_);
+    QMetaObject::invokeMethod(this, [this, job, metadata, changed] { finish(job, metadata, changed); }, Qt::QueuedConnection);
+  });
+}
+
+void IconWorkerPool::finish(const Job& job, const std::optional<domain::AppImageMetadata>& metadata, bool desktop_changed) {
+  running_.erase(job.record.id);
+  bool cancelled = cancelled_.erase(job.record.id) > 0;
+  std::optional<domain::AppImageRecord> record = registry_ ? registry_->by_id(job.record.id) : std::nullopt;
+  if (registry_ ? !record : cancelled) {
+    requeued_.erase(job.record.id);
+    desktop_changed |= application::remove_desktop(job.record.id, job.record.name, applications_dir_);
+    application::remove_icon(job.record.id, icons_dir_);
+  }
+  if (metadata && record && record->path == job.record.path && record->metadata != *metadata) {
+    record->metadata = *metadata;
+    record->fingerprint = metadata->content_hash;
+    registry_->save(*record);
+    Q_EMIT metadata_changed(QString::fromStdString(record->id));
+  }
+  auto it = requeued_.find(job.record.id);
+  if (it != requeued_.end()) {
+    Job next = std::move(it->second);
+    requeued_.erase(it);
+    if (metadata && next.record.path == job.record.path)
+      next.record.metadata = *metadata;
+    if (next.record.name != job.record.name)
+      desktop_changed |= application::remove_desktop(job.record.id, job.record.name, applications_dir_);
+    start(std::move(next));
+  }
+  if (desktop_changed && desktop_database_)
+    desktop_database_->mark_changed();
+  Q_EMIT job_finished(QString::fromStdString(job.record.id), QString::fromStdString(job.record.metadata.icon_path));
+  if (running_.empty() && batch_open_) {
+    batch_open_ = false;
+    if (desktop_database_)
+      desktop_database_->commit();
+    if (probe_cache_)
+      probe_cache_->commit();
+  }
+}
+
+}
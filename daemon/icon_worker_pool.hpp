@@ -0,0 +1,60 @@
+#pragma once
+
+#include <domain/entities/app_image_record.hpp>
+#include <domain/entities/launch_settings.hpp>
+#include <domain/repositories/registry_repository.hpp>
+#include <application/appimage_probe_cache.hpp>
+#include <desktop_database.hpp>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace appimage_manager::daemon {
+
+class IconWorkerPool : public QObject {
+  Q_OBJECT
+public:
+  explicit IconWorkerPool(const std::string& applications_dir,
+                          int concurrency = 0,
+                          QObject* parent = nullptr);
+  ~IconWorkerPool() override;
+
+  void set_concurrency(int concurrency);
+  void set_probe_cache(application::AppImageProbeCache* probe_cache);
+  void set_desktop_database(DesktopDatabase* desktop_database);
+  void set_registry(domain::RegistryRepository* registry);
+  void enqueue(const domain::AppImageRecord& record, const domain::LaunchSettings& settings);
+  bool is_pending(const std::string& record_id) const;
+  void forget(const std::string& record_id);
+  void wait_for_done();
+
+signals:
+  void job_finished(const QString& record_id, const QString& icon_path);
+  void metadata_changed(const QString& record_id);
+
+private:
+  struct Job {
+    domain::AppImageRecord record;
+    domain::LaunchSettings settings;
+  };
+
+  void start(Job job);
+  void finish(const Job& job, const std::optional<domain::AppImageMetadata>& metadata, bool desktop_changed);
+
+  std::string applications_dir_;
+  std::string icons_dir_;
+  application::AppImageProbeCache* probe_cache_{nullptr};
+  DesktopDatabase* desktop_database_{nullptr};
+  domain::RegistryRepository* registry_{nullptr};
+  bool batch_open_{false};
+  std::unordered_set<std::string> running_;
+  std::unordered_map<std::string, Job> requeued_;
+  std::unordered_set<std::string> cancelled_;
+  QThreadPool pool_;
+};
+
+}
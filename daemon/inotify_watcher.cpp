@@ -0,0 +1,121 @@
+#include "inotify_watcher.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace appimage_manager::daemon {
+
+namespace {
+
+constexpr std::uint32_t watch_mask =
+  IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+constexpr std::size_t event_buffer_size = 64 * 1024;
+
+}
+
+InotifyWatcher::InotifyWatcher(QObject* parent)
+  : QObject(parent)
+  , fd_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+  if (fd_ < 0)
+    return;
+  notifier_ = new QSocketNotifier(fd_, QSocketNotifier::Read, this);
+  connect(notifier_, &QSocketNotifier::activated, this, &InotifyWatcher::read_events);
+}
+
+InotifyWatcher::~InotifyWatcher() {
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+bool InotifyWatcher::is_valid() const {
+  return fd_ >= 0;
+}
+
+bool InotifyWatcher::add_path(const std::string& dir) {
+  if (fd_ < 0)
+    return false;
+  if (wds_by_path_.count(dir))
+    return true;
+  int wd = ::inotify_add_watch(fd_, dir.c_str(), watch_mask);
+  if (wd < 0) {
+    if (errno == ENOSPC)
+      watch_limit_reached_ = true;
+    return false;
+  }
+  auto previous = paths_by_wd_.find(wd);
+  if (previous != paths_by_wd_.end())
+    wds_by_path_.erase(previous->second);
+  paths_by_wd_[wd] = dir;
+  wds_by_path_[dir] = wd;
+  return true;
+}
+
+void InotifyWatcher::remove_path(const std::string& dir) {
+  auto it = wds_by_path_.find(dir);
+  if (it == wds_by_path_.end())
+    return;
+  ::inotify_rm_watch(fd_, it->second);
+  paths_by_wd_.erase(it->second);
+  wds_by_path_.erase(it);
+}
+
+void InotifyWatcher::clear() {
+  for (const auto& [wd, path] : paths_by_wd_)
+    ::inotify_rm_watch(fd_, wd);
+  paths_by_wd_.clear();
+  wds_by_path_.clear();
+  watch_limit_reached_ = false;
+}
+
+bool InotifyWatcher::watch_limit_reached() const {
+  return watch_limit_reached_;
+}
+
+void InotifyWatcher::read_events() {
+  alignas(inotify_event) char buf[event_buffer_size];
+  for (;;) {
+    ssize_t n = ::read(fd_, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return;
+    for (ssize_t pos = 0; pos < n;) {
+      const auto* event = reinterpret_cast<const inotify_event*>(buf + pos);
+      pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      if (event->mask & IN_Q_OVERFLOW) {
+        Q_EMIT overflowed();
+        continue;
+      }
+      auto it = paths_by_wd_.find(event->wd);
+      if (it == paths_by_wd_.end())
+        continue;
+      QString dir = QString::fromStdString(it->second);
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+        if (event->mask & IN_MOVE_SELF)
+          ::inotify_rm_watch(fd_, event->wd);
+        wds_by_path_.erase(it->second);
+        paths_by_wd_.erase(it);
+        Q_EMIT directory_lost(dir);
+        continue;
+      }
+      if (event->len == 0)
+        continue;
+      QString name = QString::fromLocal8Bit(event->name);
+      if (event->mask & IN_ISDIR) {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO))
+          Q_EMIT directory_added(dir, name);
+        continue;
+      }
+      if (event->mask & IN_CREATE)
+        continue;
+      if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+        Q_EMIT file_written(dir, name);
+      else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+        Q_EMIT file_removed(dir, name);
+    }
+  }
+}
+
+}
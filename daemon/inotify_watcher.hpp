@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QString>
+#include <string>
+#include <unordered_map>
+
+namespace appimage_manager::daemon {
+
+class InotifyWatcher : public QObject {
+  Q_OBJECT
+public:
+  explicit InotifyWatcher(QObject* parent = nullptr);
+  ~InotifyWatcher() override;
+
+  bool is_valid() const;
+  bool add_path(const std::string& dir);
+  void remove_path(const std::string& dir);
+  void clear();
+  bool watch_limit_reached() const;
+
+signals:
+  void file_written(const QString& dir, const QString& name);
+  void file_removed(const QString& dir, const QString& name);
+  void directory_added(const QString& dir, const QString& name);
+  void directory_lost(const QString& dir);
+  void overflowed();
+
+private Q_SLOTS:
+  void read_events();
+
+private:
+  int fd_{-1};
+  bool watch_limit_reached_{false};
+  QSocketNotifier* notifier_{nullptr};
+  std::unordered_map<int, std::string> paths_by_wd_;
+  std::unordered_map<std::string, int> wds_by_path_;
+};
+
+}
@@ -1,10 +1,40 @@
 #include <application/extract_icon.hpp>
+#include <application/squashfs_image.hpp>
+#include <infrastructure/json/json_appimage_probe_cache.hpp>
 #include <QCoreApplication>
 #include <QProcess>
 #include <QStandardPaths>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <optional>
 #include <string>
 
+namespace {
+
+std::string default_cache_dir() {
+  std::string path;
+  if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+    path = xdg;
+  } else {
+    const char* home = std::getenv("HOME");
+    if (!home || !*home)
+      return "";
+    path = home;
+    path += "/.cache";
+  }
+  path += "/appimage-manager";
+  return path;
+}
+
+bool is_listed(const std::string& s) {
+  return (s.size() >= 8u && s.compare(s.size() - 8, 8, ".desktop") == 0) ||
+         (s.size() >= 4u && s.compare(s.size() - 4, 4, ".png") == 0) ||
+         (s.size() >= 4u && s.compare(s.size() - 4, 4, ".svg") == 0);
+}
+
+}
+
 int main(int argc, char* argv[]) {
   QCoreApplication app(argc, argv);
   if (argc < 2) {
@@ -12,11 +42,28 @@ int main(int argc, char* argv[]) {
     return 1;
   }
   std::string path = argv[1];
-  auto offset_opt = appimage_manager::application::get_appimage_squashfs_offset(path);
+  std::optional<std::uint64_t> offset_opt;
+  std::string cache_dir = default_cache_dir();
+  if (!cache_dir.empty()) {
+    appimage_manager::infrastructure::JsonAppImageProbeCache probe_cache(
+      cache_dir, appimage_manager::application::probe_appimage);
+    if (auto probe = probe_cache.probe(path))
+      offset_opt = probe->squashfs_offset;
+  } else {
+    offset_opt = appimage_manager::application::get_appimage_squashfs_offset(path);
+  }
   if (!offset_opt.has_value()) {
     std::cerr << "Could not find SquashFS offset in " << path << "\n";
     return 1;
   }
+  appimage_manager::application::SquashfsImage image(path, offset_opt.value());
+  if (image.is_open()) {
+    for (const auto& entry : image.list()) {
+      if (is_listed(entry))
+        std::cout << "squashfs-root/" << entry << "\n";
+    }
+    return 0;
+  }
   QString unsquashfs = QStandardPaths::findExecutable(QStringLiteral("unsquashfs"));
   if (unsquashfs.isEmpty())
     unsquashfs = QStringLiteral("/usr/bin/unsquashfs");
@@ -40,13 +87,8 @@ int main(int argc, char* argv[]) {
     std::string s = line.constData();
     while (!s.empty() && (s.back() == '\r' || s.back() == '\n'))
       s.pop_back();
-    if (s.size() >= 4u) {
-      bool match = (s.size() >= 8u && s.compare(s.size() - 8, 8, ".desktop") == 0) ||
-                   (s.size() >= 4u && s.compare(s.size() - 4, 4, ".png") == 0) ||
-                   (s.size() >= 4u && s.compare(s.size() - 4, 4, ".svg") == 0);
-      if (match)
-        std::cout << s << "\n";
-    }
+    if (is_listed(s))
+      std::cout << s << "\n";
   }
   return 0;
 }
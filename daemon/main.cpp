@@ -3,21 +3,35 @@
 #include <domain/repositories/config_repository.hpp>
 #include <domain/repositories/registry_repository.hpp>
 #include <domain/repositories/launch_settings_repository.hpp>
-#include <application/scan_directories.hpp>
-#include <application/generate_desktop.hpp>
 #include <infrastructure/json/json_config_repository.hpp>
 #include <infrastructure/json/json_registry_repository.hpp>
 #include <infrastructure/json/json_launch_settings_repository.hpp>
-#include <appimage_icon.hpp>
+#include <infrastructure/json/json_appimage_probe_cache.hpp>
+#include <infrastructure/json/json_directory_snapshot_repository.hpp>
+#include <infrastructure/mmap/mmap_registry_repository.hpp>
+#include <infrastructure/persistence/write_behind_queue.hpp>
+#ifdef APPIMAGE_MANAGER_WITH_SQLITE
+#include <infrastructure/sqlite/sqlite_database.hpp>
+#include <infrastructure/sqlite/sqlite_config_repository.hpp>
+#include <infrastructure/sqlite/sqlite_registry_repository.hpp>
+#include <infrastructure/sqlite/sqlite_launch_settings_repository.hpp>
+#endif
 #include <directory_watcher.hpp>
+#include <icon_worker_pool.hpp>
+#include <desktop_database.hpp>
 #include <dbus_manager_adaptor.hpp>
 #include <QCoreApplication>
 #include <QDBusConnection>
 #include <QDBusError>
+#include <QSocketNotifier>
 #include <iostream>
 #include <cstdlib>
+#include <csignal>
 #include <string>
 #include <filesystem>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
@@ -32,6 +46,45 @@ std::string default_config_dir() {
   return path;
 }
 
+int shutdown_signal_fds[2] = {-1, -1};
+
+void on_shutdown_signal(int) {
+  char c = 1;
+  [[maybe_unused]] ssize_t n = ::write(shutdown_signal_fds[0], &c, 1);
+}
+
+void install_shutdown_handler(QCoreApplication& app) {
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, shutdown_signal_fds) != 0)
+    return;
+  auto* notifier = new QSocketNotifier(shutdown_signal_fds[1], QSocketNotifier::Read, &app);
+  QObject::connect(notifier, &QSocketNotifier::activated, &app, [] {
+    char c;
+    [[maybe_unused]] ssize_t n = ::read(shutdown_signal_fds[1], &c, 1);
+    QCoreApplication::quit();
+  });
+  struct sigaction sa {};
+  sa.sa_handler = on_shutdown_signal;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  ::sigaction(SIGTERM, &sa, nullptr);
+  ::sigaction(SIGINT, &sa, nullptr);
+}
+
+std::string default_cache_dir() {
+  std::string path;
+  if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+    path = xdg;
+  } else {
+    const char* home = std::getenv("HOME");
+    if (!home || !*home)
+      return "";
+    path = home;
+    path += "/.cache";
+  }
+  path += "/appimage-manager";
+  return path;
+}
+
 std::string default_applications_dir() {
   const char* home = std::getenv("HOME");
   if (!home || !*home)
@@ -58,67 +111,88 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
-  appimage_manager::infrastructure::JsonConfigRepository config_repository(config_dir);
-  appimage_manager::domain::Config config = config_repository.load();
+  appimage_manager::infrastructure::WriteBehindQueue persistence_queue;
+  install_shutdown_handler(app);
+  QObject::connect(&app, &QCoreApplication::aboutToQuit, [&persistence_queue] {
+    persistence_queue.flush();
+  });
+
+  appimage_manager::infrastructure::JsonConfigRepository json_config_repository(config_dir, &persistence_queue);
+  appimage_manager::domain::Config config = json_config_repository.load();
   fs::path config_file = fs::path(config_dir) / "config.json";
   if (!fs::is_regular_file(config_file)) {
     fs::create_directories(config_dir);
-    config_repository.save(config);
+    json_config_repository.save(config);
+  }
+
+  appimage_manager::domain::ConfigRepository* config_repository = &json_config_repository;
+  std::unique_ptr<appimage_manager::domain::RegistryRepository> registry_backend;
+  std::unique_ptr<appimage_manager::domain::LaunchSettingsRepository> launch_settings_backend;
+#ifdef APPIMAGE_MANAGER_WITH_SQLITE
+  std::unique_ptr<appimage_manager::infrastructure::SqliteDatabase> database;
+  std::unique_ptr<appimage_manager::infrastructure::SqliteConfigRepository> sqlite_config_repository;
+  if (config.registry_backend == "sqlite") {
+    database = std::make_unique<appimage_manager::infrastructure::SqliteDatabase>(
+      (fs::path(config_dir) / "appimage-manager.db").string());
+    if (database->is_open()) {
+      if (appimage_manager::infrastructure::migrate_json_storage(*database, config_dir))
+        std::cerr << "appimage-manager-daemon: imported JSON storage into appimage-manager.db\n";
+      sqlite_config_repository = std::make_unique<appimage_manager::infrastructure::SqliteConfigRepository>(*database);
+      config_repository = sqlite_config_repository.get();
+      config = config_repository->load();
+      registry_backend = std::make_unique<appimage_manager::infrastructure::SqliteRegistryRepository>(*database);
+      launch_settings_backend = std::make_unique<appimage_manager::infrastructure::SqliteLaunchSettingsRepository>(*database);
+    } else {
+      std::cerr << "appimage-manager-daemon: failed to open appimage-manager.db, using JSON storage\n";
+    }
+  }
+#else
+  if (config.registry_backend == "sqlite")
+    std::cerr << "appimage-manager-daemon: built without SQLite support, using JSON storage\n";
+#endif
+  if (!registry_backend && config.registry_backend == "mmap") {
+    if (appimage_manager::infrastructure::migrate_json_registry(config_dir))
+      std::cerr << "appimage-manager-daemon: migrated registry.json to registry.bin\n";
+    registry_backend = std::make_unique<appimage_manager::infrastructure::MmapRegistryRepository>(config_dir);
   }
+  if (!registry_backend)
+    registry_backend = std::make_unique<appimage_manager::infrastructure::JsonRegistryRepository>(config_dir, &persistence_queue);
+  if (!launch_settings_backend)
+    launch_settings_backend = std::make_unique<appimage_manager::infrastructure::JsonLaunchSettingsRepository>(config_dir, &persistence_queue);
+  appimage_manager::domain::RegistryRepository& registry = *registry_backend;
+  appimage_manager::domain::LaunchSettingsRepository& launch_settings_repository = *launch_settings_backend;
+
   std::cerr << "appimage-manager-daemon: config from " << config_dir << ", watch_directories: "
             << config.watch_directories.size() << "\n";
-  for (const auto& dir : config.watch_directories) {
-    fs::path p(dir);
-    bool exists = fs::exists(p);
-    bool is_dir = fs::is_directory(p);
-    std::cerr << "  " << dir << " exists=" << exists << " is_directory=" << is_dir;
-    if (!is_dir)
-      std::cerr << " (skipped)";
-    std::cerr << "\n";
-  }
+  for (const auto& dir : config.watch_directories)
+    std::cerr << "  " << dir << "\n";
+  appimage_manager::infrastructure::JsonAppImageProbeCache probe_cache(
+    default_cache_dir(), appimage_manager::application::probe_appimage, &persistence_queue);
+  appimage_manager::infrastructure::JsonDirectorySnapshotRepository directory_snapshots(default_cache_dir(), &persistence_queue);
+
   std::string self_path;
   if (const char* appimage = std::getenv("APPIMAGE"))
     self_path = appimage;
 
-  appimage_manager::infrastructure::JsonRegistryRepository registry(config_dir);
-  appimage_manager::infrastructure::JsonLaunchSettingsRepository launch_settings_repository(config_dir);
-  appimage_manager::application::ScanDirectories scan(registry);
-  appimage_manager::domain::LaunchSettings default_settings;
-  std::string icons_dir = (fs::path(applications_dir).parent_path() / "appimage-manager" / "icons").string();
-  auto ensure_desktop_with_icon = [&](const appimage_manager::domain::AppImageRecord& record) {
-    auto settings = launch_settings_repository.load(record.id);
-    appimage_manager::domain::LaunchSettings ls = settings.value_or(default_settings);
-    std::string icon_path = appimage_manager::application::icon_file_path(record.id, icons_dir);
-    if (!fs::is_regular_file(icon_path))
-      icon_path = appimage_manager::daemon::extract_icon_from_appimage(record.path, icons_dir, record.id);
-    appimage_manager::application::generate_desktop(record, ls, applications_dir, icon_path);
-  };
-  auto on_added = [&](const appimage_manager::domain::AppImageRecord& record) {
-    ensure_desktop_with_icon(record);
-  };
-  auto records = scan.execute(config, on_added, self_path, ensure_desktop_with_icon);
-
-  for (const auto& dir : config.watch_directories) {
-    fs::path base(dir);
-    if (!fs::is_directory(base)) continue;
-    std::cerr << "  " << dir << " contents:";
-    int count = 0;
-    for (const auto& entry : fs::directory_iterator(base)) {
-      std::cerr << " " << entry.path().filename().string();
-      ++count;
-    }
-    if (count == 0)
-      std::cerr << " (empty)";
-    std::cerr << "\n";
-  }
+  appimage_manager::daemon::IconWorkerPool icon_worker_pool(applications_dir, config.icon_workers);
+  icon_worker_pool.set_probe_cache(&probe_cache);
+  icon_worker_pool.set_registry(&registry);
+  QObject::connect(&app, &QCoreApplication::aboutToQuit, &icon_worker_pool,
+                   [&icon_worker_pool] { icon_worker_pool.wait_for_done(); });
+
+  appimage_manager::daemon::DesktopDatabase desktop_database(applications_dir);
+  icon_worker_pool.set_desktop_database(&desktop_database);
 
   appimage_manager::daemon::DirectoryWatcher watcher(
     registry, launch_settings_repository, applications_dir, self_path, &app);
-  watcher.set_config(config);
+  watcher.set_probe_cache(&probe_cache);
+  watcher.set_snapshot_repository(&directory_snapshots);
+  watcher.set_icon_worker_pool(&icon_worker_pool);
+  watcher.set_desktop_database(&desktop_database);
 
   QObject* dbus_server = new QObject(&app);
   new appimage_manager::daemon::DBusManagerAdaptor(
-    registry, config_repository, launch_settings_repository, applications_dir, &watcher, dbus_server);
+    registry, *config_repository, launch_settings_repository, applications_dir, &watcher, dbus_server);
 
   QDBusConnection session = QDBusConnection::sessionBus();
   if (!session.registerObject(QStringLiteral("/org/appimage/Manager1"), dbus_server)) {
@@ -134,6 +208,8 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
-  std::cout << "appimage-manager-daemon: running (scanned " << records.size() << " AppImage(s))\n";
+  std::cout << "appimage-manager-daemon: running (" << registry.all().size() << " AppImage(s) registered, indexing)\n";
+  watcher.set_config(config);
+  watcher.start_rescan();
   return app.exec();
 }
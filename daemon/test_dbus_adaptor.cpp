@@ -1,5 +1,9 @@
 #include "dbus_manager_adaptor.hpp"
+#include "desktop_database.hpp"
 #include "desktop_notification.hpp"
+#include "icon_worker_pool.hpp"
+#include "inotify_watcher.hpp"
+#include "directory_watcher.hpp"
 #include <domain/entities/app_image_record.hpp>
 #include <domain/entities/config.hpp>
 #include <domain/entities/install_type.hpp>
@@ -7,8 +11,11 @@
 #include <domain/repositories/config_repository.hpp>
 #include <domain/repositories/registry_repository.hpp>
 #include <domain/repositories/launch_settings_repository.hpp>
+#include <application/generate_desktop.hpp>
 #include <QDBusArgument>
 #include <QCoreApplication>
+#include <QDBusMessage>
+#include <QElapsedTimer>
 #include <QStringLiteral>
 #include <cassert>
 #include <algorithm>
@@ -16,6 +23,7 @@
 #include <filesystem>
 #include <fstream>
 #include <optional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -48,7 +56,15 @@ public:
     for (const auto& r : records) if (r.id == id) return r;
     return std::nullopt;
   }
-  void save(const appimage_manager::domain::AppImageRecord& r) override { records.push_back(r); }
+  void save(const appimage_manager::domain::AppImageRecord& r) override {
+    for (auto& existing : records) {
+      if (existing.id == r.id) {
+        existing = r;
+        return;
+      }
+    }
+    records.push_back(r);
+  }
   void remove_by_path(const std::string&) override {}
   void remove(const std::string& id) override {
     records.erase(std::remove_if(records.begin(), records.end(),
@@ -70,6 +86,24 @@ public:
   void remove(const std::string&) override {}
 };
 
+bool wait_for_job(appimage_manager::daemon::DBusManagerAdaptor& adaptor, uint job_id) {
+  bool finished = false;
+  bool result = false;
+  QObject context;
+  QObject::connect(&adaptor, &appimage_manager::daemon::DBusManagerAdaptor::JobFinished, &context,
+                   [&](uint id, bool success) {
+                     if (id != job_id) return;
+                     finished = true;
+                     result = success;
+                   });
+  QElapsedTimer timer;
+  timer.start();
+  while (!finished && timer.elapsed() < 5000)
+    QCoreApplication::processEvents();
+  assert(finished);
+  return result;
+}
+
 int test_getallrecords_returns_maps_with_required_keys() {
   MockRegistryRepository registry;
   appimage_manager::domain::AppImageRecord r1;
@@ -122,7 +156,7 @@ int test_getallrecords_empty_registry_returns_empty_list() {
   return 0;
 }
 
-int test_remove_appimage_removes_record_and_returns_true() {
+int test_remove_appimage_runs_job_and_removes_record() {
   fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-remove";
   fs::create_directories(tmp);
   fs::path app_path = tmp / "fake.AppImage";
@@ -145,10 +179,26 @@ int test_remove_appimage_removes_record_and_returns_true() {
   appimage_manager::daemon::DBusManagerAdaptor adaptor(
     registry, config_repo, launch_repo, apps_dir, nullptr, &parent);
 
-  bool ok = adaptor.RemoveAppImage(QStringLiteral("id-remove-me"));
-  assert(ok);
+  QStringList removed;
+  qulonglong removed_generation = 0;
+  QObject::connect(&adaptor, &appimage_manager::daemon::DBusManagerAdaptor::RecordRemoved,
+                   [&](const QString& id, const QString& epoch, qulonglong generation) {
+                     assert(epoch == adaptor.GetEpoch());
+                     removed.append(id);
+                     removed_generation = generation;
+                   });
+  assert(adaptor.GetGeneration() == 0);
+  uint job_id = adaptor.RemoveAppImage(QStringLiteral("id-remove-me"));
+  assert(job_id != 0);
+  [[maybe_unused]] bool finished = wait_for_job(adaptor, job_id);
+  assert(finished);
+  assert(removed == QStringList({QStringLiteral("id-remove-me")}));
+  assert(removed_generation == 1 && adaptor.GetGeneration() == 1);
   assert(registry.records.empty());
   assert(!adaptor.GetAllRecords().size());
+  assert(!fs::exists(app_path));
+  [[maybe_unused]] bool waited = adaptor.WaitForJob(job_id, QDBusMessage());
+  assert(waited);
 
   fs::remove_all(tmp);
   return 0;
@@ -159,7 +209,7 @@ int test_notify_appimage_processed_does_not_crash() {
   return 0;
 }
 
-int test_remove_appimage_unknown_id_returns_false() {
+int test_remove_appimage_unknown_id_starts_no_job() {
   MockRegistryRepository registry;
   MockConfigRepository config_repo;
   MockLaunchSettingsRepository launch_repo;
@@ -167,8 +217,334 @@ int test_remove_appimage_unknown_id_returns_false() {
   appimage_manager::daemon::DBusManagerAdaptor adaptor(
     registry, config_repo, launch_repo, "/tmp", nullptr, &parent);
 
-  bool ok = adaptor.RemoveAppImage(QStringLiteral("nonexistent"));
-  assert(!ok);
+  uint job_id = adaptor.RemoveAppImage(QStringLiteral("nonexistent"));
+  assert(job_id == 0);
+  return 0;
+}
+
+int test_set_install_type_emits_record_updated() {
+  StatefulMockRegistryRepository registry;
+  appimage_manager::domain::AppImageRecord r;
+  r.id = "id-update";
+  r.path = "/opt/Update.AppImage";
+  r.name = "Update";
+  registry.records.push_back(r);
+  MockConfigRepository config_repo;
+  MockLaunchSettingsRepository launch_repo;
+  QObject parent;
+  appimage_manager::daemon::DBusManagerAdaptor adaptor(
+    registry, config_repo, launch_repo, "/tmp", nullptr, &parent);
+
+  QVariantList updates;
+  QObject::connect(&adaptor, &appimage_manager::daemon::DBusManagerAdaptor::RecordUpdated,
+                   [&](const QVariantMap& record, const QString& epoch, qulonglong generation) {
+                     assert(epoch == adaptor.GetEpoch());
+                     updates.append(record);
+                     assert(generation == static_cast<qulonglong>(updates.size()));
+                   });
+  [[maybe_unused]] bool updated = adaptor.SetInstallType(QStringLiteral("id-update"), QStringLiteral("GitHub"));
+  [[maybe_unused]] bool missing = adaptor.SetInstallType(QStringLiteral("missing"), QStringLiteral("GitHub"));
+  assert(updated && !missing);
+  assert(updates.size() == 1);
+  QVariantMap m = updates.first().toMap();
+  assert(m.value(QStringLiteral("id")).toString() == QStringLiteral("id-update"));
+  assert(m.value(QStringLiteral("install_type")).toString() == QStringLiteral("GitHub"));
+  assert(adaptor.GetGeneration() == 1);
+  return 0;
+}
+
+int test_get_records_pages_and_projects_fields() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-get-records";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  StatefulMockRegistryRepository registry;
+  for (int i = 0; i < 5; ++i) {
+    appimage_manager::domain::AppImageRecord r;
+    r.id = "id-" + std::to_string(i);
+    r.path = "/opt/App" + std::to_string(i) + ".AppImage";
+    r.name = "App" + std::to_string(i);
+    r.install_type = appimage_manager::domain::InstallType::Direct;
+    registry.records.push_back(r);
+  }
+  MockConfigRepository config_repo;
+  MockLaunchSettingsRepository launch_repo;
+  QObject parent;
+  appimage_manager::daemon::DBusManagerAdaptor adaptor(
+    registry, config_repo, launch_repo, tmp.string(), nullptr, &parent);
+
+  auto all = adaptor.GetRecords(0, 0, {});
+  assert(all.size() == 5);
+  assert(all[4].id == QStringLiteral("id-4") && all[4].install_type == QStringLiteral("Direct"));
+  auto page = adaptor.GetRecords(3, 10, {QStringLiteral("id"), QStringLiteral("name")});
+  assert(page.size() == 2);
+  assert(page[0].id == QStringLiteral("id-3") && page[0].name == QStringLiteral("App3"));
+  assert(page[0].path.isEmpty() && page[0].install_type.isEmpty());
+  assert(adaptor.GetRecords(7, 2, {}).isEmpty());
+
+  QStringList removed;
+  qulonglong current = 0;
+  bool reset = true;
+  QString epoch = adaptor.GetEpoch();
+  QString current_epoch;
+  assert(!epoch.isEmpty());
+  auto unchanged = adaptor.GetRecordsSince(epoch, 0, removed, current, reset, current_epoch);
+  assert(unchanged.isEmpty() && !reset && current == 0 && removed.isEmpty() && current_epoch == epoch);
+  [[maybe_unused]] bool retyped = adaptor.SetInstallType(QStringLiteral("id-1"), QStringLiteral("GitHub"));
+  [[maybe_unused]] bool renamed = adaptor.SetRecordName(QStringLiteral("id-2"), QStringLiteral("Renamed"));
+  [[maybe_unused]] bool retyped_again = adaptor.SetInstallType(QStringLiteral("id-1"), QStringLiteral("Downloaded"));
+  assert(retyped && renamed && retyped_again);
+  uint job_id = adaptor.RemoveAppImage(QStringLiteral("id-3"));
+  [[maybe_unused]] bool removed_job = wait_for_job(adaptor, job_id);
+  assert(removed_job);
+
+  auto changed = adaptor.GetRecordsSince(epoch, 1, removed, current, reset, current_epoch);
+  assert(!reset && current == 4);
+  assert(removed == QStringList({QStringLiteral("id-3")}));
+  assert(changed.size() == 2);
+  assert(changed[0].id == QStringLiteral("id-1") && changed[0].install_type == QStringLiteral("Downloaded"));
+  assert(changed[1].id == QStringLiteral("id-2") && changed[1].name == QStringLiteral("Renamed"));
+
+  removed.clear();
+  auto everything = adaptor.GetRecordsSince(epoch, 99, removed, current, reset, current_epoch);
+  assert(reset && everything.size() == 4 && removed.isEmpty());
+
+  QObject restarted_parent;
+  appimage_manager::daemon::DBusManagerAdaptor restarted(
+    registry, config_repo, launch_repo, tmp.string(), nullptr, &restarted_parent);
+  assert(restarted.GetEpoch() != epoch);
+  auto other_instance = restarted.GetRecordsSince(epoch, 0, removed, current, reset, current_epoch);
+  assert(reset && other_instance.size() == 4 && removed.isEmpty());
+  assert(current == 0 && current_epoch == restarted.GetEpoch());
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_inotify_watcher_reports_file_events() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-inotify";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  appimage_manager::daemon::InotifyWatcher watcher;
+  assert(watcher.is_valid());
+  assert(watcher.add_path(tmp.string()));
+  assert(!watcher.add_path((tmp / "missing").string()));
+  QStringList written;
+  QStringList removed;
+  QObject::connect(&watcher, &appimage_manager::daemon::InotifyWatcher::file_written,
+                   [&](const QString& dir, const QString& name) {
+                     assert(dir == QString::fromStdString(tmp.string()));
+                     written.append(name);
+                   });
+  QObject::connect(&watcher, &appimage_manager::daemon::InotifyWatcher::file_removed,
+                   [&](const QString&, const QString& name) { removed.append(name); });
+  std::ofstream(tmp / "New.AppImage").put('x');
+  fs::rename(tmp / "New.AppImage", tmp / "Moved.AppImage");
+  fs::create_directories(tmp / "subdir");
+  fs::remove(tmp / "Moved.AppImage");
+  QElapsedTimer timer;
+  timer.start();
+  while (removed.size() < 2 && timer.elapsed() < 5000)
+    QCoreApplication::processEvents();
+  assert(written == QStringList({QStringLiteral("New.AppImage"), QStringLiteral("Moved.AppImage")}));
+  assert(removed == QStringList({QStringLiteral("New.AppImage"), QStringLiteral("Moved.AppImage")}));
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_directory_watcher_waits_for_stable_file() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-debounce";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "apps");
+  StatefulMockRegistryRepository registry;
+  MockLaunchSettingsRepository launch_repo;
+  appimage_manager::daemon::DirectoryWatcher watcher(registry, launch_repo, (tmp / "apps").string());
+  appimage_manager::domain::Config config;
+  config.watch_directories.push_back(tmp.string());
+  config.quiet_period_ms = 100;
+  watcher.set_config(config);
+  int added = 0;
+  QObject::connect(&watcher, &appimage_manager::daemon::DirectoryWatcher::record_added,
+                   [&added](const QString&) { ++added; });
+
+  fs::path app_path = tmp / "Growing.AppImage";
+  QElapsedTimer timer;
+  timer.start();
+  for (int chunk = 0; chunk < 8; ++chunk) {
+    std::ofstream(app_path, std::ios::app) << std::string(1024, 'x');
+    while (timer.elapsed() < (chunk + 1) * 60)
+      QCoreApplication::processEvents();
+  }
+  assert(added == 0);
+  timer.restart();
+  while (added == 0 && timer.elapsed() < 5000)
+    QCoreApplication::processEvents();
+  assert(added == 1);
+  assert(registry.records.size() == 1u);
+  assert(registry.records[0].path == app_path.string());
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_directory_watcher_follows_new_subdirectories() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-recursive";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "apps");
+  StatefulMockRegistryRepository registry;
+  MockLaunchSettingsRepository launch_repo;
+  appimage_manager::daemon::DirectoryWatcher watcher(registry, launch_repo, (tmp / "apps").string());
+  appimage_manager::domain::Config config;
+  config.watch_directories.push_back(tmp.string());
+  config.quiet_period_ms = 0;
+  config.recursive = true;
+  config.max_depth = 2;
+  config.exclude = {"skip"};
+  watcher.set_config(config);
+  auto wait_for = [&registry](std::size_t count) {
+    QElapsedTimer timer;
+    timer.start();
+    while (registry.records.size() != count && timer.elapsed() < 5000)
+      QCoreApplication::processEvents();
+    return registry.records.size() == count;
+  };
+
+  fs::create_directories(tmp / "a" / "b");
+  std::ofstream(tmp / "a" / "b" / "Nested.AppImage").put('x');
+  assert(wait_for(1u));
+  assert(registry.records[0].path == (tmp / "a" / "b" / "Nested.AppImage").string());
+  fs::create_directories(tmp / "skip");
+  std::ofstream(tmp / "skip" / "Hidden.AppImage").put('x');
+  fs::create_directories(tmp / "a" / "b" / "c");
+  std::ofstream(tmp / "a" / "b" / "c" / "Deep.AppImage").put('x');
+  std::ofstream(tmp / "a" / "Shallow.AppImage").put('x');
+  assert(wait_for(2u));
+  fs::remove_all(tmp / "a");
+  assert(wait_for(0u));
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_rescan_reports_indexing_and_refreshes_desktop_database_once() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-indexing";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "watch");
+  fs::create_directories(tmp / "apps");
+  for (int i = 0; i < 3; ++i)
+    std::ofstream(tmp / "watch" / ("App" + std::to_string(i) + ".AppImage")).put('x');
+  StatefulMockRegistryRepository registry;
+  MockConfigRepository config_repo;
+  MockLaunchSettingsRepository launch_repo;
+  QObject parent;
+  appimage_manager::daemon::DesktopDatabase desktop_database((tmp / "apps").string());
+  appimage_manager::daemon::DirectoryWatcher watcher(registry, launch_repo, (tmp / "apps").string());
+  watcher.set_desktop_database(&desktop_database);
+  appimage_manager::domain::Config config;
+  config.watch_directories.push_back((tmp / "watch").string());
+  watcher.set_config(config);
+  appimage_manager::daemon::DBusManagerAdaptor adaptor(
+    registry, config_repo, launch_repo, (tmp / "apps").string(), &watcher, &parent);
+
+  uint job = adaptor.TriggerRescan();
+  assert(adaptor.GetStatus().startsWith(QStringLiteral("indexing")));
+  [[maybe_unused]] bool finished = wait_for_job(adaptor, job);
+  assert(finished);
+  assert(adaptor.GetStatus() == QStringLiteral("running"));
+  assert(registry.records.size() == 3u);
+  QElapsedTimer timer;
+  timer.start();
+  while (desktop_database.refresh_count() == 0 && timer.elapsed() < 5000)
+    QCoreApplication::processEvents();
+  assert(desktop_database.refresh_count() == 1);
+
+  job = adaptor.TriggerRescan();
+  finished = wait_for_job(adaptor, job);
+  assert(finished);
+  timer.restart();
+  while (timer.elapsed() < 1500)
+    QCoreApplication::processEvents();
+  assert(desktop_database.refresh_count() == 1);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_trigger_rescan_returns_job_and_finishes() {
+  MockRegistryRepository registry;
+  MockConfigRepository config_repo;
+  MockLaunchSettingsRepository launch_repo;
+  QObject parent;
+  appimage_manager::daemon::DBusManagerAdaptor adaptor(
+    registry, config_repo, launch_repo, "/tmp", nullptr, &parent);
+
+  uint first = adaptor.TriggerRescan();
+  uint second = adaptor.TriggerRescan();
+  assert(first != 0 && second != 0 && first != second);
+  assert(adaptor.GetStatus() == QStringLiteral("running"));
+  assert(adaptor.GetAllRecords().isEmpty());
+  [[maybe_unused]] bool finished = wait_for_job(adaptor, second);
+  [[maybe_unused]] bool waited = adaptor.WaitForJob(first, QDBusMessage());
+  [[maybe_unused]] bool waited_unknown = adaptor.WaitForJob(second + 100, QDBusMessage());
+  assert(finished && waited && !waited_unknown);
+  return 0;
+}
+
+int test_icon_worker_pool_coalesces_jobs_per_record() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-icon-pool";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  fs::path app_path = tmp / "Fake.AppImage";
+  std::ofstream(app_path).put('x');
+  std::string apps_dir = (tmp / "apps").string();
+  fs::create_directories(apps_dir);
+
+  appimage_manager::domain::AppImageRecord r;
+  r.id = "id-pool";
+  r.path = app_path.string();
+  r.name = "Old";
+  appimage_manager::daemon::IconWorkerPool pool(apps_dir, 2);
+  QStringList finished;
+  QObject::connect(&pool, &appimage_manager::daemon::IconWorkerPool::job_finished,
+                   [&finished](const QString& id, const QString&) { finished.append(id); });
+  pool.enqueue(r, {});
+  assert(pool.is_pending(r.id));
+  r.name = "New";
+  pool.enqueue(r, {});
+  pool.enqueue(r, {});
+  pool.wait_for_done();
+
+  assert(!pool.is_pending(r.id));
+  assert(finished == QStringList({QStringLiteral("id-pool"), QStringLiteral("id-pool")}));
+  assert(fs::is_regular_file(appimage_manager::application::desktop_file_path(r.id, "New", apps_dir)));
+  assert(!fs::exists(appimage_manager::application::desktop_file_path(r.id, "Old", apps_dir)));
+
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_icon_worker_pool_forget_drops_removed_record_output() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-icon-pool-forget";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  fs::path app_path = tmp / "Fake.AppImage";
+  std::ofstream(app_path).put('x');
+  std::string apps_dir = (tmp / "apps").string();
+  fs::create_directories(apps_dir);
+
+  appimage_manager::domain::AppImageRecord r;
+  r.id = "id-forgotten";
+  r.path = app_path.string();
+  r.name = "Gone";
+  appimage_manager::daemon::IconWorkerPool pool(apps_dir, 1);
+  QStringList finished;
+  QObject::connect(&pool, &appimage_manager::daemon::IconWorkerPool::job_finished,
+                   [&finished](const QString& id, const QString&) { finished.append(id); });
+  pool.enqueue(r, {});
+  pool.enqueue(r, {});
+  pool.forget(r.id);
+  pool.wait_for_done();
+
+  assert(!pool.is_pending(r.id));
+  assert(finished == QStringList({QStringLiteral("id-forgotten")}));
+  assert(!fs::exists(appimage_manager::application::desktop_file_path(r.id, "Gone", apps_dir)));
+
+  fs::remove_all(tmp);
   return 0;
 }
 
@@ -180,14 +556,32 @@ int main(int argc, char* argv[]) {
     int n = std::atoi(argv[1]);
     if (n == 0) return test_getallrecords_returns_maps_with_required_keys() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     if (n == 1) return test_getallrecords_empty_registry_returns_empty_list() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
-    if (n == 2) return test_remove_appimage_removes_record_and_returns_true() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
-    if (n == 3) return test_remove_appimage_unknown_id_returns_false() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 2) return test_remove_appimage_runs_job_and_removes_record() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 3) return test_remove_appimage_unknown_id_starts_no_job() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     if (n == 4) return test_notify_appimage_processed_does_not_crash() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 5) return test_icon_worker_pool_coalesces_jobs_per_record() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 6) return test_trigger_rescan_returns_job_and_finishes() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 7) return test_set_install_type_emits_record_updated() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 8) return test_get_records_pages_and_projects_fields() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 9) return test_inotify_watcher_reports_file_events() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 10) return test_directory_watcher_waits_for_stable_file() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 11) return test_directory_watcher_follows_new_subdirectories() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 12) return test_rescan_reports_indexing_and_refreshes_desktop_database_once() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (n == 13) return test_icon_worker_pool_forget_drops_removed_record_output() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
   }
   if (test_getallrecords_returns_maps_with_required_keys() != 0) return EXIT_FAILURE;
   if (test_getallrecords_empty_registry_returns_empty_list() != 0) return EXIT_FAILURE;
-  if (test_remove_appimage_removes_record_and_returns_true() != 0) return EXIT_FAILURE;
-  if (test_remove_appimage_unknown_id_returns_false() != 0) return EXIT_FAILURE;
+  if (test_remove_appimage_runs_job_and_removes_record() != 0) return EXIT_FAILURE;
+  if (test_remove_appimage_unknown_id_starts_no_job() != 0) return EXIT_FAILURE;
   if (test_notify_appimage_processed_does_not_crash() != 0) return EXIT_FAILURE;
+  if (test_icon_worker_pool_coalesces_jobs_per_record() != 0) return EXIT_FAILURE;
+  if (test_trigger_rescan_returns_job_and_finishes() != 0) return EXIT_FAILURE;
+  if (test_set_install_type_emits_record_updated() != 0) return EXIT_FAILURE;
+  if (test_get_records_pages_and_projects_fields() != 0) return EXIT_FAILURE;
+  if (test_inotify_watcher_reports_file_events() != 0) return EXIT_FAILURE;
+  if (test_directory_watcher_waits_for_stable_file() != 0) return EXIT_FAILURE;
+  if (test_directory_watcher_follows_new_subdirectories() != 0) return EXIT_FAILURE;
+  if (test_rescan_reports_indexing_and_refreshes_desktop_database_once() != 0) return EXIT_FAILURE;
+  if (test_icon_worker_pool_forget_drops_removed_record_output() != 0) return EXIT_FAILURE;
   return EXIT_SUCCESS;
 }
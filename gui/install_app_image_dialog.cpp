@@ -6,6 +6,7 @@
 #include <QGroupBox>
 #include <QDialogButtonBox>
 #include <QDBusReply>
+#include <QDBusPendingCallWatcher>
 #include <QMessageBox>
 #include <QNetworkRequest>
 #include <QUrl>
@@ -448,12 +449,24 @@ void InstallAppImageDialog::download_finished() {
       }
     }
   }
-  if (dbus_ && dbus_->isValid())
-    dbus_->call(QStringLiteral("TriggerRescan"));
+  uint rescan_job = 0;
+  if (dbus_ && dbus_->isValid()) {
+    QDBusReply<uint> rescan_reply = dbus_->call(QStringLiteral("TriggerRescan"));
+    if (rescan_reply.isValid())
+      rescan_job = rescan_reply.value();
+  }
   if (installed_from_github_) {
     github_mark_attempts_ = 0;
     QMessageBox::information(this, tr("Done"), tr("Downloaded to %1. Daemon will add it to the list.").arg(target_path_));
-    QTimer::singleShot(2000, this, &InstallAppImageDialog::try_mark_github_download);
+    if (rescan_job == 0) {
+      QTimer::singleShot(2000, this, &InstallAppImageDialog::try_mark_github_download);
+      return;
+    }
+    auto* job = new QDBusPendingCallWatcher(dbus_->asyncCall(QStringLiteral("WaitForJob"), rescan_job), this);
+    connect(job, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher* call) {
+      call->deleteLater();
+      try_mark_github_download();
+    });
     return;
   }
   QMessageBox::information(this, tr("Done"), tr("Downloaded to %1. Daemon will add it to the list.").arg(target_path_));
@@ -11,6 +11,8 @@
 #include <QProcess>
 #include <QDBusArgument>
 #include <QDBusReply>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDBusConnection>
 #include <QResizeEvent>
 #include <QProcess>
@@ -27,6 +29,29 @@ namespace {
 constexpr const char* dbus_service = "org.appimage.Manager1";
 constexpr const char* dbus_path = "/org/appimage/Manager1";
 constexpr const char* systemd_unit = "appimage-manager";
+constexpr uint records_page_size = 500;
+
+QList<QVariantMap> read_records(const QVariant& value) {
+  QList<QVariantMap> records;
+  const QDBusArgument arg = value.value<QDBusArgument>();
+  arg.beginArray();
+  while (!arg.atEnd()) {
+    QString id, path, name, install_type, added_at, version, summary;
+    arg.beginStructure();
+    arg >> id >> path >> name >> install_type >> added_at >> version >> summary;
+    arg.endStructure();
+    QVariantMap m;
+    m.insert(QStringLiteral("id"), id);
+    m.insert(QStringLiteral("path"), path);
+    m.insert(QStringLiteral("name"), name);
+    m.insert(QStringLiteral("install_type"), install_type);
+    m.insert(QStringLiteral("version"), version);
+    m.insert(QStringLiteral("summary"), summary);
+    records.append(m);
+  }
+  arg.endArray();
+  return records;
+}
 
 }
 
@@ -34,10 +59,19 @@ MainWindow::MainWindow(QWidget* parent)
   : QMainWindow(parent)
   , dbus_(new QDBusInterface(dbus_service, dbus_path, dbus_service,
                              QDBusConnection::sessionBus(), this))
-  , status_timer_(new QTimer(this)) {
+  , service_watcher_(new QDBusServiceWatcher(dbus_service, QDBusConnection::sessionBus(),
+                                             QDBusServiceWatcher::WatchForOwnerChange, this)) {
   setup_ui();
-  connect(status_timer_, &QTimer::timeout, this, &MainWindow::refresh_daemon_status);
-  status_timer_->start(2000);
+  connect(service_watcher_, &QDBusServiceWatcher::serviceOwnerChanged, this, &MainWindow::refresh_daemon_status);
+  QDBusConnection bus = QDBusConnection::sessionBus();
+  bus.connect(dbus_service, dbus_path, dbus_service, QStringLiteral("RecordAdded"),
+              this, SLOT(on_record_changed(QVariantMap,QString,qulonglong)));
+  bus.connect(dbus_service, dbus_path, dbus_service, QStringLiteral("RecordUpdated"),
+              this, SLOT(on_record_changed(QVariantMap,QString,qulonglong)));
+  bus.connect(dbus_service, dbus_path, dbus_service, QStringLiteral("RecordRemoved"),
+              this, SLOT(on_record_removed(QString,QString,qulonglong)));
+  bus.connect(dbus_service, dbus_path, dbus_service, QStringLiteral("StatusChanged"),
+              this, SLOT(on_status_changed(QString)));
   refresh_daemon_status();
   QTimer::singleShot(800, this, &MainWindow::refresh_daemon_status);
 }
@@ -141,11 +175,15 @@ void MainWindow::show_table_context_menu(const QPoint& pos) {
     remove_app();
 }
 
-bool MainWindow::is_daemon_running() const {
+bool MainWindow::is_daemon_running() {
+  daemon_status_.clear();
   if (!dbus_->isValid())
     return false;
   QDBusReply<QString> reply = dbus_->call(QStringLiteral("GetStatus"));
-  return reply.isValid() && reply.value() == QLatin1String("running");
+  if (!reply.isValid())
+    return false;
+  daemon_status_ = reply.value();
+  return daemon_status_ == QLatin1String("running") || daemon_status_.startsWith(QLatin1String("indexing"));
 }
 
 void MainWindow::refresh_daemon_status() {
@@ -157,15 +195,27 @@ void MainWindow::refresh_daemon_status() {
     return;
   }
   if (refresh_skip_until_ > 0 && QDateTime::currentMSecsSinceEpoch() < refresh_skip_until_) {
-    status_label_->setText(tr("Daemon: running (%1 app(s))").arg(table_->rowCount()));
+    update_status_label();
     return;
   }
   if (!refresh_list())
     status_label_->setText(tr("Daemon: running (list unavailable)"));
+  else
+    update_status_label();
+}
+
+void MainWindow::update_status_label() {
+  if (daemon_status_.startsWith(QLatin1String("indexing")))
+    status_label_->setText(tr("Daemon: indexing %1 (%2 app(s))").arg(daemon_status_.mid(9)).arg(table_->rowCount()));
   else
     status_label_->setText(tr("Daemon: running (%1 app(s))").arg(table_->rowCount()));
 }
 
+void MainWindow::on_status_changed(const QString& status) {
+  daemon_status_ = status;
+  update_status_label();
+}
+
 bool MainWindow::is_autostart_enabled() const {
   QProcess proc;
   proc.setProgram(QStringLiteral("systemctl"));
@@ -197,24 +247,32 @@ void MainWindow::resizeEvent(QResizeEvent* event) {
 
 bool MainWindow::refresh_list() {
   if (!dbus_->isValid()) return false;
-  QDBusReply<QVariantList> reply = dbus_->call(QStringLiteral("GetAllRecords"));
-  if (!reply.isValid()) return false;
+  QDBusReply<QString> epoch = dbus_->call(QStringLiteral("GetEpoch"));
+  QDBusReply<qulonglong> generation = dbus_->call(QStringLiteral("GetGeneration"));
+  const QStringList fields = { QStringLiteral("id"), QStringLiteral("path"), QStringLiteral("name"), QStringLiteral("install_type"),
+                               QStringLiteral("version"), QStringLiteral("summary") };
+  QList<QVariantMap> list;
+  for (uint offset = 0;;) {
+    QDBusMessage reply = dbus_->call(QStringLiteral("GetRecords"), offset, records_page_size, fields);
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty())
+      return false;
+    QList<QVariantMap> page = read_records(reply.arguments().first());
+    list += page;
+    if (page.size() < static_cast<qsizetype>(records_page_size))
+      break;
+    offset += records_page_size;
+  }
+  epoch_ = epoch.isValid() ? epoch.value() : QString();
+  generation_ = generation.isValid() ? generation.value() : 0;
+  list_stale_ = false;
   QString saved_id = selected_app_id();
-  const QVariantList list = reply.value();
   suppress_name_edit_ = true;
   table_->setSortingEnabled(false);
   table_->setRowCount(0);
-  for (const QVariant& v : list) {
-    QVariantMap m = qdbus_cast<QVariantMap>(v);
-    QString id = m.value(QStringLiteral("id")).toString();
+  for (const QVariantMap& m : list) {
     int row = table_->rowCount();
     table_->insertRow(row);
-    auto* name_item = new QTableWidgetItem(m.value(QStringLiteral("name")).toString());
-    name_item->setData(Qt::UserRole, id);
-    name_item->setFlags(name_item->flags() | Qt::ItemIsEditable);
-    table_->setItem(row, 0, name_item);
-    table_->setItem(row, 1, new QTableWidgetItem(m.value(QStringLiteral("path")).toString()));
-    table_->setItem(row, 2, new QTableWidgetItem(m.value(QStringLiteral("install_type")).toString()));
+    set_row(row, m);
   }
   table_->setSortingEnabled(true);
   suppress_name_edit_ = false;
@@ -232,6 +290,100 @@ bool MainWindow::refresh_list() {
   return true;
 }
 
+int MainWindow::row_for_id(const QString& app_id) const {
+  for (int row = 0; row < table_->rowCount(); ++row) {
+    QTableWidgetItem* item = table_->item(row, 0);
+    if (item && item->data(Qt::UserRole).toString() == app_id)
+      return row;
+  }
+  return -1;
+}
+
+void MainWindow::set_row(int row, const QVariantMap& record) {
+  auto* name_item = new QTableWidgetItem(record.value(QStringLiteral("name")).toString());
+  name_item->setData(Qt::UserRole, record.value(QStringLiteral("id")).toString());
+  name_item->setFlags(name_item->flags() | Qt::ItemIsEditable);
+  QStringList details;
+  if (!record.value(QStringLiteral("summary")).toString().isEmpty())
+    details.append(record.value(QStringLiteral("summary")).toString());
+  if (!record.value(QStringLiteral("version")).toString().isEmpty())
+    details.append(tr("Version %1").arg(record.value(QStringLiteral("version")).toString()));
+  name_item->setToolTip(details.join(QLatin1Char('\n')));
+  table_->setItem(row, 0, name_item);
+  table_->setItem(row, 1, new QTableWidgetItem(record.value(QStringLiteral("path")).toString()));
+  table_->setItem(row, 2, new QTableWidgetItem(record.value(QStringLiteral("install_type")).toString()));
+}
+
+bool MainWindow::accept_generation(const QString& epoch, qulonglong generation) {
+  bool same_epoch = epoch == epoch_;
+  if (same_epoch && generation <= generation_)
+    return false;
+  if (refresh_skip_until_ > 0 && QDateTime::currentMSecsSinceEpoch() < refresh_skip_until_) {
+    list_stale_ = true;
+    return false;
+  }
+  if (!same_epoch || generation != generation_ + 1 || list_stale_) {
+    if (!apply_changes_since())
+      refresh_list();
+    update_status_label();
+    return false;
+  }
+  generation_ = generation;
+  return true;
+}
+
+bool MainWindow::apply_changes_since() {
+  QDBusMessage reply = dbus_->call(QStringLiteral("GetRecordsSince"), epoch_, generation_);
+  if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().size() < 5)
+    return false;
+  const QVariantList args = reply.arguments();
+  if (args.at(3).toBool() || args.at(4).toString() != epoch_)
+    return false;
+  suppress_name_edit_ = true;
+  table_->setSortingEnabled(false);
+  for (const QVariantMap& record : read_records(args.at(0)))
+    upsert_row(record);
+  for (const QString& id : args.at(1).toStringList()) {
+    int row = row_for_id(id);
+    if (row >= 0)
+      table_->removeRow(row);
+  }
+  table_->setSortingEnabled(true);
+  suppress_name_edit_ = false;
+  generation_ = args.at(2).toULongLong();
+  list_stale_ = false;
+  return true;
+}
+
+void MainWindow::upsert_row(const QVariantMap& record) {
+  int row = row_for_id(record.value(QStringLiteral("id")).toString());
+  if (row < 0) {
+    row = table_->rowCount();
+    table_->insertRow(row);
+  }
+  set_row(row, record);
+}
+
+void MainWindow::on_record_changed(const QVariantMap& record, const QString& epoch, qulonglong generation) {
+  if (!accept_generation(epoch, generation))
+    return;
+  suppress_name_edit_ = true;
+  table_->setSortingEnabled(false);
+  upsert_row(record);
+  table_->setSortingEnabled(true);
+  suppress_name_edit_ = false;
+  update_status_label();
+}
+
+void MainWindow::on_record_removed(const QString& app_id, const QString& epoch, qulonglong generation) {
+  if (!accept_generation(epoch, generation))
+    return;
+  int row = row_for_id(app_id);
+  if (row >= 0)
+    table_->removeRow(row);
+  update_status_label();
+}
+
 void MainWindow::start_daemon() {
   QProcess proc;
   proc.setProgram(QStringLiteral("systemctl"));
@@ -339,14 +491,23 @@ void MainWindow::remove_app() {
     return;
   }
   
-  QDBusReply<bool> dbus_reply = dbus_->call(QStringLiteral("RemoveAppImage"), id);
-  if (!dbus_reply.isValid() || !dbus_reply.value()) {
+  QDBusReply<uint> dbus_reply = dbus_->call(QStringLiteral("RemoveAppImage"), id);
+  if (!dbus_reply.isValid() || dbus_reply.value() == 0) {
     QMessageBox::warning(this, tr("Error"), tr("Failed to remove AppImage."));
     return;
   }
   
-  QMessageBox::information(this, tr("Done"), tr("AppImage removed successfully."));
-  refresh_list();
+  auto* job = new QDBusPendingCallWatcher(dbus_->asyncCall(QStringLiteral("WaitForJob"), dbus_reply.value()), this);
+  connect(job, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher* call) {
+    QDBusPendingReply<bool> reply = *call;
+    call->deleteLater();
+    if (reply.isError() || !reply.value()) {
+      QMessageBox::warning(this, tr("Error"), tr("Failed to remove AppImage."));
+      return;
+    }
+    QMessageBox::information(this, tr("Done"), tr("AppImage removed successfully."));
+    refresh_list();
+  });
 }
 
 void MainWindow::run_app() {
@@ -401,6 +562,8 @@ void MainWindow::on_table_item_changed(QTableWidgetItem* item) {
       refresh_list();
   } else {
     refresh_skip_until_ = 0;
+    if (list_stale_)
+      refresh_list();
   }
 }
 
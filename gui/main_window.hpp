@@ -6,6 +6,8 @@
 #include <QPushButton>
 #include <QAction>
 #include <QDBusInterface>
+#include <QDBusServiceWatcher>
+#include <QVariantMap>
 #include <QTimer>
 #include <QResizeEvent>
 
@@ -33,16 +35,25 @@ private Q_SLOTS:
   void run_app();
   void on_table_item_changed(QTableWidgetItem* item);
   void show_table_context_menu(const QPoint& pos);
+  void on_record_changed(const QVariantMap& record, const QString& epoch, qulonglong generation);
+  void on_record_removed(const QString& app_id, const QString& epoch, qulonglong generation);
+  void on_status_changed(const QString& status);
 
 private:
   bool eventFilter(QObject* obj, QEvent* e) override;
   void setup_ui();
   void start_rename_at_current_row();
-  bool is_daemon_running() const;
+  bool is_daemon_running();
   bool is_autostart_enabled() const;
   void update_daemon_buttons();
   void update_table_last_column_width();
   QString selected_app_id() const;
+  int row_for_id(const QString& app_id) const;
+  void set_row(int row, const QVariantMap& record);
+  void upsert_row(const QVariantMap& record);
+  bool apply_changes_since();
+  bool accept_generation(const QString& epoch, qulonglong generation);
+  void update_status_label();
 
   QTableWidget* table_{nullptr};
   QLabel* status_label_{nullptr};
@@ -55,9 +66,13 @@ private:
   QPushButton* install_btn_{nullptr};
   QPushButton* run_btn_{nullptr};
   QDBusInterface* dbus_{nullptr};
-  QTimer* status_timer_{nullptr};
+  QDBusServiceWatcher* service_watcher_{nullptr};
   bool suppress_name_edit_{false};
+  bool list_stale_{false};
   qint64 refresh_skip_until_{0};
+  QString epoch_;
+  qulonglong generation_{0};
+  QString daemon_status_;
 };
 
 }
@@ -0,0 +1,333 @@
+#include "appimage_metadata.hpp"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <sstream>
+#include <string_view>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace appimage_manager::application {
+
+namespace {
+
+constexpr std::array<std::pair<std::string_view, std::string_view>, 14> icon_search_paths = {{
+  {"usr/share/icons/hicolor/512x512/apps/", ".png"},
+  {"usr/share/icons/hicolor/256x256/apps/", ".png"},
+  {"usr/share/icons/hicolor/128x128/apps/", ".png"},
+  {"usr/share/icons/hicolor/96x96/apps/", ".png"},
+  {"usr/share/icons/hicolor/scalable/apps/", ".svg"},
+  {"usr/share/pixmaps/", ".png"},
+  {"usr/share/pixmaps/", ".svg"},
+  {"resources/icons/", ".png"},
+  {"resources/icons/", ".svg"},
+  {"usr/share/icons/hicolor/64x64/apps/", ".png"},
+  {"usr/share/icons/hicolor/48x48/apps/", ".png"},
+  {"usr/share/icons/hicolor/32x32/apps/", ".png"},
+  {"", ".png"},
+  {"", ".svg"},
+}};
+
+constexpr std::array<std::string_view, 2> metainfo_dirs = {"usr/share/metainfo/", "usr/share/appdata/"};
+constexpr std::string_view applications_dir = "usr/share/applications/";
+
+bool ends_with(const std::string& s, std::string_view suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string trim(const std::string& s) {
+  std::size_t start = s.find_first_not_of(" \t\r\n");
+  if (start == std::string::npos)
+    return {};
+  std::size_t end = s.find_last_not_of(" \t\r\n");
+  return s.substr(start, end - start + 1);
+}
+
+std::string unescape_desktop_value(const std::string& value) {
+  std::string out;
+  out.reserve(value.size());
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    if (value[i] != '\\' || i + 1 == value.size()) {
+      out += value[i];
+      continue;
+    }
+    char c = value[++i];
+    switch (c) {
+      case 's': out += ' '; break;
+      case 'n': out += '\n'; break;
+      case 't': out += '\t'; break;
+      case 'r': out += '\r'; break;
+      default: out += c; break;
+    }
+  }
+  return out;
+}
+
+std::vector<std::string> split_desktop_list(const std::string& value) {
+  std::vector<std::string> items;
+  std::string current;
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    if (value[i] == '\\' && i + 1 < value.size()) {
+      current += value[i];
+      current += value[++i];
+    } else if (value[i] == ';') {
+      std::string item = trim(unescape_desktop_value(current));
+      if (!item.empty())
+        items.push_back(std::move(item));
+      current.clear();
+    } else {
+      current += value[i];
+    }
+  }
+  std::string item = trim(unescape_desktop_value(current));
+  if (!item.empty())
+    items.push_back(std::move(item));
+  return items;
+}
+
+std::string decode_xml_entities(const std::string& text) {
+  static constexpr std::array<std::pair<std::string_view, char>, 5> entities = {{
+    {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''},
+  }};
+  std::string out;
+  out.reserve(text.size());
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    bool decoded = false;
+    if (text[i] == '&') {
+      for (const auto& [entity, c] : entities) {
+        if (text.compare(i, entity.size(), entity) == 0) {
+          out += c;
+          i += entity.size() - 1;
+          decoded = true;
+          break;
+        }
+      }
+    }
+    if (!decoded)
+      out += text[i];
+  }
+  return out;
+}
+
+std::string xml_start_tag(const std::string& xml, const std::string& tag, std::size_t& pos) {
+  std::string open = "<" + tag;
+  while ((pos = xml.find(open, pos)) != std::string::npos) {
+    std::size_t after = pos + open.size();
+    std::size_t close = xml.find('>', after);
+    if (close == std::string::npos)
+      return {};
+    char next = after < xml.size() ? xml[after] : '\0';
+    if (next == '>' || next == '/' || next == ' ' || next == '\t' || next == '\n' || next == '\r') {
+      std::string attributes = xml.substr(after, close - after);
+      pos = close + 1;
+      return attributes.empty() ? std::string(" ") : attributes;
+    }
+    pos = after;
+  }
+  return {};
+}
+
+std::string xml_element_text(const std::string& xml, const std::string& tag) {
+  std::size_t pos = 0;
+  std::string attributes;
+  while (!(attributes = xml_start_tag(xml, tag, pos)).empty()) {
+    if (attributes.find("xml:lang") != std::string::npos || attributes.back() == '/')
+      continue;
+    std::size_t end = xml.find("</" + tag, pos);
+    if (end == std::string::npos)
+      return {};
+    return trim(decode_xml_entities(xml.substr(pos, end - pos)));
+  }
+  return {};
+}
+
+std::string xml_attribute(const std::string& attributes, const std::string& name) {
+  std::size_t pos = 0;
+  while ((pos = attributes.find(name, pos)) != std::string::npos) {
+    std::size_t eq = attributes.find_first_not_of(" \t", pos + name.size());
+    bool starts_word = pos == 0 || attributes[pos - 1] == ' ' || attributes[pos - 1] == '\t' || attributes[pos - 1] == '\n';
+    pos += name.size();
+    if (!starts_word || eq == std::string::npos || attributes[eq] != '=')
+      continue;
+    std::size_t quote = attributes.find_first_not_of(" \t", eq + 1);
+    if (quote == std::string::npos || (attributes[quote] != '"' && attributes[quote] != '\''))
+      return {};
+    std::size_t end = attributes.find(attributes[quote], quote + 1);
+    if (end == std::string::npos)
+      return {};
+    return decode_xml_entities(attributes.substr(quote + 1, end - quote - 1));
+  }
+  return {};
+}
+
+std::string icon_name_from_value(const std::string& icon_value) {
+  std::string icon_name = icon_value;
+  std::size_t slash = icon_name.rfind('/');
+  if (slash != std::string::npos)
+    icon_name = icon_name.substr(slash + 1);
+  std::size_t dot = icon_name.rfind('.');
+  if (dot != std::string::npos && dot > 0)
+    icon_name = icon_name.substr(0, dot);
+  return icon_name;
+}
+
+}
+
+bool looks_like_image_data(const std::string& data) {
+  if (data.size() < 8)
+    return false;
+  auto buf = [&data](std::size_t i) { return static_cast<std::uint8_t>(data[i]); };
+  if (buf(0) == 0x89 && buf(1) == 0x50 && buf(2) == 0x4E && buf(3) == 0x47)
+    return true;
+  if (buf(0) == '<' && (buf(1) == '?' || buf(1) == 's') &&
+      (buf(2) == 'x' || buf(2) == 'v') && (buf(3) == 'm' || buf(3) == 'g'))
+    return true;
+  if (buf(0) == '<' && buf(1) == 's' && buf(2) == 'v' && buf(3) == 'g')
+    return true;
+  return false;
+}
+
+std::string pick_desktop_entry(const std::vector<std::string>& paths) {
+  std::string root_desktop;
+  std::string applications_desktop;
+  std::string fallback_desktop;
+  for (const auto& candidate : paths) {
+    if (!ends_with(candidate, ".desktop"))
+      continue;
+    if (candidate.find('/') == std::string::npos && root_desktop.empty())
+      root_desktop = candidate;
+    else if (candidate.compare(0, applications_dir.size(), applications_dir) == 0 && applications_desktop.empty())
+      applications_desktop = candidate;
+    else if (fallback_desktop.empty())
+      fallback_desktop = candidate;
+  }
+  return !root_desktop.empty() ? root_desktop : (!applications_desktop.empty() ? applications_desktop : fallback_desktop);
+}
+
+std::string pick_metainfo_entry(const std::vector<std::string>& paths) {
+  for (std::string_view dir : metainfo_dirs) {
+    for (const auto& candidate : paths) {
+      if (candidate.compare(0, dir.size(), dir) == 0 &&
+          candidate.find('/', dir.size()) == std::string::npos &&
+          (ends_with(candidate, ".metainfo.xml") || ends_with(candidate, ".appdata.xml")))
+        return candidate;
+    }
+  }
+  return {};
+}
+
+std::string parse_desktop_entry(const std::string& content, domain::AppImageMetadata& metadata) {
+  std::istringstream in(content);
+  std::string line;
+  std::string icon_value;
+  bool in_entry = false;
+  while (std::getline(in, line)) {
+    std::string trimmed = trim(line);
+    if (trimmed.empty() || trimmed.front() == '#')
+      continue;
+    if (trimmed.front() == '[') {
+      in_entry = trimmed == "[Desktop Entry]";
+      continue;
+    }
+    std::size_t eq = trimmed.find('=');
+    if (!in_entry || eq == std::string::npos)
+      continue;
+    std::string key = trim(trimmed.substr(0, eq));
+    std::string value = trim(trimmed.substr(eq + 1));
+    if (key == "Name")
+      metadata.name = unescape_desktop_value(value);
+    else if (key == "Comment")
+      metadata.summary = unescape_desktop_value(value);
+    else if (key == "Categories")
+      metadata.categories = split_desktop_list(value);
+    else if (key == "MimeType")
+      metadata.mime_types = split_desktop_list(value);
+    else if (key == "StartupWMClass")
+      metadata.startup_wm_class = unescape_desktop_value(value);
+    else if (key == "X-AppImage-Version")
+      metadata.version = unescape_desktop_value(value);
+    else if (key == "Icon")
+      icon_value = unescape_desktop_value(value);
+  }
+  return icon_value;
+}
+
+void parse_appstream(const std::string& content, domain::AppImageMetadata& metadata) {
+  std::string id = xml_element_text(content, "id");
+  if (!id.empty())
+    metadata.appstream_id = id;
+  if (metadata.name.empty())
+    metadata.name = xml_element_text(content, "name");
+  std::string summary = xml_element_text(content, "summary");
+  if (!summary.empty())
+    metadata.summary = summary;
+  if (metadata.version.empty()) {
+    std::size_t pos = 0;
+    std::string attributes = xml_start_tag(content, "release", pos);
+    if (!attributes.empty())
+      metadata.version = xml_attribute(attributes, "version");
+  }
+}
+
+std::vector<std::string> icon_candidates(const std::string& appimage_path, const std::string& icon_value) {
+  std::vector<std::string> candidates;
+  candidates.push_back(fs::path(appimage_path).stem().string() + ".png");
+  if (icon_value.empty())
+    return candidates;
+  if (icon_value.find('/') != std::string::npos) {
+    std::string rel_path = icon_value;
+    if (rel_path.front() == '/')
+      rel_path.erase(0, 1);
+    if (!rel_path.empty())
+      candidates.push_back(rel_path);
+  }
+  std::string icon_name = icon_name_from_value(icon_value);
+  for (const auto& [prefix, ext] : icon_search_paths)
+    candidates.push_back(std::string(prefix) + icon_name + std::string(ext));
+  return candidates;
+}
+
+std::optional<AppImageContents> read_appimage_contents(const SquashfsImage& image,
+                                                       const std::string& appimage_path) {
+  if (!image.is_open())
+    return std::nullopt;
+  AppImageContents contents;
+  std::vector<std::string> paths = image.list("");
+  for (std::string_view dir : {applications_dir, metainfo_dirs[0], metainfo_dirs[1]}) {
+    std::vector<std::string> entries = image.list(std::string(dir));
+    paths.insert(paths.end(), std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+  }
+  std::string icon_value;
+  std::string desktop_path = pick_desktop_entry(paths);
+  if (!desktop_path.empty()) {
+    if (auto desktop = image.read_file(desktop_path))
+      icon_value = parse_desktop_entry(*desktop, contents.metadata);
+  }
+  std::string metainfo_path = pick_metainfo_entry(paths);
+  if (!metainfo_path.empty()) {
+    if (auto metainfo = image.read_file(metainfo_path))
+      parse_appstream(*metainfo, contents.metadata);
+  }
+  auto try_entry = [&](const std::string& rel_path, bool check_data) {
+    auto resolved = image.resolve(rel_path);
+    if (!resolved)
+      return false;
+    auto data = image.read_file(*resolved);
+    if (!data || (check_data && !looks_like_image_data(*data)))
+      return false;
+    contents.icon_entry = *resolved;
+    contents.icon_data = std::move(*data);
+    return true;
+  };
+  if (!try_entry(".DirIcon", true)) {
+    for (const auto& candidate : icon_candidates(appimage_path, icon_value)) {
+      if (try_entry(candidate, false))
+        break;
+    }
+  }
+  return contents;
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "squashfs_image.hpp"
+#include <domain/entities/app_image_metadata.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace appimage_manager::application {
+
+struct AppImageContents {
+  domain::AppImageMetadata metadata;
+  std::string icon_entry;
+  std::string icon_data;
+};
+
+bool looks_like_image_data(const std::string& data);
+
+std::string pick_desktop_entry(const std::vector<std::string>& paths);
+
+std::string pick_metainfo_entry(const std::vector<std::string>& paths);
+
+std::string parse_desktop_entry(const std::string& content, domain::AppImageMetadata& metadata);
+
+void parse_appstream(const std::string& content, domain::AppImageMetadata& metadata);
+
+std::vector<std::string> icon_candidates(const std::string& appimage_path, const std::string& icon_value);
+
+std::optional<AppImageContents> read_appimage_contents(const SquashfsImage& image,
+                                                       const std::string& appimage_path);
+
+}
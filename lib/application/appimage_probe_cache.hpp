@@ -0,0 +1,18 @@
+#pragma once
+
+#include "extract_icon.hpp"
+#include <optional>
+#include <string>
+
+namespace appimage_manager::application {
+
+class AppImageProbeCache {
+public:
+  virtual ~AppImageProbeCache() = default;
+  virtual std::optional<AppImageProbe> probe(const std::string& appimage_path) = 0;
+  virtual void forget(const std::string& appimage_path) = 0;
+  virtual void begin() {}
+  virtual void commit() {}
+};
+
+}
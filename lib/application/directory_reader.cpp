@@ -0,0 +1,297 @@
+#include "directory_reader.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#if defined(APPIMAGE_MANAGER_HAVE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/sysmacros.h>
+#endif
+
+namespace appimage_manager::application {
+
+namespace {
+
+constexpr std::size_t dirent_buffer_size = 64 * 1024;
+
+EntryType entry_type(unsigned char d_type) {
+  switch (d_type) {
+    case DT_REG: return EntryType::Regular;
+    case DT_DIR: return EntryType::Directory;
+    case DT_LNK: return EntryType::Symlink;
+    case DT_UNKNOWN: return EntryType::Unknown;
+    default: return EntryType::Other;
+  }
+}
+
+bool is_dot_entry(const char* name) {
+  return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+std::optional<EntryStat> stat_at(int dir_fd, const std::string& name) {
+  struct stat st;
+  if (::fstatat(dir_fd, name.c_str(), &st, 0) != 0)
+    return std::nullopt;
+  EntryStat result;
+  result.regular = S_ISREG(st.st_mode);
+  result.device = static_cast<std::uint64_t>(st.st_dev);
+  result.inode = static_cast<std::uint64_t>(st.st_ino);
+  result.size = static_cast<std::int64_t>(st.st_size);
+  result.mtime_ns = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+  return result;
+}
+
+#if defined(APPIMAGE_MANAGER_HAVE_IO_URING)
+
+constexpr unsigned statx_ring_entries = 256;
+constexpr std::size_t statx_ring_min_batch = 8;
+
+class StatxRing {
+public:
+  StatxRing() {
+    io_uring_params params{};
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, statx_ring_entries, &params));
+    if (fd_ < 0)
+      return;
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    sq_ = map(sq_size_, IORING_OFF_SQ_RING);
+    cq_ = single_mmap ? sq_ : map(cq_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+    if (!sq_ || !cq_ || !sqes_) {
+      release();
+      return;
+    }
+    entries_ = params.sq_entries;
+    char* sq = static_cast<char*>(sq_);
+    char* cq = static_cast<char*>(cq_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  ~StatxRing() { release(); }
+  StatxRing(const StatxRing&) = delete;
+  StatxRing& operator=(const StatxRing&) = delete;
+
+  bool ok() const { return fd_ >= 0; }
+
+  bool stat_all(int dir_fd, const std::vector<std::string>& names, std::vector<std::optional<EntryStat>>& out) {
+    std::size_t capacity = std::min<std::size_t>(names.size(), entries_);
+    std::unique_ptr<struct statx[]> buffers(new struct statx[capacity]);
+    std::vector<bool> reaped(capacity);
+    for (std::size_t first = 0; first < names.size(); first += capacity) {
+      unsigned count = static_cast<unsigned>(std::min(capacity, names.size() - first));
+      unsigned tail = *sq_tail_;
+      for (unsigned i = 0; i < count; ++i, ++tail) {
+        unsigned index = tail & sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_STATX;
+        sqe.fd = dir_fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(names[first + i].c_str());
+        sqe.len = STATX_TYPE | STATX_INO | STATX_SIZE | STATX_MTIME;
+        sqe.off = reinterpret_cast<std::uint64_t>(&buffers[i]);
+        sqe.user_data = i;
+        sq_array_[index] = index;
+      }
+      __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+      std::fill(reaped.begin(), reaped.end(), false);
+      unsigned submitted = 0;
+      unsigned completed = 0;
+      bool submit_failed = false;
+      while (completed < submitted || (!submit_failed && submitted < count)) {
+        unsigned to_submit = submit_failed ? 0 : count - submitted;
+        unsigned to_wait = submitted + to_submit - completed;
+        long rc = ::syscall(__NR_io_uring_enter, fd_, to_submit, to_wait, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (rc < 0 && errno != EINTR) {
+          if (to_submit == 0) {
+            buffers.release();
+            release();
+            for (std::size_t i = first; i < names.size(); ++i) {
+              if (i >= first + count || !reaped[i - first])
+                out[i] = stat_at(dir_fd, names[i]);
+            }
+            return true;
+          }
+          submit_failed = true;
+        }
+        if (rc > 0 && to_submit > 0)
+          submitted += static_cast<unsigned>(rc);
+        unsigned head = *cq_head_;
+        unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != cq_tail; ++head, ++completed) {
+          const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+          std::size_t i = first + cqe.user_data;
+          reaped[cqe.user_data] = true;
+          if (cqe.res == 0)
+            out[i] = to_entry_stat(buffers[cqe.user_data]);
+          else
+            out[i] = stat_at(dir_fd, names[i]);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+      }
+      if (submit_failed)
+        return false;
+    }
+    return true;
+  }
+
+private:
+  void* map(std::size_t size, off_t offset) const {
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  void release() {
+    if (sqes_)
+      ::munmap(sqes_, sqes_size_);
+    if (cq_ && cq_ != sq_)
+      ::munmap(cq_, cq_size_);
+    if (sq_)
+      ::munmap(sq_, sq_size_);
+    if (fd_ >= 0)
+      ::close(fd_);
+    sq_ = cq_ = nullptr;
+    sqes_ = nullptr;
+    fd_ = -1;
+  }
+
+  static EntryStat to_entry_stat(const struct statx& stx) {
+    EntryStat result;
+    result.regular = S_ISREG(stx.stx_mode);
+    result.device = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+    result.inode = stx.stx_ino;
+    result.size = static_cast<std::int64_t>(stx.stx_size);
+    result.mtime_ns = static_cast<long long>(stx.stx_mtime.tv_sec) * 1000000000LL + stx.stx_mtime.tv_nsec;
+    return result;
+  }
+
+  int fd_{-1};
+  unsigned entries_{0};
+  void* sq_{nullptr};
+  void* cq_{nullptr};
+  io_uring_sqe* sqes_{nullptr};
+  std::size_t sq_size_{0};
+  std::size_t cq_size_{0};
+  std::size_t sqes_size_{0};
+  unsigned* sq_tail_{nullptr};
+  unsigned sq_mask_{0};
+  unsigned* sq_array_{nullptr};
+  unsigned* cq_head_{nullptr};
+  unsigned* cq_tail_{nullptr};
+  unsigned cq_mask_{0};
+  io_uring_cqe* cqes_{nullptr};
+};
+
+#endif
+
+#if defined(__linux__)
+
+struct LinuxDirent64 {
+  std::uint64_t d_ino;
+  std::int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+#endif
+
+}
+
+DirectoryReader::DirectoryReader(const std::string& dir)
+  : fd_(::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)) {}
+
+DirectoryReader::~DirectoryReader() {
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+bool DirectoryReader::is_open() const {
+  return fd_ >= 0;
+}
+
+std::optional<std::vector<DirectoryEntryInfo>> DirectoryReader::entries() const {
+  if (fd_ < 0)
+    return std::nullopt;
+  std::vector<DirectoryEntryInfo> result;
+#if defined(__linux__)
+  std::vector<char> buffer(dirent_buffer_size);
+  if (::lseek(fd_, 0, SEEK_SET) < 0)
+    return std::nullopt;
+  long n;
+  while ((n = ::syscall(SYS_getdents64, fd_, buffer.data(), buffer.size())) != 0) {
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return std::nullopt;
+    }
+    for (long offset = 0; offset < n;) {
+      const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+      offset += entry->d_reclen;
+      if (!is_dot_entry(entry->d_name))
+        result.push_back({entry->d_name, entry->d_ino, entry_type(entry->d_type)});
+    }
+  }
+#else
+  int dup_fd = ::dup(fd_);
+  DIR* handle = dup_fd >= 0 ? ::fdopendir(dup_fd) : nullptr;
+  if (!handle) {
+    if (dup_fd >= 0)
+      ::close(dup_fd);
+    return std::nullopt;
+  }
+  ::rewinddir(handle);
+  errno = 0;
+  while (const struct dirent* entry = ::readdir(handle)) {
+    if (!is_dot_entry(entry->d_name))
+      result.push_back({entry->d_name, static_cast<std::uint64_t>(entry->d_ino), entry_type(entry->d_type)});
+  }
+  bool failed = errno != 0;
+  ::closedir(handle);
+  if (failed)
+    return std::nullopt;
+#endif
+  return result;
+}
+
+std::vector<std::optional<EntryStat>> DirectoryReader::stat(const std::vector<std::string>& names) const {
+  std::vector<std::optional<EntryStat>> result(names.size());
+  if (fd_ < 0)
+    return result;
+#if defined(APPIMAGE_MANAGER_HAVE_IO_URING)
+  if (names.size() >= statx_ring_min_batch) {
+    thread_local std::unique_ptr<StatxRing> ring;
+    if (!ring)
+      ring = std::make_unique<StatxRing>();
+    if (ring->ok()) {
+      if (ring->stat_all(fd_, names, result))
+        return result;
+      ring.reset();
+    }
+  }
+#endif
+  for (std::size_t i = 0; i < names.size(); ++i)
+    result[i] = stat_at(fd_, names[i]);
+  return result;
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace appimage_manager::application {
+
+enum class EntryType { Unknown, Regular, Directory, Symlink, Other };
+
+struct DirectoryEntryInfo {
+  std::string name;
+  std::uint64_t inode{0};
+  EntryType type{EntryType::Unknown};
+};
+
+struct EntryStat {
+  bool regular{false};
+  std::uint64_t device{0};
+  std::uint64_t inode{0};
+  std::int64_t size{0};
+  long long mtime_ns{0};
+};
+
+class DirectoryReader {
+public:
+  explicit DirectoryReader(const std::string& dir);
+  ~DirectoryReader();
+  DirectoryReader(const DirectoryReader&) = delete;
+  DirectoryReader& operator=(const DirectoryReader&) = delete;
+
+  bool is_open() const;
+  std::optional<std::vector<DirectoryEntryInfo>> entries() const;
+  std::vector<std::optional<EntryStat>> stat(const std::vector<std::string>& names) const;
+
+private:
+  int fd_{-1};
+};
+
+}
@@ -1,9 +1,15 @@
 #include "extract_icon.hpp"
-#include <fstream>
 #include <filesystem>
 #include <cstdint>
 #include <algorithm>
 #include <array>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
@@ -14,109 +20,198 @@ namespace {
 constexpr std::uint8_t ELF_MAGIC[] = {0x7f, 'E', 'L', 'F'};
 constexpr std::uint8_t SQUASHFS_MAGIC[] = {'h', 's', 'q', 's'};
 constexpr std::uint32_t PT_LOAD = 1;
+constexpr std::uint64_t SQUASHFS_SUPERBLOCK_SIZE = 96;
+constexpr std::uint64_t FNV_PRIME = 0x100000001b3ull;
 
-std::optional<std::uint64_t> get_elf64_load_end(std::ifstream& f) {
-  std::uint64_t e_phoff;
-  std::uint16_t e_phnum, e_phentsize;
-  f.seekg(0x20);
-  if (!f.read(reinterpret_cast<char*>(&e_phoff), sizeof(e_phoff)))
-    return std::nullopt;
-  f.seekg(0x36);
-  if (!f.read(reinterpret_cast<char*>(&e_phentsize), sizeof(e_phentsize)) ||
-      !f.read(reinterpret_cast<char*>(&e_phnum), sizeof(e_phnum)))
-    return std::nullopt;
-  if (e_phnum == 0 || e_phentsize < 56)
-    return std::nullopt;
-  std::uint64_t end_offset = 0;
-  for (std::uint16_t i = 0; i < e_phnum; ++i) {
-    f.seekg(e_phoff + static_cast<std::uint64_t>(i) * e_phentsize);
-    std::uint32_t p_type;
-    std::uint64_t p_offset, p_filesz;
-    if (!f.read(reinterpret_cast<char*>(&p_type), sizeof(p_type)))
-      return std::nullopt;
-    f.seekg(e_phoff + static_cast<std::uint64_t>(i) * e_phentsize + 8);
-    if (!f.read(reinterpret_cast<char*>(&p_offset), sizeof(p_offset)))
-      return std::nullopt;
-    f.seekg(e_phoff + static_cast<std::uint64_t>(i) * e_phentsize + 32);
-    if (!f.read(reinterpret_cast<char*>(&p_filesz), sizeof(p_filesz)))
-      return std::nullopt;
-    if (p_type == PT_LOAD)
-      end_offset = std::max(end_offset, p_offset + p_filesz);
+constexpr std::size_t ELF_HEADER_SIZE = 64;
+constexpr std::uint8_t ELFCLASS32 = 1;
+constexpr std::uint8_t ELFCLASS64 = 2;
+constexpr std::uint8_t ELFDATA2LSB = 1;
+constexpr std::uint8_t ELFDATA2MSB = 2;
+
+struct Elf32Layout {
+  static constexpr std::size_t word_size = 4;
+  static constexpr std::size_t phoff_at = 0x1c;
+  static constexpr std::size_t phentsize_at = 0x2a;
+  static constexpr std::size_t phnum_at = 0x2c;
+  static constexpr std::size_t phdr_size = 32;
+  static constexpr std::size_t p_offset_at = 4;
+  static constexpr std::size_t p_filesz_at = 16;
+};
+
+struct Elf64Layout {
+  static constexpr std::size_t word_size = 8;
+  static constexpr std::size_t phoff_at = 0x20;
+  static constexpr std::size_t phentsize_at = 0x36;
+  static constexpr std::size_t phnum_at = 0x38;
+  static constexpr std::size_t phdr_size = 56;
+  static constexpr std::size_t p_offset_at = 8;
+  static constexpr std::size_t p_filesz_at = 32;
+};
+
+template <bool BigEndian, std::size_t Size>
+constexpr std::uint64_t load(const std::uint8_t* p) {
+  std::uint64_t v = 0;
+  for (std::size_t i = 0; i < Size; ++i) {
+    if constexpr (BigEndian)
+      v = (v << 8) | p[i];
+    else
+      v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
   }
-  return end_offset;
+  return v;
 }
 
-std::optional<std::uint64_t> get_elf32_load_end(std::ifstream& f) {
-  std::uint32_t e_phoff;
-  std::uint16_t e_phnum, e_phentsize;
-  f.seekg(0x1c);
-  if (!f.read(reinterpret_cast<char*>(&e_phoff), sizeof(e_phoff)))
+bool pread_all(int fd, void* buf, std::size_t size, std::uint64_t offset) {
+  auto* out = static_cast<std::uint8_t*>(buf);
+  while (size > 0) {
+    ssize_t n = ::pread(fd, out, size, static_cast<off_t>(offset));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    out += n;
+    offset += static_cast<std::uint64_t>(n);
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+template <typename Layout, bool BigEndian>
+std::optional<std::uint64_t> get_elf_load_end(int fd, const std::uint8_t* header, std::uint64_t file_size) {
+  std::uint64_t e_phoff = load<BigEndian, Layout::word_size>(header + Layout::phoff_at);
+  std::uint64_t e_phentsize = load<BigEndian, 2>(header + Layout::phentsize_at);
+  std::uint64_t e_phnum = load<BigEndian, 2>(header + Layout::phnum_at);
+  if (e_phnum == 0 || e_phentsize < Layout::phdr_size)
     return std::nullopt;
-  f.seekg(0x2a);
-  if (!f.read(reinterpret_cast<char*>(&e_phentsize), sizeof(e_phentsize)) ||
-      !f.read(reinterpret_cast<char*>(&e_phnum), sizeof(e_phnum)))
+  if (e_phoff > file_size || e_phnum * e_phentsize > file_size - e_phoff)
     return std::nullopt;
-  if (e_phnum == 0 || e_phentsize < 32)
+  std::size_t table_size = static_cast<std::size_t>(e_phnum * e_phentsize);
+  std::array<std::uint8_t, 4096> stack_table;
+  std::vector<std::uint8_t> heap_table;
+  std::uint8_t* table = stack_table.data();
+  if (table_size > stack_table.size()) {
+    heap_table.resize(table_size);
+    table = heap_table.data();
+  }
+  if (!pread_all(fd, table, table_size, e_phoff))
     return std::nullopt;
   std::uint64_t end_offset = 0;
-  for (std::uint16_t i = 0; i < e_phnum; ++i) {
-    f.seekg(e_phoff + static_cast<std::uint64_t>(i) * e_phentsize);
-    std::uint32_t p_type, p_offset, p_filesz;
-    if (!f.read(reinterpret_cast<char*>(&p_type), sizeof(p_type)) ||
-        !f.read(reinterpret_cast<char*>(&p_offset), sizeof(p_offset)))
-      return std::nullopt;
-    f.seekg(e_phoff + static_cast<std::uint64_t>(i) * e_phentsize + 16);
-    if (!f.read(reinterpret_cast<char*>(&p_filesz), sizeof(p_filesz)))
-      return std::nullopt;
-    if (p_type == PT_LOAD)
-      end_offset = std::max(end_offset, static_cast<std::uint64_t>(p_offset) + p_filesz);
+  for (std::size_t i = 0; i < e_phnum; ++i) {
+    const std::uint8_t* phdr = table + i * e_phentsize;
+    if (load<BigEndian, 4>(phdr) != PT_LOAD)
+      continue;
+    std::uint64_t p_offset = load<BigEndian, Layout::word_size>(phdr + Layout::p_offset_at);
+    std::uint64_t p_filesz = load<BigEndian, Layout::word_size>(phdr + Layout::p_filesz_at);
+    end_offset = std::max(end_offset, p_offset + p_filesz);
   }
   return end_offset;
 }
 
-std::optional<std::uint64_t> find_squashfs_magic(std::ifstream& f, std::uint64_t start) {
-  f.seekg(start);
-  std::array<char, 65536> buf;
-  std::uint64_t pos = start;
-  while (f.read(buf.data(), buf.size()) || f.gcount() > 0) {
-    std::streamsize n = f.gcount();
-    for (std::streamsize i = 0; i + 4 <= n; ++i) {
-      if (buf[static_cast<std::size_t>(i)] == SQUASHFS_MAGIC[0] &&
-          buf[static_cast<std::size_t>(i) + 1] == SQUASHFS_MAGIC[1] &&
-          buf[static_cast<std::size_t>(i) + 2] == SQUASHFS_MAGIC[2] &&
-          buf[static_cast<std::size_t>(i) + 3] == SQUASHFS_MAGIC[3])
-        return pos + static_cast<std::uint64_t>(i);
-    }
-    pos += static_cast<std::uint64_t>(n);
-    if (static_cast<std::streamsize>(n) < buf.size())
-      break;
-  }
-  return std::nullopt;
+bool is_squashfs_superblock(const std::uint8_t* p, std::uint64_t available) {
+  if (available < SQUASHFS_SUPERBLOCK_SIZE)
+    return false;
+  std::uint64_t block_size = load<false, 4>(p + 12);
+  std::uint64_t block_log = load<false, 2>(p + 22);
+  std::uint64_t version_major = load<false, 2>(p + 28);
+  std::uint64_t version_minor = load<false, 2>(p + 30);
+  std::uint64_t bytes_used = load<false, 8>(p + 40);
+  return version_major == 4 && version_minor == 0 &&
+         block_log >= 12 && block_log <= 20 && block_size == (1ull << block_log) &&
+         bytes_used >= SQUASHFS_SUPERBLOCK_SIZE && bytes_used <= available;
 }
 
+std::optional<std::uint64_t> find_squashfs_magic(int fd, std::uint64_t start) {
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<std::uint64_t>(st.st_size) <= start)
+    return std::nullopt;
+  std::size_t size = static_cast<std::size_t>(st.st_size);
+  void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED)
+    return std::nullopt;
+  ::madvise(mapping, size, MADV_SEQUENTIAL);
+  const auto* data = static_cast<const std::uint8_t*>(mapping);
+  std::optional<std::uint64_t> result;
+  std::size_t pos = static_cast<std::size_t>(start);
+  while (pos < size) {
+    const void* hit = ::memmem(data + pos, size - pos, SQUASHFS_MAGIC, sizeof(SQUASHFS_MAGIC));
+    if (!hit)
+      break;
+    std::size_t found = static_cast<std::size_t>(static_cast<const std::uint8_t*>(hit) - data);
+    if (is_squashfs_superblock(data + found, size - found)) {
+      result = found;
+      break;
+    }
+    pos = found + 1;
+  }
+  ::munmap(mapping, size);
+  return result;
 }
 
-std::optional<std::uint64_t> get_appimage_squashfs_offset(const std::string& appimage_path) {
-  std::ifstream f(appimage_path, std::ios::binary);
-  if (!f)
+std::optional<std::uint64_t> squashfs_offset(int fd) {
+  std::uint8_t header[ELF_HEADER_SIZE] = {};
+  if (!pread_all(fd, header, sizeof(header), 0) ||
+      !std::equal(std::begin(ELF_MAGIC), std::end(ELF_MAGIC), header))
     return std::nullopt;
-  std::uint8_t magic[4];
-  if (!f.read(reinterpret_cast<char*>(magic), 4) ||
-      !std::equal(std::begin(ELF_MAGIC), std::end(ELF_MAGIC), magic))
-    return std::nullopt;
-  std::uint8_t ei_class;
-  if (!f.read(reinterpret_cast<char*>(&ei_class), 1))
+  struct stat st;
+  if (::fstat(fd, &st) != 0)
     return std::nullopt;
+  auto file_size = static_cast<std::uint64_t>(st.st_size);
+  std::uint8_t ei_class = header[4];
+  std::uint8_t ei_data = header[5];
   std::optional<std::uint64_t> load_end;
-  if (ei_class == 2)
-    load_end = get_elf64_load_end(f);
-  else if (ei_class == 1)
-    load_end = get_elf32_load_end(f);
-  else
-    return std::nullopt;
+  if (ei_class == ELFCLASS64 && ei_data == ELFDATA2LSB)
+    load_end = get_elf_load_end<Elf64Layout, false>(fd, header, file_size);
+  else if (ei_class == ELFCLASS64 && ei_data == ELFDATA2MSB)
+    load_end = get_elf_load_end<Elf64Layout, true>(fd, header, file_size);
+  else if (ei_class == ELFCLASS32 && ei_data == ELFDATA2LSB)
+    load_end = get_elf_load_end<Elf32Layout, false>(fd, header, file_size);
+  else if (ei_class == ELFCLASS32 && ei_data == ELFDATA2MSB)
+    load_end = get_elf_load_end<Elf32Layout, true>(fd, header, file_size);
   if (!load_end.has_value())
     return std::nullopt;
-  return find_squashfs_magic(f, load_end.value());
+  return find_squashfs_magic(fd, load_end.value());
+}
+
+}
+
+std::uint64_t fnv1a(std::string_view data, std::uint64_t hash) {
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+std::optional<std::uint64_t> get_appimage_squashfs_offset(const std::string& appimage_path) {
+  int fd = ::open(appimage_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return std::nullopt;
+  std::optional<std::uint64_t> offset = squashfs_offset(fd);
+  ::close(fd);
+  return offset;
+}
+
+std::optional<AppImageProbe> probe_appimage(const std::string& appimage_path) {
+  int fd = ::open(appimage_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return std::nullopt;
+  std::optional<AppImageProbe> result;
+  std::optional<std::uint64_t> offset = squashfs_offset(fd);
+  std::uint8_t superblock[SQUASHFS_SUPERBLOCK_SIZE];
+  struct stat st;
+  if (offset && ::fstat(fd, &st) == 0 && pread_all(fd, superblock, sizeof(superblock), *offset)) {
+    AppImageProbe probe;
+    probe.squashfs_offset = *offset;
+    probe.compression = static_cast<std::uint16_t>(load<false, 2>(superblock + 20));
+    std::uint64_t hash = fnv1a(std::string_view(reinterpret_cast<const char*>(superblock), sizeof(superblock)));
+    std::uint8_t size_bytes[8];
+    for (std::size_t i = 0; i < sizeof(size_bytes); ++i)
+      size_bytes[i] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(st.st_size) >> (8 * i));
+    probe.content_hash = fnv1a(std::string_view(reinterpret_cast<const char*>(size_bytes), sizeof(size_bytes)), hash);
+    result = probe;
+  }
+  ::close(fd);
+  return result;
 }
 
 }
@@ -3,9 +3,22 @@
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 
 namespace appimage_manager::application {
 
+struct AppImageProbe {
+  std::uint64_t squashfs_offset{0};
+  std::uint16_t compression{0};
+  std::uint64_t content_hash{0};
+};
+
+constexpr std::uint64_t fnv1a_offset_basis = 0xcbf29ce484222325ull;
+
+std::uint64_t fnv1a(std::string_view data, std::uint64_t hash = fnv1a_offset_basis);
+
 std::optional<std::uint64_t> get_appimage_squashfs_offset(const std::string& appimage_path);
 
+std::optional<AppImageProbe> probe_appimage(const std::string& appimage_path);
+
 }
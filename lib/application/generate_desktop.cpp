@@ -4,6 +4,7 @@
 #include <filesystem>
 #include <algorithm>
 #include <sstream>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -38,10 +39,19 @@ std::string id_to_eight_digits(const std::string& id) {
   return std::string(8u - id.size(), '0') + id;
 }
 
+std::string join_desktop_list(const std::vector<std::string>& items) {
+  std::string out;
+  for (const auto& item : items)
+    out += escape_desktop_string(item) + ";";
+  return out;
+}
+
 std::string build_exec_line(const domain::AppImageRecord& record,
                             const domain::LaunchSettings& settings) {
   std::string path_esc = escape_desktop_string(record.path);
   std::string args_esc = settings.args.empty() ? "" : " " + escape_desktop_string(settings.args);
+  if (!record.metadata.mime_types.empty())
+    args_esc += " %U";
   switch (settings.sandbox) {
     case domain::SandboxMechanism::Bwrap: {
       std::string bind = escape_desktop_string(record.path);
@@ -66,7 +76,37 @@ std::string desktop_file_path(const std::string& record_id,
   return (fs::path(applications_dir) / ("appimagemanager-" + name_part + "-" + digits + ".desktop")).string();
 }
 
-void generate_desktop(const domain::AppImageRecord& record,
+std::string render_desktop(const domain::AppImageRecord& record,
+                           const domain::LaunchSettings& settings,
+                           const std::string& icon_path) {
+  const domain::AppImageMetadata& metadata = record.metadata;
+  std::string name = record.name;
+  if (!metadata.name.empty() && record.name == fs::path(record.path).stem().string())
+    name = metadata.name;
+  std::string icon = icon_path.empty() ? metadata.icon_path : icon_path;
+  std::ostringstream f;
+  f << "[Desktop Entry]\n";
+  f << "Type=Application\n";
+  f << "Name=" << escape_desktop_string(name) << "\n";
+  if (!metadata.summary.empty())
+    f << "Comment=" << escape_desktop_string(metadata.summary) << "\n";
+  f << "Exec=" << build_exec_line(record, settings) << "\n";
+  if (!icon.empty())
+    f << "Icon=" << escape_desktop_string(icon) << "\n";
+  for (const auto& e : settings.env)
+    f << "Env=" << escape_desktop_string(e) << "\n";
+  f << "Terminal=false\n";
+  f << "Categories=" << (metadata.categories.empty() ? "Utility;" : join_desktop_list(metadata.categories)) << "\n";
+  if (!metadata.mime_types.empty())
+    f << "MimeType=" << join_desktop_list(metadata.mime_types) << "\n";
+  if (!metadata.startup_wm_class.empty())
+    f << "StartupWMClass=" << escape_desktop_string(metadata.startup_wm_class) << "\n";
+  if (!metadata.version.empty())
+    f << "X-AppImage-Version=" << escape_desktop_string(metadata.version) << "\n";
+  return f.str();
+}
+
+bool generate_desktop(const domain::AppImageRecord& record,
                       const domain::LaunchSettings& settings,
                       const std::string& applications_dir,
                       const std::string& icon_path) {
@@ -74,27 +114,40 @@ void generate_desktop(const domain::AppImageRecord& record,
   if (!dir.empty())
     fs::create_directories(dir);
   std::string path = desktop_file_path(record.id, record.name, applications_dir);
-  std::ofstream f(path);
-  if (!f)
-    return;
-  f << "[Desktop Entry]\n";
-  f << "Type=Application\n";
-  f << "Name=" << escape_desktop_string(record.name) << "\n";
-  f << "Exec=" << build_exec_line(record, settings) << "\n";
-  if (!icon_path.empty())
-    f << "Icon=" << escape_desktop_string(icon_path) << "\n";
-  for (const auto& e : settings.env)
-    f << "Env=" << escape_desktop_string(e) << "\n";
-  f << "Terminal=false\n";
-  f << "Categories=Utility;\n";
+  std::string content = render_desktop(record, settings, icon_path);
+  if (std::ifstream in{path, std::ios::binary}) {
+    std::ostringstream current;
+    current << in.rdbuf();
+    if (current.str() == content)
+      return false;
+  }
+  std::string tmp_path = path + ".tmp";
+  std::error_code ec;
+  {
+    std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!f)
+      return false;
+    f << content;
+    if (!f.flush()) {
+      f.close();
+      fs::remove(tmp_path, ec);
+      return false;
+    }
+  }
+  fs::rename(tmp_path, path, ec);
+  if (ec) {
+    fs::remove(tmp_path, ec);
+    return false;
+  }
+  return true;
 }
 
-void remove_desktop(const std::string& record_id,
+bool remove_desktop(const std::string& record_id,
                     const std::string& record_name,
                     const std::string& applications_dir) {
   std::string path = desktop_file_path(record_id, record_name, applications_dir);
   std::error_code ec;
-  fs::remove(path, ec);
+  return fs::remove(path, ec);
 }
 
 std::string icon_file_path(const std::string& record_id,
@@ -6,12 +6,16 @@
 
 namespace appimage_manager::application {
 
-void generate_desktop(const domain::AppImageRecord& record,
+std::string render_desktop(const domain::AppImageRecord& record,
+                           const domain::LaunchSettings& settings,
+                           const std::string& icon_path = "");
+
+bool generate_desktop(const domain::AppImageRecord& record,
                       const domain::LaunchSettings& settings,
                       const std::string& applications_dir,
                       const std::string& icon_path = "");
 
-void remove_desktop(const std::string& record_id,
+bool remove_desktop(const std::string& record_id,
                     const std::string& record_name,
                     const std::string& applications_dir);
 
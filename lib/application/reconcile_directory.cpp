@@ -0,0 +1,31 @@
+#include "reconcile_directory.hpp"
+#include <domain/repositories/registry_repository.hpp>
+#include <algorithm>
+
+namespace appimage_manager::application {
+
+DirectoryDelta reconcile_directory(const std::string& dir,
+                                   const std::vector<std::pair<std::string, bool>>& entries,
+                                   std::vector<domain::AppImageRecord> records) {
+  std::sort(records.begin(), records.end(),
+    [](const domain::AppImageRecord& a, const domain::AppImageRecord& b) { return a.path < b.path; });
+  std::string prefix = domain::directory_prefix(dir);
+  DirectoryDelta delta;
+  auto record = records.begin();
+  for (const auto& [name, unchanged] : entries) {
+    std::string path = prefix + name;
+    for (; record != records.end() && record->path < path; ++record)
+      delta.removed.push_back(std::move(*record));
+    if (record != records.end() && record->path == path) {
+      (unchanged ? delta.unchanged : delta.modified).push_back(std::move(*record));
+      ++record;
+    } else {
+      delta.added.push_back(std::move(path));
+    }
+  }
+  for (; record != records.end(); ++record)
+    delta.removed.push_back(std::move(*record));
+  return delta;
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <domain/entities/app_image_record.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace appimage_manager::application {
+
+struct ContentFingerprint {
+  std::uint64_t inode{0};
+  std::uint64_t value{0};
+};
+
+struct DirectoryDelta {
+  std::vector<domain::AppImageRecord> unchanged;
+  std::vector<domain::AppImageRecord> modified;
+  std::vector<std::string> added;
+  std::vector<domain::AppImageRecord> removed;
+  std::unordered_map<std::string, ContentFingerprint> fingerprints;
+  std::size_t applied{0};
+
+  std::size_t pending() const { return unchanged.size() + modified.size() + added.size() - applied; }
+};
+
+DirectoryDelta reconcile_directory(const std::string& dir,
+                                   const std::vector<std::pair<std::string, bool>>& entries,
+                                   std::vector<domain::AppImageRecord> records);
+
+}
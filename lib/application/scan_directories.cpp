@@ -1,7 +1,17 @@
 #include "scan_directories.hpp"
+#include "watch_tree.hpp"
+#include "extract_icon.hpp"
+#include "directory_reader.hpp"
 #include <filesystem>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <sys/stat.h>
 
 namespace fs = std::filesystem;
 
@@ -12,6 +22,8 @@ namespace {
 constexpr std::string_view appimage_suffix = ".AppImage";
 constexpr std::string_view part_suffix = ".part";
 constexpr std::string_view crdownload_suffix = ".crdownload";
+constexpr long long snapshot_settle_ns = 2000000000LL;
+constexpr std::size_t root_buffer_capacity = 16;
 
 bool is_partial_download(const fs::path& p) {
   std::string name = p.filename().string();
@@ -24,10 +36,7 @@ bool is_partial_download(const fs::path& p) {
   return false;
 }
 
-bool is_appimage_file(const fs::path& p) {
-  if (!fs::is_regular_file(p))
-    return false;
-  std::string name = p.filename().string();
+bool has_appimage_suffix(const std::string& name) {
   if (name.size() < appimage_suffix.size())
     return false;
   std::string suffix(name.end() - static_cast<std::ptrdiff_t>(appimage_suffix.size()), name.end());
@@ -35,8 +44,29 @@ bool is_appimage_file(const fs::path& p) {
     [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
 }
 
-std::string make_id(const std::string& path) {
-  return std::to_string(std::hash<std::string>{}(path));
+long long mtime_ns(const struct stat& st) {
+  return static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+long long now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string hex_id(std::uint64_t value) {
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(value));
+  return std::string(buf);
+}
+
+std::string make_id(const domain::RegistryRepository& registry, std::uint64_t fingerprint, const std::string& path) {
+  std::uint64_t value = fingerprint != 0 ? fingerprint : fnv1a(path);
+  std::string id = hex_id(value);
+  while (registry.by_id(id)) {
+    value = fnv1a(path, value);
+    id = hex_id(value);
+  }
+  return id;
 }
 
 }
@@ -44,48 +74,356 @@ std::string make_id(const std::string& path) {
 ScanDirectories::ScanDirectories(domain::RegistryRepository& registry)
   : registry_(&registry) {}
 
+void ScanDirectories::set_snapshot_repository(domain::DirectorySnapshotRepository* snapshots) {
+  snapshots_ = snapshots;
+}
+
+void ScanDirectories::set_probe_cache(AppImageProbeCache* probe_cache) {
+  probe_cache_ = probe_cache;
+}
+
+void ScanDirectories::set_on_moved(OnMovedCallback on_moved) {
+  on_moved_ = std::move(on_moved);
+}
+
 std::vector<domain::AppImageRecord> ScanDirectories::execute(const domain::Config& config,
                                                              OnAddedCallback on_added,
                                                              const std::string& self_path,
-                                                             OnEnsureDesktopCallback on_ensure_desktop) {
+                                                             OnEnsureDesktopCallback on_ensure_desktop,
+                                                             OnRemovedCallback on_removed) {
+  auto listings = list(config);
   std::vector<domain::AppImageRecord> result;
-  for (const auto& dir : config.watch_directories) {
-    fs::path base(dir);
-    if (!fs::is_directory(base))
+  std::vector<domain::AppImageRecord> stale;
+  domain::RegistryBatch batch(*registry_);
+  std::optional<domain::DirectorySnapshotBatch> snapshot_batch;
+  if (snapshots_)
+    snapshot_batch.emplace(*snapshots_);
+  for (const auto& listing : listings) {
+    auto removed = apply(listing, result, on_added, self_path, on_ensure_desktop);
+    std::move(removed.begin(), removed.end(), std::back_inserter(stale));
+  }
+  remove_stale(stale, on_removed);
+  return result;
+}
+
+std::vector<ScanDirectories::DirectoryListing> ScanDirectories::list(const domain::Config& config) const {
+  std::vector<std::vector<DirectoryListing>> roots(config.watch_directories.size());
+  auto list_into = [this, &config](const std::string& root, std::vector<DirectoryListing>& listings) {
+    list_root(root, config, [&listings](DirectoryListing&& listing) {
+      listings.push_back(std::move(listing));
+      return true;
+    });
+  };
+  if (config.watch_directories.size() > 1) {
+    std::vector<std::future<void>> tasks;
+    for (std::size_t i = 0; i < roots.size(); ++i)
+      tasks.push_back(std::async(std::launch::async, list_into, std::cref(config.watch_directories[i]), std::ref(roots[i])));
+    for (auto& task : tasks)
+      task.get();
+  } else {
+    for (std::size_t i = 0; i < roots.size(); ++i)
+      list_into(config.watch_directories[i], roots[i]);
+  }
+  std::vector<DirectoryListing> listings;
+  for (auto& root : roots)
+    std::move(root.begin(), root.end(), std::back_inserter(listings));
+  return listings;
+}
+
+void ScanDirectories::list(const domain::Config& config, BoundedQueue<DirectoryListing>& queue) const {
+  auto push = [&queue](DirectoryListing&& listing) { return queue.push(std::move(listing)); };
+  if (config.watch_directories.size() > 1) {
+    std::vector<std::unique_ptr<BoundedQueue<DirectoryListing>>> roots;
+    for (std::size_t i = 0; i < config.watch_directories.size(); ++i)
+      roots.push_back(std::make_unique<BoundedQueue<DirectoryListing>>(root_buffer_capacity));
+    std::vector<std::future<void>> tasks;
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+      tasks.push_back(std::async(std::launch::async, [this, &config, &root = config.watch_directories[i], &buffer = *roots[i]] {
+        list_root(root, config, [&buffer](DirectoryListing&& listing) { return buffer.push(std::move(listing)); });
+        buffer.close();
+      }));
+    }
+    bool stopped = false;
+    for (auto& buffer : roots) {
+      while (!stopped) {
+        auto listing = buffer->pop();
+        if (!listing)
+          break;
+        stopped = !queue.push(std::move(*listing));
+      }
+      if (stopped)
+        buffer->close();
+    }
+    for (auto& task : tasks)
+      task.get();
+  } else {
+    for (const auto& root : config.watch_directories) {
+      if (!list_root(root, config, push))
+        break;
+    }
+  }
+}
+
+void ScanDirectories::classify(DirectoryListing& listing) const {
+  if (!listing.snapshot)
+    return;
+  for (const auto& [name, unchanged] : listing.entries) {
+    if (unchanged)
       continue;
-    for (const auto& entry : fs::directory_iterator(base)) {
-      const auto& p = entry.path();
-      if (is_partial_download(p))
-        continue;
-      if (!is_appimage_file(p))
+    auto entry = listing.snapshot->entries.find(name);
+    if (entry == listing.snapshot->entries.end())
+      continue;
+    std::string path = (fs::path(listing.dir) / name).string();
+    listing.fingerprints.insert_or_assign(path, ContentFingerprint{entry->second.inode, content_fingerprint(path)});
+  }
+}
+
+bool ScanDirectories::list_root(const std::string& root, const domain::Config& config, const ListingSink& sink) const {
+  auto dirs = collect_watch_directories(root, root, config);
+  std::sort(dirs.begin() + (dirs.empty() ? 0 : 1), dirs.end());
+  for (const auto& dir : dirs) {
+    if (!sink(list_directory(dir, config)))
+      return false;
+  }
+  return true;
+}
+
+ScanDirectories::DirectoryListing ScanDirectories::list_directory(const std::string& dir,
+                                                                  const domain::Config& config) const {
+  DirectoryListing listing;
+  listing.dir = dir;
+  struct stat dir_st;
+  if (::stat(dir.c_str(), &dir_st) != 0 || !S_ISDIR(dir_st.st_mode)) {
+    listing.missing = true;
+    return listing;
+  }
+  auto add = [&](const std::string& name, bool unchanged) {
+    if (config.exclude.empty() || !is_excluded((fs::path(dir) / name).string(), config.exclude))
+      listing.entries.emplace_back(name, unchanged);
+  };
+
+  std::optional<domain::DirectorySnapshot> previous;
+  if (snapshots_)
+    previous = snapshots_->load(dir);
+  if (previous && previous->device == dir_st.st_dev && previous->inode == dir_st.st_ino &&
+      previous->mtime_ns == mtime_ns(dir_st) && previous->scanned_ns - previous->mtime_ns >= snapshot_settle_ns) {
+    for (const auto& [name, entry] : previous->entries)
+      add(name, true);
+    std::sort(listing.entries.begin(), listing.entries.end());
+    return listing;
+  }
+
+  DirectoryReader reader(dir);
+  auto entries = reader.entries();
+  if (!entries) {
+    listing.failed = true;
+    return listing;
+  }
+  domain::DirectorySnapshot snapshot;
+  snapshot.device = dir_st.st_dev;
+  snapshot.inode = dir_st.st_ino;
+  snapshot.mtime_ns = mtime_ns(dir_st);
+  snapshot.scanned_ns = now_ns();
+  std::vector<std::string> to_stat;
+  std::vector<std::uint64_t> to_stat_inodes;
+  for (auto& entry : *entries) {
+    if (entry.type == EntryType::Directory || entry.type == EntryType::Other || !has_appimage_suffix(entry.name))
+      continue;
+    if (previous) {
+      auto it = previous->entries.find(entry.name);
+      if (it != previous->entries.end() && it->second.inode == entry.inode) {
+        snapshot.entries.emplace(entry.name, it->second);
+        add(entry.name, true);
         continue;
-      std::string path = p.string();
-      if (!self_path.empty()) {
-        std::error_code ec;
-        if (fs::equivalent(p, fs::path(self_path), ec))
-          continue;
       }
-      auto existing = registry_->by_path(path);
-      if (existing) {
-        result.push_back(*existing);
+    }
+    to_stat.push_back(std::move(entry.name));
+    to_stat_inodes.push_back(entry.inode);
+  }
+  auto stats = reader.stat(to_stat);
+  for (std::size_t i = 0; i < to_stat.size(); ++i) {
+    if (!stats[i] || !stats[i]->regular)
+      continue;
+    snapshot.entries.emplace(to_stat[i], domain::DirectoryEntrySnapshot{to_stat_inodes[i], stats[i]->size, stats[i]->mtime_ns});
+    add(to_stat[i], false);
+  }
+  std::sort(listing.entries.begin(), listing.entries.end());
+  listing.snapshot = std::move(snapshot);
+  return listing;
+}
+
+DirectoryDelta ScanDirectories::reconcile(const DirectoryListing& listing) const {
+  if (listing.missing || listing.failed)
+    return {};
+  DirectoryDelta delta = reconcile_directory(listing.dir, listing.entries, registry_->in_directory(listing.dir));
+  delta.fingerprints = listing.fingerprints;
+  return delta;
+}
+
+void ScanDirectories::save_snapshot(const DirectoryListing& listing) {
+  if (!snapshots_ || listing.failed)
+    return;
+  if (listing.missing)
+    snapshots_->remove(listing.dir);
+  else if (listing.snapshot)
+    snapshots_->save(listing.dir, *listing.snapshot);
+}
+
+std::size_t ScanDirectories::apply_delta(DirectoryDelta& delta,
+                                         std::vector<domain::AppImageRecord>& result,
+                                         const OnAddedCallback& on_added,
+                                         const std::string& self_path,
+                                         const OnEnsureDesktopCallback& on_ensure_desktop,
+                                         std::size_t budget) {
+  std::optional<FileId> self = file_id(self_path);
+  std::size_t count = 0;
+  for (; count < budget && delta.pending() > 0; ++count) {
+    std::size_t i = delta.applied++;
+    std::string path;
+    if (i < delta.unchanged.size()) {
+      domain::AppImageRecord& existing = delta.unchanged[i];
+      if (existing.fingerprint != 0) {
         if (on_ensure_desktop)
-          on_ensure_desktop(*existing);
+          on_ensure_desktop(existing);
+        result.push_back(existing);
         continue;
       }
-      domain::AppImageRecord record;
-      record.id = make_id(path);
-      record.path = path;
-      record.name = p.stem().string();
-      record.install_type = domain::InstallType::Downloaded;
-      std::error_code perm_ec;
-      fs::permissions(p, fs::perms::owner_exec, fs::perm_options::add, perm_ec);
-      registry_->save(record);
-      result.push_back(record);
-      if (on_added)
-        on_added(record);
+      path = existing.path;
+    } else if (i < delta.unchanged.size() + delta.modified.size()) {
+      path = delta.modified[i - delta.unchanged.size()].path;
+    } else {
+      path = delta.added[i - delta.unchanged.size() - delta.modified.size()];
     }
+    std::optional<ContentFingerprint> known;
+    if (auto it = delta.fingerprints.find(path); it != delta.fingerprints.end())
+      known = it->second;
+    if (auto record = scan_entry(fs::path(path), on_added, self, on_ensure_desktop, known))
+      result.push_back(std::move(*record));
   }
-  return result;
+  return count;
+}
+
+std::vector<domain::AppImageRecord> ScanDirectories::apply(const DirectoryListing& listing,
+                                                           std::vector<domain::AppImageRecord>& result,
+                                                           const OnAddedCallback& on_added,
+                                                           const std::string& self_path,
+                                                           const OnEnsureDesktopCallback& on_ensure_desktop) {
+  save_snapshot(listing);
+  DirectoryDelta delta = reconcile(listing);
+  apply_delta(delta, result, on_added, self_path, on_ensure_desktop);
+  return std::move(delta.removed);
+}
+
+void ScanDirectories::remove_stale(const std::vector<domain::AppImageRecord>& stale,
+                                   const OnRemovedCallback& on_removed) {
+  for (const auto& record : stale) {
+    if (!registry_->by_path(record.path))
+      continue;
+    if (probe_cache_)
+      probe_cache_->forget(record.path);
+    if (on_removed)
+      on_removed(record);
+    else
+      registry_->remove_by_path(record.path);
+  }
+}
+
+std::optional<domain::AppImageRecord> ScanDirectories::execute_file(const std::string& path,
+                                                                    OnAddedCallback on_added,
+                                                                    const std::string& self_path,
+                                                                    OnEnsureDesktopCallback on_ensure_desktop) {
+  domain::RegistryBatch batch(*registry_);
+  return scan_entry(fs::path(path), on_added, file_id(self_path), on_ensure_desktop);
+}
+
+std::uint64_t ScanDirectories::content_fingerprint(const std::string& path) const {
+  auto probe = probe_cache_ ? probe_cache_->probe(path) : probe_appimage(path);
+  return probe ? probe->content_hash : 0;
+}
+
+std::optional<ScanDirectories::FileId> ScanDirectories::file_id(const std::string& path) {
+  struct stat st;
+  if (path.empty() || ::stat(path.c_str(), &st) != 0)
+    return std::nullopt;
+  return FileId{static_cast<std::uint64_t>(st.st_dev), static_cast<std::uint64_t>(st.st_ino)};
+}
+
+std::optional<domain::AppImageRecord> ScanDirectories::scan_entry(const fs::path& p,
+                                                                  const OnAddedCallback& on_added,
+                                                                  const std::optional<FileId>& self,
+                                                                  const OnEnsureDesktopCallback& on_ensure_desktop,
+                                                                  const std::optional<ContentFingerprint>& known) {
+  if (is_partial_download(p) || !has_appimage_suffix(p.filename().string()))
+    return std::nullopt;
+  std::string path = p.string();
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+    return std::nullopt;
+  auto inode = static_cast<std::uint64_t>(st.st_ino);
+  if (self && self->device == static_cast<std::uint64_t>(st.st_dev) && self->inode == inode)
+    return std::nullopt;
+  auto fingerprint_of = [&] {
+    return known && known->inode == inode ? known->value : content_fingerprint(path);
+  };
+  auto existing = registry_->by_path(path);
+  if (existing) {
+    if (existing->inode != inode || existing->fingerprint == 0) {
+      std::uint64_t fingerprint = fingerprint_of();
+      if (existing->inode != inode || existing->fingerprint != fingerprint) {
+        existing->inode = inode;
+        existing->fingerprint = fingerprint;
+        registry_->save(*existing);
+      }
+    }
+    if (on_ensure_desktop)
+      on_ensure_desktop(*existing);
+    return existing;
+  }
+  std::uint64_t fingerprint = fingerprint_of();
+  if (auto moved = find_moved(fingerprint, inode, path)) {
+    domain::AppImageRecord previous = *moved;
+    registry_->remove_by_path(previous.path);
+    moved->path = path;
+    moved->inode = inode;
+    if (previous.name == fs::path(previous.path).stem().string())
+      moved->name = p.stem().string();
+    registry_->save(*moved);
+    if (on_moved_)
+      on_moved_(*moved, previous);
+    return moved;
+  }
+  domain::AppImageRecord record;
+  record.id = make_id(*registry_, fingerprint, path);
+  record.path = path;
+  record.fingerprint = fingerprint;
+  record.inode = inode;
+  record.name = p.stem().string();
+  record.install_type = domain::InstallType::Downloaded;
+  std::error_code perm_ec;
+  fs::permissions(p, fs::perms::owner_exec, fs::perm_options::add, perm_ec);
+  registry_->save(record);
+  if (on_added)
+    on_added(record);
+  return record;
+}
+
+std::optional<domain::AppImageRecord> ScanDirectories::find_moved(std::uint64_t fingerprint,
+                                                                  std::uint64_t inode,
+                                                                  const std::string& path) const {
+  if (fingerprint == 0)
+    return std::nullopt;
+  std::optional<domain::AppImageRecord> moved;
+  for (auto& candidate : registry_->by_fingerprint(fingerprint)) {
+    std::error_code ec;
+    if (candidate.path == path || fs::exists(candidate.path, ec))
+      continue;
+    bool same_inode = candidate.inode == inode;
+    if (!moved || (same_inode && moved->inode != inode))
+      moved = std::move(candidate);
+    if (same_inode)
+      break;
+  }
+  return moved;
 }
 
 }
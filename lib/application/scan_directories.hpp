@@ -2,9 +2,20 @@
 
 #include <domain/entities/config.hpp>
 #include <domain/repositories/registry_repository.hpp>
+#include <domain/repositories/directory_snapshot_repository.hpp>
 #include <domain/entities/app_image_record.hpp>
+#include "reconcile_directory.hpp"
+#include "bounded_queue.hpp"
+#include "appimage_probe_cache.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <vector>
 #include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace appimage_manager::application {
 
@@ -12,15 +23,75 @@ class ScanDirectories {
 public:
   using OnAddedCallback = std::function<void(const domain::AppImageRecord&)>;
   using OnEnsureDesktopCallback = std::function<void(const domain::AppImageRecord&)>;
+  using OnMovedCallback = std::function<void(const domain::AppImageRecord&, const domain::AppImageRecord& previous)>;
+  using OnRemovedCallback = std::function<void(const domain::AppImageRecord&)>;
 
   explicit ScanDirectories(domain::RegistryRepository& registry);
+  void set_snapshot_repository(domain::DirectorySnapshotRepository* snapshots);
+  void set_probe_cache(AppImageProbeCache* probe_cache);
+  void set_on_moved(OnMovedCallback on_moved);
   std::vector<domain::AppImageRecord> execute(const domain::Config& config,
                                               OnAddedCallback on_added = nullptr,
                                               const std::string& self_path = "",
-                                              OnEnsureDesktopCallback on_ensure_desktop = nullptr);
+                                              OnEnsureDesktopCallback on_ensure_desktop = nullptr,
+                                              OnRemovedCallback on_removed = nullptr);
+  std::optional<domain::AppImageRecord> execute_file(const std::string& path,
+                                                     OnAddedCallback on_added = nullptr,
+                                                     const std::string& self_path = "",
+                                                     OnEnsureDesktopCallback on_ensure_desktop = nullptr);
+
+  struct DirectoryListing {
+    std::string dir;
+    std::vector<std::pair<std::string, bool>> entries;
+    std::optional<domain::DirectorySnapshot> snapshot;
+    std::unordered_map<std::string, ContentFingerprint> fingerprints;
+    bool missing{false};
+    bool failed{false};
+  };
+
+  std::vector<DirectoryListing> list(const domain::Config& config) const;
+  void list(const domain::Config& config, BoundedQueue<DirectoryListing>& queue) const;
+  void classify(DirectoryListing& listing) const;
+  DirectoryDelta reconcile(const DirectoryListing& listing) const;
+  void save_snapshot(const DirectoryListing& listing);
+  std::size_t apply_delta(DirectoryDelta& delta,
+                          std::vector<domain::AppImageRecord>& result,
+                          const OnAddedCallback& on_added = nullptr,
+                          const std::string& self_path = "",
+                          const OnEnsureDesktopCallback& on_ensure_desktop = nullptr,
+                          std::size_t budget = static_cast<std::size_t>(-1));
+  std::vector<domain::AppImageRecord> apply(const DirectoryListing& listing,
+                                            std::vector<domain::AppImageRecord>& result,
+                                            const OnAddedCallback& on_added = nullptr,
+                                            const std::string& self_path = "",
+                                            const OnEnsureDesktopCallback& on_ensure_desktop = nullptr);
+  void remove_stale(const std::vector<domain::AppImageRecord>& stale, const OnRemovedCallback& on_removed = nullptr);
 
 private:
+  struct FileId {
+    std::uint64_t device;
+    std::uint64_t inode;
+  };
+
+  using ListingSink = std::function<bool(DirectoryListing&&)>;
+
+  static std::optional<FileId> file_id(const std::string& path);
+  bool list_root(const std::string& root, const domain::Config& config, const ListingSink& sink) const;
+  DirectoryListing list_directory(const std::string& dir, const domain::Config& config) const;
+  std::optional<domain::AppImageRecord> scan_entry(const std::filesystem::path& p,
+                                                   const OnAddedCallback& on_added,
+                                                   const std::optional<FileId>& self,
+                                                   const OnEnsureDesktopCallback& on_ensure_desktop,
+                                                   const std::optional<ContentFingerprint>& known = std::nullopt);
+  std::uint64_t content_fingerprint(const std::string& path) const;
+  std::optional<domain::AppImageRecord> find_moved(std::uint64_t fingerprint,
+                                                   std::uint64_t inode,
+                                                   const std::string& path) const;
+
   domain::RegistryRepository* registry_;
+  domain::DirectorySnapshotRepository* snapshots_{nullptr};
+  AppImageProbeCache* probe_cache_{nullptr};
+  OnMovedCallback on_moved_;
 };
 
 }
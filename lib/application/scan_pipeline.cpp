@@ -0,0 +1,57 @@
+#include "scan_pipeline.hpp"
+#include <utility>
+
+namespace appimage_manager::application {
+
+ScanPipeline::ScanPipeline(const ScanDirectories& scan,
+                           const domain::Config& config,
+                           OnReadyCallback on_ready,
+                           std::size_t capacity)
+  : scan_(&scan)
+  , config_(config)
+  , on_ready_(std::move(on_ready))
+  , listed_(capacity)
+  , classified_(capacity)
+  , enumerate_thread_([this] { enumerate(); })
+  , classify_thread_([this] { classify(); }) {}
+
+ScanPipeline::~ScanPipeline() {
+  listed_.close();
+  classified_.close();
+  enumerate_thread_.join();
+  classify_thread_.join();
+}
+
+std::optional<ScanPipeline::DirectoryListing> ScanPipeline::next() {
+  return classified_.pop();
+}
+
+std::optional<ScanPipeline::DirectoryListing> ScanPipeline::try_next() {
+  return classified_.try_pop();
+}
+
+bool ScanPipeline::finished() const {
+  return classified_.drained();
+}
+
+void ScanPipeline::enumerate() {
+  scan_->list(config_, listed_);
+  listed_.close();
+}
+
+void ScanPipeline::classify() {
+  while (auto listing = listed_.pop()) {
+    scan_->classify(*listing);
+    if (!classified_.push(std::move(*listing))) {
+      listed_.close();
+      break;
+    }
+    if (on_ready_)
+      on_ready_();
+  }
+  classified_.close();
+  if (on_ready_)
+    on_ready_();
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <domain/entities/config.hpp>
+#include "bounded_queue.hpp"
+#include "scan_directories.hpp"
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <thread>
+
+namespace appimage_manager::application {
+
+class ScanPipeline {
+public:
+  using DirectoryListing = ScanDirectories::DirectoryListing;
+  using OnReadyCallback = std::function<void()>;
+
+  ScanPipeline(const ScanDirectories& scan,
+               const domain::Config& config,
+               OnReadyCallback on_ready = nullptr,
+               std::size_t capacity = 16);
+  ~ScanPipeline();
+  ScanPipeline(const ScanPipeline&) = delete;
+  ScanPipeline& operator=(const ScanPipeline&) = delete;
+
+  std::optional<DirectoryListing> next();
+  std::optional<DirectoryListing> try_next();
+  bool finished() const;
+
+private:
+  void enumerate();
+  void classify();
+
+  const ScanDirectories* scan_;
+  domain::Config config_;
+  OnReadyCallback on_ready_;
+  BoundedQueue<DirectoryListing> listed_;
+  BoundedQueue<DirectoryListing> classified_;
+  std::thread enumerate_thread_;
+  std::thread classify_thread_;
+};
+
+}
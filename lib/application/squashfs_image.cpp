@@ -0,0 +1,565 @@
+#include "squashfs_image.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef APPIMAGE_MANAGER_HAVE_XZ
+#include <lzma.h>
+#endif
+#ifdef APPIMAGE_MANAGER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef APPIMAGE_MANAGER_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace appimage_manager::application {
+
+namespace {
+
+constexpr std::uint32_t squashfs_magic = 0x73717368;
+constexpr std::size_t superblock_size = 96;
+constexpr std::size_t metadata_size = 8192;
+constexpr std::uint16_t metadata_uncompressed = 0x8000;
+constexpr std::uint32_t block_uncompressed = 1u << 24;
+constexpr std::uint32_t no_fragment = 0xFFFFFFFFu;
+constexpr std::size_t fragments_per_block = metadata_size / 16;
+constexpr std::uint64_t max_read_size = 64ull * 1024 * 1024;
+constexpr int max_symlink_hops = 40;
+constexpr int max_directory_depth = 64;
+
+constexpr std::uint16_t compressor_gzip = 1;
+constexpr std::uint16_t compressor_lzma = 2;
+constexpr std::uint16_t compressor_xz = 4;
+constexpr std::uint16_t compressor_lz4 = 5;
+constexpr std::uint16_t compressor_zstd = 6;
+
+constexpr std::uint16_t inode_dir = 1;
+constexpr std::uint16_t inode_file = 2;
+constexpr std::uint16_t inode_symlink = 3;
+constexpr std::uint16_t inode_ext_dir = 8;
+constexpr std::uint16_t inode_ext_file = 9;
+constexpr std::uint16_t inode_ext_symlink = 10;
+
+std::uint64_t read_le(const std::uint8_t* p, std::size_t n) {
+  std::uint64_t v = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+  return v;
+}
+
+std::uint16_t le16(const std::uint8_t* p) { return static_cast<std::uint16_t>(read_le(p, 2)); }
+std::uint32_t le32(const std::uint8_t* p) { return static_cast<std::uint32_t>(read_le(p, 4)); }
+std::uint64_t le64(const std::uint8_t* p) { return read_le(p, 8); }
+
+bool compressor_supported(std::uint16_t compressor) {
+  switch (compressor) {
+    case compressor_gzip: return true;
+#ifdef APPIMAGE_MANAGER_HAVE_XZ
+    case compressor_lzma: return true;
+    case compressor_xz: return true;
+#endif
+#ifdef APPIMAGE_MANAGER_HAVE_ZSTD
+    case compressor_zstd: return true;
+#endif
+#ifdef APPIMAGE_MANAGER_HAVE_LZ4
+    case compressor_lz4: return true;
+#endif
+    default: return false;
+  }
+}
+
+bool decompress(std::uint16_t compressor, const std::uint8_t* in, std::size_t in_size,
+                std::vector<std::uint8_t>& out, std::size_t max_out) {
+  out.resize(max_out);
+  switch (compressor) {
+    case compressor_gzip: {
+      uLongf out_size = static_cast<uLongf>(max_out);
+      if (::uncompress(out.data(), &out_size, in, static_cast<uLong>(in_size)) != Z_OK)
+        return false;
+      out.resize(out_size);
+      return true;
+    }
+#ifdef APPIMAGE_MANAGER_HAVE_XZ
+    case compressor_xz: {
+      std::uint64_t memlimit = UINT64_MAX;
+      std::size_t in_pos = 0;
+      std::size_t out_pos = 0;
+      if (lzma_stream_buffer_decode(&memlimit, 0, nullptr, in, &in_pos, in_size,
+                                    out.data(), &out_pos, max_out) != LZMA_OK)
+        return false;
+      out.resize(out_pos);
+      return true;
+    }
+    case compressor_lzma: {
+      lzma_stream stream = LZMA_STREAM_INIT;
+      if (lzma_alone_decoder(&stream, UINT64_MAX) != LZMA_OK)
+        return false;
+      stream.next_in = in;
+      stream.avail_in = in_size;
+      stream.next_out = out.data();
+      stream.avail_out = max_out;
+      lzma_ret ret = lzma_code(&stream, LZMA_FINISH);
+      std::size_t produced = max_out - stream.avail_out;
+      lzma_end(&stream);
+      if (ret != LZMA_STREAM_END && ret != LZMA_OK)
+        return false;
+      out.resize(produced);
+      return true;
+    }
+#endif
+#ifdef APPIMAGE_MANAGER_HAVE_ZSTD
+    case compressor_zstd: {
+      std::size_t n = ZSTD_decompress(out.data(), max_out, in, in_size);
+      if (ZSTD_isError(n))
+        return false;
+      out.resize(n);
+      return true;
+    }
+#endif
+#ifdef APPIMAGE_MANAGER_HAVE_LZ4
+    case compressor_lz4: {
+      int n = LZ4_decompress_safe(reinterpret_cast<const char*>(in), reinterpret_cast<char*>(out.data()),
+                                  static_cast<int>(in_size), static_cast<int>(max_out));
+      if (n < 0)
+        return false;
+      out.resize(static_cast<std::size_t>(n));
+      return true;
+    }
+#endif
+    default:
+      return false;
+  }
+}
+
+std::vector<std::string> split_path(const std::string& path) {
+  std::vector<std::string> parts;
+  std::size_t start = 0;
+  while (start <= path.size()) {
+    std::size_t end = path.find('/', start);
+    if (end == std::string::npos)
+      end = path.size();
+    if (end > start)
+      parts.push_back(path.substr(start, end - start));
+    start = end + 1;
+  }
+  return parts;
+}
+
+std::string join_path(const std::vector<std::string>& parts) {
+  std::string result;
+  for (const auto& part : parts) {
+    if (!result.empty())
+      result += '/';
+    result += part;
+  }
+  return result;
+}
+
+bool is_dir(std::uint16_t type) { return type == inode_dir || type == inode_ext_dir; }
+bool is_file(std::uint16_t type) { return type == inode_file || type == inode_ext_file; }
+bool is_symlink(std::uint16_t type) { return type == inode_symlink || type == inode_ext_symlink; }
+
+}
+
+SquashfsImage::SquashfsImage(const std::string& path, std::uint64_t offset)
+  : offset_(offset) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+  struct stat st;
+  std::uint8_t raw[superblock_size];
+  if (::fstat(fd, &st) != 0 || static_cast<std::uint64_t>(st.st_size) < offset + superblock_size ||
+      ::pread(fd, raw, superblock_size, static_cast<off_t>(offset)) != static_cast<ssize_t>(superblock_size)) {
+    ::close(fd);
+    return;
+  }
+  std::uint16_t block_log = le16(raw + 22);
+  sb_.block_size = le32(raw + 12);
+  sb_.fragment_count = le32(raw + 16);
+  sb_.compressor = le16(raw + 20);
+  sb_.root_inode = le64(raw + 32);
+  sb_.bytes_used = le64(raw + 40);
+  sb_.inode_table_start = le64(raw + 64);
+  sb_.directory_table_start = le64(raw + 72);
+  sb_.fragment_table_start = le64(raw + 80);
+  bool valid = le32(raw) == squashfs_magic &&
+               le16(raw + 28) == 4 && le16(raw + 30) == 0 &&
+               block_log >= 12 && block_log <= 20 && sb_.block_size == (1u << block_log) &&
+               sb_.bytes_used >= superblock_size &&
+               sb_.bytes_used <= static_cast<std::uint64_t>(st.st_size) - offset &&
+               sb_.inode_table_start < sb_.directory_table_start &&
+               sb_.directory_table_start < sb_.bytes_used &&
+               compressor_supported(sb_.compressor);
+  if (!valid) {
+    ::close(fd);
+    return;
+  }
+  fd_ = fd;
+  auto root = read_inode(sb_.root_inode);
+  if (!root || !is_dir(root->type)) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+SquashfsImage::~SquashfsImage() {
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+bool SquashfsImage::is_open() const {
+  return fd_ >= 0;
+}
+
+bool SquashfsImage::read_at(std::uint64_t pos, void* buf, std::size_t size) const {
+  if (pos > sb_.bytes_used || size > sb_.bytes_used - pos)
+    return false;
+  auto* out = static_cast<std::uint8_t*>(buf);
+  while (size > 0) {
+    ssize_t n = ::pread(fd_, out, size, static_cast<off_t>(offset_ + pos));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    out += n;
+    pos += static_cast<std::uint64_t>(n);
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+const SquashfsImage::MetadataBlock* SquashfsImage::metadata_block(std::uint64_t pos) const {
+  auto it = metadata_cache_.find(pos);
+  if (it != metadata_cache_.end())
+    return &it->second;
+  std::uint8_t header[2];
+  if (!read_at(pos, header, sizeof(header)))
+    return nullptr;
+  std::uint16_t word = le16(header);
+  std::size_t size = word & 0x7FFF;
+  if (size == 0 || size > metadata_size)
+    return nullptr;
+  std::vector<std::uint8_t> raw(size);
+  if (!read_at(pos + 2, raw.data(), size))
+    return nullptr;
+  MetadataBlock block;
+  block.next = pos + 2 + size;
+  if (word & metadata_uncompressed)
+    block.data = std::move(raw);
+  else if (!decompress(sb_.compressor, raw.data(), raw.size(), block.data, metadata_size))
+    return nullptr;
+  return &metadata_cache_.emplace(pos, std::move(block)).first->second;
+}
+
+bool SquashfsImage::read_metadata(MetadataCursor& cursor, void* buf, std::size_t size) const {
+  auto* out = static_cast<std::uint8_t*>(buf);
+  while (size > 0) {
+    const MetadataBlock* block = metadata_block(cursor.block);
+    if (!block)
+      return false;
+    if (cursor.offset >= block->data.size()) {
+      cursor.offset -= block->data.size();
+      cursor.block = block->next;
+      continue;
+    }
+    std::size_t n = std::min(size, block->data.size() - cursor.offset);
+    std::memcpy(out, block->data.data() + cursor.offset, n);
+    out += n;
+    size -= n;
+    cursor.offset += n;
+  }
+  return true;
+}
+
+std::optional<SquashfsImage::Inode> SquashfsImage::read_inode(std::uint64_t ref) const {
+  MetadataCursor cursor{sb_.inode_table_start + (ref >> 16), static_cast<std::size_t>(ref & 0xFFFF)};
+  std::uint8_t header[16];
+  if (!read_metadata(cursor, header, sizeof(header)))
+    return std::nullopt;
+  Inode inode;
+  inode.type = le16(header);
+  std::uint8_t body[40];
+  switch (inode.type) {
+    case inode_dir:
+      if (!read_metadata(cursor, body, 16))
+        return std::nullopt;
+      inode.dir_block = le32(body);
+      inode.dir_size = le16(body + 8);
+      inode.dir_offset = le16(body + 10);
+      return inode;
+    case inode_ext_dir:
+      if (!read_metadata(cursor, body, 24))
+        return std::nullopt;
+      inode.dir_size = le32(body + 4);
+      inode.dir_block = le32(body + 8);
+      inode.dir_offset = le16(body + 18);
+      return inode;
+    case inode_file:
+    case inode_ext_file: {
+      if (inode.type == inode_file) {
+        if (!read_metadata(cursor, body, 16))
+          return std::nullopt;
+        inode.blocks_start = le32(body);
+        inode.fragment = le32(body + 4);
+        inode.fragment_offset = le32(body + 8);
+        inode.file_size = le32(body + 12);
+      } else {
+        if (!read_metadata(cursor, body, 40))
+          return std::nullopt;
+        inode.blocks_start = le64(body);
+        inode.file_size = le64(body + 8);
+        inode.fragment = le32(body + 28);
+        inode.fragment_offset = le32(body + 32);
+      }
+      std::uint64_t count = inode.fragment == no_fragment
+        ? (inode.file_size + sb_.block_size - 1) / sb_.block_size
+        : inode.file_size / sb_.block_size;
+      if (count > sb_.bytes_used)
+        return std::nullopt;
+      std::vector<std::uint8_t> sizes(static_cast<std::size_t>(count) * 4);
+      if (!read_metadata(cursor, sizes.data(), sizes.size()))
+        return std::nullopt;
+      inode.block_sizes.resize(static_cast<std::size_t>(count));
+      for (std::size_t i = 0; i < inode.block_sizes.size(); ++i)
+        inode.block_sizes[i] = le32(sizes.data() + i * 4);
+      return inode;
+    }
+    case inode_symlink:
+    case inode_ext_symlink: {
+      if (!read_metadata(cursor, body, 8))
+        return std::nullopt;
+      std::uint32_t target_size = le32(body + 4);
+      if (target_size == 0 || target_size > 4096)
+        return std::nullopt;
+      inode.target.resize(target_size);
+      if (!read_metadata(cursor, inode.target.data(), target_size))
+        return std::nullopt;
+      return inode;
+    }
+    default:
+      return inode;
+  }
+}
+
+const std::vector<SquashfsImage::DirEntry>* SquashfsImage::directory(const Inode& dir) const {
+  std::uint64_t key = (static_cast<std::uint64_t>(dir.dir_block) << 16) | dir.dir_offset;
+  auto it = directory_cache_.find(key);
+  if (it != directory_cache_.end())
+    return &it->second;
+  std::vector<DirEntry> entries;
+  MetadataCursor cursor{sb_.directory_table_start + dir.dir_block, dir.dir_offset};
+  std::size_t remaining = dir.dir_size > 3 ? dir.dir_size - 3 : 0;
+  while (remaining >= 12) {
+    std::uint8_t header[12];
+    if (!read_metadata(cursor, header, sizeof(header)))
+      return nullptr;
+    remaining -= 12;
+    std::uint32_t count = le32(header) + 1;
+    std::uint32_t start = le32(header + 4);
+    if (count > 256)
+      return nullptr;
+    for (std::uint32_t i = 0; i < count; ++i) {
+      std::uint8_t raw[8];
+      if (remaining < sizeof(raw) || !read_metadata(cursor, raw, sizeof(raw)))
+        return nullptr;
+      std::size_t name_size = static_cast<std::size_t>(le16(raw + 6)) + 1;
+      if (remaining < sizeof(raw) + name_size)
+        return nullptr;
+      remaining -= sizeof(raw) + name_size;
+      DirEntry entry;
+      entry.name.resize(name_size);
+      if (!read_metadata(cursor, entry.name.data(), name_size))
+        return nullptr;
+      entry.inode_ref = (static_cast<std::uint64_t>(start) << 16) | le16(raw);
+      entries.push_back(std::move(entry));
+    }
+  }
+  return &directory_cache_.emplace(key, std::move(entries)).first->second;
+}
+
+std::optional<std::uint64_t> SquashfsImage::lookup(const std::string& path, std::string* resolved) const {
+  std::vector<std::string> pending = split_path(path);
+  std::reverse(pending.begin(), pending.end());
+  std::vector<std::string> names;
+  std::vector<std::uint64_t> refs{sb_.root_inode};
+  int hops = 0;
+  while (!pending.empty()) {
+    std::string name = std::move(pending.back());
+    pending.pop_back();
+    if (name == ".")
+      continue;
+    if (name == "..") {
+      if (!names.empty()) {
+        names.pop_back();
+        refs.pop_back();
+      }
+      continue;
+    }
+    auto parent = read_inode(refs.back());
+    if (!parent || !is_dir(parent->type))
+      return std::nullopt;
+    const std::vector<DirEntry>* entries = directory(*parent);
+    if (!entries)
+      return std::nullopt;
+    auto entry = std::find_if(entries->begin(), entries->end(),
+      [&name](const DirEntry& e) { return e.name == name; });
+    if (entry == entries->end())
+      return std::nullopt;
+    auto child = read_inode(entry->inode_ref);
+    if (!child)
+      return std::nullopt;
+    if (is_symlink(child->type)) {
+      if (++hops > max_symlink_hops)
+        return std::nullopt;
+      if (child->target.front() == '/') {
+        names.clear();
+        refs.resize(1);
+      }
+      std::vector<std::string> target = split_path(child->target);
+      pending.insert(pending.end(), target.rbegin(), target.rend());
+      continue;
+    }
+    names.push_back(std::move(name));
+    refs.push_back(entry->inode_ref);
+  }
+  if (resolved)
+    *resolved = join_path(names);
+  return refs.back();
+}
+
+std::optional<std::string> SquashfsImage::resolve(const std::string& path) const {
+  if (!is_open())
+    return std::nullopt;
+  std::string resolved;
+  if (!lookup(path, &resolved))
+    return std::nullopt;
+  return resolved;
+}
+
+const std::vector<std::uint8_t>* SquashfsImage::fragment_block(std::uint32_t index) const {
+  if (index >= sb_.fragment_count)
+    return nullptr;
+  auto cached = fragment_cache_.find(index);
+  if (cached != fragment_cache_.end())
+    return &cached->second;
+  std::uint8_t pointer[8];
+  if (!read_at(sb_.fragment_table_start + (index / fragments_per_block) * 8, pointer, sizeof(pointer)))
+    return nullptr;
+  MetadataCursor cursor{le64(pointer), (index % fragments_per_block) * 16};
+  std::uint8_t entry[16];
+  if (!read_metadata(cursor, entry, sizeof(entry)))
+    return nullptr;
+  std::uint64_t start = le64(entry);
+  std::uint32_t size_word = le32(entry + 8);
+  std::size_t size = size_word & (block_uncompressed - 1);
+  if (size == 0 || size > sb_.block_size)
+    return nullptr;
+  std::vector<std::uint8_t> raw(size);
+  if (!read_at(start, raw.data(), size))
+    return nullptr;
+  std::vector<std::uint8_t> data;
+  if (size_word & block_uncompressed)
+    data = std::move(raw);
+  else if (!decompress(sb_.compressor, raw.data(), raw.size(), data, sb_.block_size))
+    return nullptr;
+  return &fragment_cache_.emplace(index, std::move(data)).first->second;
+}
+
+std::optional<std::string> SquashfsImage::read_file(const std::string& path) const {
+  if (!is_open())
+    return std::nullopt;
+  auto ref = lookup(path, nullptr);
+  if (!ref)
+    return std::nullopt;
+  auto inode = read_inode(*ref);
+  if (!inode || !is_file(inode->type) || inode->file_size > max_read_size)
+    return std::nullopt;
+  std::string out;
+  out.reserve(static_cast<std::size_t>(inode->file_size));
+  std::uint64_t pos = inode->blocks_start;
+  std::vector<std::uint8_t> raw;
+  std::vector<std::uint8_t> block;
+  for (std::uint32_t size_word : inode->block_sizes) {
+    std::size_t expected = static_cast<std::size_t>(
+      std::min<std::uint64_t>(sb_.block_size, inode->file_size - out.size()));
+    std::size_t size = size_word & (block_uncompressed - 1);
+    if (size == 0) {
+      out.append(expected, '\0');
+      continue;
+    }
+    if (size > sb_.block_size)
+      return std::nullopt;
+    raw.resize(size);
+    if (!read_at(pos, raw.data(), size))
+      return std::nullopt;
+    pos += size;
+    if (size_word & block_uncompressed)
+      block.swap(raw);
+    else if (!decompress(sb_.compressor, raw.data(), raw.size(), block, sb_.block_size))
+      return std::nullopt;
+    if (block.size() < expected)
+      return std::nullopt;
+    out.append(reinterpret_cast<const char*>(block.data()), expected);
+  }
+  if (inode->fragment != no_fragment) {
+    const std::vector<std::uint8_t>* fragment = fragment_block(inode->fragment);
+    std::size_t tail = static_cast<std::size_t>(inode->file_size - out.size());
+    if (!fragment || inode->fragment_offset > fragment->size() ||
+        tail > fragment->size() - inode->fragment_offset)
+      return std::nullopt;
+    out.append(reinterpret_cast<const char*>(fragment->data()) + inode->fragment_offset, tail);
+  }
+  if (out.size() != inode->file_size)
+    return std::nullopt;
+  return out;
+}
+
+void SquashfsImage::list_directory(const Inode& dir, const std::string& prefix, int depth,
+                                   std::vector<std::string>& out) const {
+  if (depth > max_directory_depth)
+    return;
+  const std::vector<DirEntry>* entries = directory(dir);
+  if (!entries)
+    return;
+  for (const auto& entry : *entries) {
+    std::string path = prefix.empty() ? entry.name : prefix + "/" + entry.name;
+    out.push_back(path);
+    auto child = read_inode(entry.inode_ref);
+    if (child && is_dir(child->type))
+      list_directory(*child, path, depth + 1, out);
+  }
+}
+
+std::vector<std::string> SquashfsImage::list() const {
+  std::vector<std::string> result;
+  if (!is_open())
+    return result;
+  auto root = read_inode(sb_.root_inode);
+  if (root)
+    list_directory(*root, {}, 0, result);
+  return result;
+}
+
+std::vector<std::string> SquashfsImage::list(const std::string& dir) const {
+  std::vector<std::string> result;
+  if (!is_open())
+    return result;
+  auto ref = lookup(dir, nullptr);
+  auto inode = ref ? read_inode(*ref) : std::nullopt;
+  if (!inode || !is_dir(inode->type))
+    return result;
+  const std::vector<DirEntry>* entries = directory(*inode);
+  if (!entries)
+    return result;
+  std::string prefix = join_path(split_path(dir));
+  result.reserve(entries->size());
+  for (const auto& entry : *entries)
+    result.push_back(prefix.empty() ? entry.name : prefix + "/" + entry.name);
+  return result;
+}
+
+}
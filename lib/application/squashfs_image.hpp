@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace appimage_manager::application {
+
+class SquashfsImage {
+public:
+  SquashfsImage(const std::string& path, std::uint64_t offset);
+  ~SquashfsImage();
+  SquashfsImage(const SquashfsImage&) = delete;
+  SquashfsImage& operator=(const SquashfsImage&) = delete;
+
+  bool is_open() const;
+  std::vector<std::string> list() const;
+  std::vector<std::string> list(const std::string& dir) const;
+  std::optional<std::string> resolve(const std::string& path) const;
+  std::optional<std::string> read_file(const std::string& path) const;
+
+private:
+  struct Superblock {
+    std::uint32_t block_size{0};
+    std::uint32_t fragment_count{0};
+    std::uint16_t compressor{0};
+    std::uint64_t root_inode{0};
+    std::uint64_t bytes_used{0};
+    std::uint64_t inode_table_start{0};
+    std::uint64_t directory_table_start{0};
+    std::uint64_t fragment_table_start{0};
+  };
+
+  struct Inode {
+    std::uint16_t type{0};
+    std::uint32_t dir_block{0};
+    std::uint16_t dir_offset{0};
+    std::uint32_t dir_size{0};
+    std::uint64_t blocks_start{0};
+    std::uint64_t file_size{0};
+    std::uint32_t fragment{0};
+    std::uint32_t fragment_offset{0};
+    std::vector<std::uint32_t> block_sizes;
+    std::string target;
+  };
+
+  struct DirEntry {
+    std::string name;
+    std::uint64_t inode_ref{0};
+  };
+
+  struct MetadataBlock {
+    std::vector<std::uint8_t> data;
+    std::uint64_t next{0};
+  };
+
+  struct MetadataCursor {
+    std::uint64_t block{0};
+    std::size_t offset{0};
+  };
+
+  int fd_{-1};
+  std::uint64_t offset_{0};
+  Superblock sb_;
+  mutable std::unordered_map<std::uint64_t, MetadataBlock> metadata_cache_;
+  mutable std::unordered_map<std::uint64_t, std::vector<DirEntry>> directory_cache_;
+  mutable std::map<std::uint64_t, std::vector<std::uint8_t>> fragment_cache_;
+
+  bool read_at(std::uint64_t pos, void* buf, std::size_t size) const;
+  const MetadataBlock* metadata_block(std::uint64_t pos) const;
+  bool read_metadata(MetadataCursor& cursor, void* buf, std::size_t size) const;
+  std::optional<Inode> read_inode(std::uint64_t ref) const;
+  const std::vector<DirEntry>* directory(const Inode& dir) const;
+  std::optional<std::uint64_t> lookup(const std::string& path, std::string* resolved) const;
+  const std::vector<std::uint8_t>* fragment_block(std::uint32_t index) const;
+  void list_directory(const Inode& dir, const std::string& prefix, int depth,
+                      std::vector<std::string>& out) const;
+};
+
+}
@@ -0,0 +1,77 @@
+#include "watch_tree.hpp"
+#include <filesystem>
+#include <fnmatch.h>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace appimage_manager::application {
+
+bool is_excluded(const std::string& path, const std::vector<std::string>& patterns) {
+  std::string name = fs::path(path).filename().string();
+  for (const auto& pattern : patterns) {
+    const std::string& subject = pattern.find('/') != std::string::npos ? path : name;
+    if (::fnmatch(pattern.c_str(), subject.c_str(), 0) == 0)
+      return true;
+  }
+  return false;
+}
+
+int directory_depth(const std::string& root, const std::string& dir) {
+  fs::path relative = fs::path(dir).lexically_relative(fs::path(root));
+  if (relative.empty() || *relative.begin() == "..")
+    return -1;
+  int depth = 0;
+  for (const auto& part : relative)
+    if (part != ".")
+      ++depth;
+  return depth;
+}
+
+bool within_watch_tree(const std::string& root, const std::string& dir, const domain::Config& config) {
+  int depth = directory_depth(root, dir);
+  if (depth < 0)
+    return false;
+  if (depth == 0)
+    return true;
+  if (!config.recursive || (config.max_depth > 0 && depth > config.max_depth))
+    return false;
+  fs::path current(root);
+  for (const auto& part : fs::path(dir).lexically_relative(fs::path(root))) {
+    current /= part;
+    if (is_excluded(current.string(), config.exclude))
+      return false;
+  }
+  return true;
+}
+
+std::vector<std::string> collect_watch_directories(const std::string& root,
+                                                   const std::string& start,
+                                                   const domain::Config& config) {
+  std::vector<std::string> result;
+  if (!within_watch_tree(root, start, config))
+    return result;
+  std::vector<std::pair<std::string, int>> stack{{start, directory_depth(root, start)}};
+  while (!stack.empty()) {
+    auto [dir, depth] = std::move(stack.back());
+    stack.pop_back();
+    std::error_code ec;
+    if (!fs::is_directory(fs::path(dir), ec))
+      continue;
+    result.push_back(dir);
+    if (!config.recursive || (config.max_depth > 0 && depth >= config.max_depth))
+      continue;
+    fs::directory_iterator it(fs::path(dir), fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+      std::error_code entry_ec;
+      if (!it->is_directory(entry_ec) || it->is_symlink(entry_ec))
+        continue;
+      std::string child = it->path().string();
+      if (!is_excluded(child, config.exclude))
+        stack.emplace_back(std::move(child), depth + 1);
+    }
+  }
+  return result;
+}
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <domain/entities/config.hpp>
+#include <string>
+#include <vector>
+
+namespace appimage_manager::application {
+
+bool is_excluded(const std::string& path, const std::vector<std::string>& patterns);
+int directory_depth(const std::string& root, const std::string& dir);
+bool within_watch_tree(const std::string& root, const std::string& dir, const domain::Config& config);
+std::vector<std::string> collect_watch_directories(const std::string& root,
+                                                   const std::string& start,
+                                                   const domain::Config& config);
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace appimage_manager::domain {
+
+struct AppImageMetadata {
+  std::string name;
+  std::string summary;
+  std::string version;
+  std::string appstream_id;
+  std::string startup_wm_class;
+  std::vector<std::string> categories;
+  std::vector<std::string> mime_types;
+  std::string icon_path;
+  std::uint64_t content_hash{0};
+  bool operator==(const AppImageMetadata&) const = default;
+};
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "app_image_metadata.hpp"
 #include "install_type.hpp"
+#include <cstdint>
 #include <string>
 
 namespace appimage_manager::domain {
@@ -11,6 +13,9 @@ struct AppImageRecord {
   std::string name;
   InstallType install_type{InstallType::Downloaded};
   std::string added_at;
+  std::uint64_t fingerprint{0};
+  std::uint64_t inode{0};
+  AppImageMetadata metadata;
 };
 
 }
@@ -7,6 +7,12 @@ namespace appimage_manager::domain {
 
 struct Config {
   std::vector<std::string> watch_directories;
+  std::string registry_backend{"json"};
+  int icon_workers{0};
+  int quiet_period_ms{500};
+  bool recursive{false};
+  int max_depth{8};
+  std::vector<std::string> exclude;
 };
 
 }
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace appimage_manager::domain {
+
+struct DirectoryEntrySnapshot {
+  std::uint64_t inode{0};
+  std::int64_t size{0};
+  long long mtime_ns{0};
+  bool operator==(const DirectoryEntrySnapshot&) const = default;
+};
+
+struct DirectorySnapshot {
+  std::uint64_t device{0};
+  std::uint64_t inode{0};
+  long long mtime_ns{0};
+  long long scanned_ns{0};
+  std::unordered_map<std::string, DirectoryEntrySnapshot> entries;
+};
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../entities/directory_snapshot.hpp"
+#include <optional>
+#include <string>
+
+namespace appimage_manager::domain {
+
+class DirectorySnapshotRepository {
+public:
+  virtual ~DirectorySnapshotRepository() = default;
+  virtual std::optional<DirectorySnapshot> load(const std::string& dir) const = 0;
+  virtual void save(const std::string& dir, const DirectorySnapshot& snapshot) = 0;
+  virtual void remove(const std::string& dir) = 0;
+  virtual void begin() {}
+  virtual void commit() {}
+};
+
+class DirectorySnapshotBatch {
+public:
+  explicit DirectorySnapshotBatch(DirectorySnapshotRepository& repository) : repository_(&repository) { repository_->begin(); }
+  ~DirectorySnapshotBatch() { repository_->commit(); }
+  DirectorySnapshotBatch(const DirectorySnapshotBatch&) = delete;
+  DirectorySnapshotBatch& operator=(const DirectorySnapshotBatch&) = delete;
+
+private:
+  DirectorySnapshotRepository* repository_;
+};
+
+}
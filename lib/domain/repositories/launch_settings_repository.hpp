@@ -14,6 +14,19 @@ public:
   virtual void save(const std::string& app_id, const LaunchSettings& settings) = 0;
   virtual std::unordered_map<std::string, LaunchSettings> load_all() const = 0;
   virtual void remove(const std::string& app_id) = 0;
+  virtual void begin() {}
+  virtual void commit() {}
+};
+
+class LaunchSettingsBatch {
+public:
+  explicit LaunchSettingsBatch(LaunchSettingsRepository& repository) : repository_(&repository) { repository_->begin(); }
+  ~LaunchSettingsBatch() { repository_->commit(); }
+  LaunchSettingsBatch(const LaunchSettingsBatch&) = delete;
+  LaunchSettingsBatch& operator=(const LaunchSettingsBatch&) = delete;
+
+private:
+  LaunchSettingsRepository* repository_;
 };
 
 }
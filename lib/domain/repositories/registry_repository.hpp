@@ -1,11 +1,24 @@
 #pragma once
 
 #include "../entities/app_image_record.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <optional>
 
 namespace appimage_manager::domain {
 
+inline std::string directory_prefix(const std::string& dir) {
+  return !dir.empty() && dir.back() == '/' ? dir : dir + "/";
+}
+
+inline bool directly_in(const std::string& path, const std::string& prefix) {
+  return path.size() > prefix.size() && path.compare(0, prefix.size(), prefix) == 0 &&
+         path.find('/', prefix.size()) == std::string::npos;
+}
+
 class RegistryRepository {
 public:
   virtual ~RegistryRepository() = default;
@@ -15,6 +28,41 @@ public:
   virtual void save(const AppImageRecord& record) = 0;
   virtual void remove_by_path(const std::string& path) = 0;
   virtual void remove(const std::string& id) = 0;
+  virtual std::vector<AppImageRecord> page(std::size_t offset, std::size_t limit) const {
+    std::vector<AppImageRecord> records = all();
+    std::size_t begin = std::min(offset, records.size());
+    std::size_t end = limit == 0 ? records.size() : std::min(begin + limit, records.size());
+    return std::vector<AppImageRecord>(std::make_move_iterator(records.begin() + static_cast<std::ptrdiff_t>(begin)),
+                                       std::make_move_iterator(records.begin() + static_cast<std::ptrdiff_t>(end)));
+  }
+  virtual std::vector<AppImageRecord> by_fingerprint(std::uint64_t fingerprint) const {
+    std::vector<AppImageRecord> result;
+    for (auto& record : all())
+      if (record.fingerprint == fingerprint)
+        result.push_back(std::move(record));
+    return result;
+  }
+  virtual std::vector<AppImageRecord> in_directory(const std::string& dir) const {
+    std::string prefix = directory_prefix(dir);
+    std::vector<AppImageRecord> result;
+    for (auto& record : all())
+      if (directly_in(record.path, prefix))
+        result.push_back(std::move(record));
+    return result;
+  }
+  virtual void begin() {}
+  virtual void commit() {}
+};
+
+class RegistryBatch {
+public:
+  explicit RegistryBatch(RegistryRepository& registry) : registry_(&registry) { registry_->begin(); }
+  ~RegistryBatch() { registry_->commit(); }
+  RegistryBatch(const RegistryBatch&) = delete;
+  RegistryBatch& operator=(const RegistryBatch&) = delete;
+
+private:
+  RegistryRepository* registry_;
 };
 
 }
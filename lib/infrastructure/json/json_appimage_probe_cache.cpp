@@ -0,0 +1,164 @@
+#include "json_appimage_probe_cache.hpp"
+#include <nlohmann/json.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace appimage_manager::infrastructure {
+
+namespace {
+
+constexpr const char* cache_filename = "probe-cache.json";
+
+std::string stamp_key(const FileStamp& stamp) {
+  return std::to_string(stamp.device) + ":" + std::to_string(stamp.inode);
+}
+
+std::string hash_to_hex(std::uint64_t hash) {
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+  return buf;
+}
+
+}
+
+JsonAppImageProbeCache::JsonAppImageProbeCache(const std::string& cache_dir,
+                                               ProbeFunction probe_fn,
+                                               WriteBehindQueue* writer)
+  : cache_dir_(cache_dir)
+  , probe_fn_(std::move(probe_fn))
+  , writer_(writer) {}
+
+JsonAppImageProbeCache::~JsonAppImageProbeCache() {
+  if (dirty_)
+    persist();
+}
+
+std::string JsonAppImageProbeCache::cache_path() const {
+  return (fs::path(cache_dir_) / cache_filename).string();
+}
+
+void JsonAppImageProbeCache::load() {
+  loaded_ = true;
+  auto content = load_file(writer_, cache_path());
+  if (!content)
+    return;
+  try {
+    nlohmann::json j = nlohmann::json::parse(*content);
+    if (!j.contains("entries") || !j["entries"].is_array())
+      return;
+    for (const auto& e : j["entries"]) {
+      Entry entry;
+      entry.path = e.value("path", std::string{});
+      entry.stamp.exists = true;
+      entry.stamp.device = e.value("device", static_cast<dev_t>(0));
+      entry.stamp.inode = e.value("inode", static_cast<ino_t>(0));
+      entry.stamp.size = e.value("size", static_cast<off_t>(0));
+      entry.stamp.mtime_ns = e.value("mtime_ns", 0LL);
+      entry.probe.squashfs_offset = e.value("offset", std::uint64_t{0});
+      entry.probe.compression = e.value("compression", std::uint16_t{0});
+      entry.probe.content_hash = std::stoull(e.value("hash", std::string{"0"}), nullptr, 16);
+      if (stat_file(entry.path) == entry.stamp)
+        entries_[stamp_key(entry.stamp)] = entry;
+      else
+        dirty_ = true;
+    }
+  } catch (...) {
+    entries_.clear();
+    dirty_ = false;
+  }
+}
+
+void JsonAppImageProbeCache::persist() {
+  dirty_ = false;
+  nlohmann::json j;
+  nlohmann::json arr = nlohmann::json::array();
+  for (const auto& [key, entry] : entries_) {
+    nlohmann::json e;
+    e["path"] = entry.path;
+    e["device"] = entry.stamp.device;
+    e["inode"] = entry.stamp.inode;
+    e["size"] = entry.stamp.size;
+    e["mtime_ns"] = entry.stamp.mtime_ns;
+    e["offset"] = entry.probe.squashfs_offset;
+    e["compression"] = entry.probe.compression;
+    e["hash"] = hash_to_hex(entry.probe.content_hash);
+    arr.push_back(e);
+  }
+  j["entries"] = arr;
+  std::error_code ec;
+  fs::create_directories(cache_dir_, ec);
+  store_file(writer_, cache_path(), j.dump(2));
+}
+
+std::optional<application::AppImageProbe> JsonAppImageProbeCache::probe(const std::string& appimage_path) {
+  FileStamp stamp = stat_file(appimage_path);
+  if (!stamp.exists)
+    return std::nullopt;
+  std::string key = stamp_key(stamp);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loaded_)
+      load();
+    auto it = entries_.find(key);
+    if (it != entries_.end() && it->second.stamp == stamp) {
+      if (it->second.path != appimage_path) {
+        it->second.path = appimage_path;
+        dirty_ = true;
+        write_back();
+      }
+      return it->second.probe;
+    }
+  }
+  auto probe = probe_fn_(appimage_path);
+  if (!probe)
+    return std::nullopt;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.path == appimage_path && it->first != key)
+      it = entries_.erase(it);
+    else
+      ++it;
+  }
+  entries_[key] = Entry{appimage_path, stamp, *probe};
+  dirty_ = true;
+  write_back();
+  return probe;
+}
+
+void JsonAppImageProbeCache::forget(const std::string& appimage_path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!loaded_)
+    load();
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.path == appimage_path) {
+      it = entries_.erase(it);
+      dirty_ = true;
+    } else {
+      ++it;
+    }
+  }
+  write_back();
+}
+
+void JsonAppImageProbeCache::write_back() {
+  if (dirty_ && batch_depth_ == 0)
+    persist();
+}
+
+void JsonAppImageProbeCache::begin() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++batch_depth_;
+}
+
+void JsonAppImageProbeCache::commit() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (batch_depth_ == 0 || --batch_depth_ > 0)
+    return;
+  if (dirty_)
+    persist();
+}
+
+}
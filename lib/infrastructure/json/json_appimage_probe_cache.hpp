@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../../application/appimage_probe_cache.hpp"
+#include "../persistence/file_stamp.hpp"
+#include "../persistence/write_behind_queue.hpp"
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace appimage_manager::infrastructure {
+
+class JsonAppImageProbeCache : public application::AppImageProbeCache {
+public:
+  using ProbeFunction = std::function<std::optional<application::AppImageProbe>(const std::string&)>;
+
+  JsonAppImageProbeCache(const std::string& cache_dir,
+                         ProbeFunction probe_fn,
+                         WriteBehindQueue* writer = nullptr);
+  ~JsonAppImageProbeCache() override;
+  JsonAppImageProbeCache(const JsonAppImageProbeCache&) = delete;
+  JsonAppImageProbeCache& operator=(const JsonAppImageProbeCache&) = delete;
+
+  std::optional<application::AppImageProbe> probe(const std::string& appimage_path) override;
+  void forget(const std::string& appimage_path) override;
+  void begin() override;
+  void commit() override;
+
+private:
+  struct Entry {
+    std::string path;
+    FileStamp stamp;
+    application::AppImageProbe probe;
+  };
+
+  std::string cache_dir_;
+  ProbeFunction probe_fn_;
+  WriteBehindQueue* writer_;
+  std::mutex mutex_;
+  bool loaded_{false};
+  bool dirty_{false};
+  int batch_depth_{0};
+  std::unordered_map<std::string, Entry> entries_;
+
+  std::string cache_path() const;
+  void load();
+  void persist();
+  void write_back();
+};
+
+}
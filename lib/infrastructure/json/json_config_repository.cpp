@@ -1,6 +1,6 @@
 #include "json_config_repository.hpp"
+#include "../persistence/write_behind_queue.hpp"
 #include <nlohmann/json.hpp>
-#include <fstream>
 #include <filesystem>
 
 namespace fs = std::filesystem;
@@ -13,8 +13,10 @@ constexpr const char* config_filename = "config.json";
 
 }
 
-JsonConfigRepository::JsonConfigRepository(const std::string& config_dir)
-  : config_dir_(config_dir) {}
+JsonConfigRepository::JsonConfigRepository(const std::string& config_dir,
+                                           WriteBehindQueue* writer)
+  : config_dir_(config_dir)
+  , writer_(writer) {}
 
 std::string JsonConfigRepository::config_path() const {
   return (fs::path(config_dir_) / config_filename).string();
@@ -22,35 +24,46 @@ std::string JsonConfigRepository::config_path() const {
 
 domain::Config JsonConfigRepository::load() const {
   domain::Config result;
-  std::string path = config_path();
-  if (!fs::is_regular_file(path))
-    return result;
-  std::ifstream f(path);
-  if (!f)
+  auto content = load_file(writer_, config_path());
+  if (!content)
     return result;
   try {
-    nlohmann::json j = nlohmann::json::parse(f);
+    nlohmann::json j = nlohmann::json::parse(*content);
     if (j.contains("watch_directories") && j["watch_directories"].is_array()) {
       for (const auto& item : j["watch_directories"])
         if (item.is_string())
           result.watch_directories.push_back(item.get<std::string>());
     }
+    if (j.contains("registry_backend") && j["registry_backend"].is_string())
+      result.registry_backend = j["registry_backend"].get<std::string>();
+    if (j.contains("icon_workers") && j["icon_workers"].is_number_integer())
+      result.icon_workers = j["icon_workers"].get<int>();
+    if (j.contains("quiet_period_ms") && j["quiet_period_ms"].is_number_integer())
+      result.quiet_period_ms = j["quiet_period_ms"].get<int>();
+    if (j.contains("recursive") && j["recursive"].is_boolean())
+      result.recursive = j["recursive"].get<bool>();
+    if (j.contains("max_depth") && j["max_depth"].is_number_integer())
+      result.max_depth = j["max_depth"].get<int>();
+    if (j.contains("exclude") && j["exclude"].is_array()) {
+      for (const auto& item : j["exclude"])
+        if (item.is_string())
+          result.exclude.push_back(item.get<std::string>());
+    }
   } catch (...) {
   }
   return result;
 }
 
 void JsonConfigRepository::save(const domain::Config& config) {
-  std::string path = config_path();
-  fs::path dir(path);
-  dir.remove_filename();
-  if (!dir.empty())
-    fs::create_directories(dir);
   nlohmann::json j;
   j["watch_directories"] = config.watch_directories;
-  std::ofstream f(path);
-  if (f)
-    f << j.dump(2);
+  j["registry_backend"] = config.registry_backend;
+  j["icon_workers"] = config.icon_workers;
+  j["quiet_period_ms"] = config.quiet_period_ms;
+  j["recursive"] = config.recursive;
+  j["max_depth"] = config.max_depth;
+  j["exclude"] = config.exclude;
+  store_file(writer_, config_path(), j.dump(2));
 }
 
 }
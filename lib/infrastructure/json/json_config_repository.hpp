@@ -2,18 +2,21 @@
 
 #include "../../domain/repositories/config_repository.hpp"
 #include "../../domain/entities/config.hpp"
+#include "../persistence/write_behind_queue.hpp"
 #include <string>
 
 namespace appimage_manager::infrastructure {
 
 class JsonConfigRepository : public domain::ConfigRepository {
 public:
-  explicit JsonConfigRepository(const std::string& config_dir);
+  explicit JsonConfigRepository(const std::string& config_dir,
+                                WriteBehindQueue* writer = nullptr);
   domain::Config load() const override;
   void save(const domain::Config& config) override;
 
 private:
   std::string config_dir_;
+  WriteBehindQueue* writer_;
   std::string config_path() const;
 };
 
@@ -0,0 +1,121 @@
+#include "json_directory_snapshot_repository.hpp"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace appimage_manager::infrastructure {
+
+namespace {
+
+constexpr const char* cache_filename = "directory-snapshots.json";
+
+}
+
+JsonDirectorySnapshotRepository::JsonDirectorySnapshotRepository(const std::string& cache_dir,
+                                                                 WriteBehindQueue* writer)
+  : cache_dir_(cache_dir)
+  , writer_(writer) {}
+
+std::string JsonDirectorySnapshotRepository::cache_path() const {
+  return (fs::path(cache_dir_) / cache_filename).string();
+}
+
+void JsonDirectorySnapshotRepository::ensure_loaded() const {
+  if (loaded_)
+    return;
+  loaded_ = true;
+  auto content = load_file(writer_, cache_path());
+  if (!content)
+    return;
+  try {
+    nlohmann::json j = nlohmann::json::parse(*content);
+    if (!j.contains("directories") || !j["directories"].is_object())
+      return;
+    for (auto it = j["directories"].begin(); it != j["directories"].end(); ++it) {
+      const auto& d = it.value();
+      domain::DirectorySnapshot snapshot;
+      snapshot.device = d.value("device", std::uint64_t{0});
+      snapshot.inode = d.value("inode", std::uint64_t{0});
+      snapshot.mtime_ns = d.value("mtime_ns", 0LL);
+      snapshot.scanned_ns = d.value("scanned_ns", 0LL);
+      if (d.contains("entries") && d["entries"].is_object()) {
+        for (auto e = d["entries"].begin(); e != d["entries"].end(); ++e) {
+          domain::DirectoryEntrySnapshot entry;
+          entry.inode = e.value().value("inode", std::uint64_t{0});
+          entry.size = e.value().value("size", std::int64_t{0});
+          entry.mtime_ns = e.value().value("mtime_ns", 0LL);
+          snapshot.entries.emplace(e.key(), entry);
+        }
+      }
+      snapshots_.emplace(it.key(), std::move(snapshot));
+    }
+  } catch (...) {
+    snapshots_.clear();
+  }
+}
+
+void JsonDirectorySnapshotRepository::write_back() {
+  if (batch_depth_ > 0) {
+    dirty_ = true;
+    return;
+  }
+  dirty_ = false;
+  nlohmann::json directories = nlohmann::json::object();
+  for (const auto& [dir, snapshot] : snapshots_) {
+    nlohmann::json d;
+    d["device"] = snapshot.device;
+    d["inode"] = snapshot.inode;
+    d["mtime_ns"] = snapshot.mtime_ns;
+    d["scanned_ns"] = snapshot.scanned_ns;
+    nlohmann::json entries = nlohmann::json::object();
+    for (const auto& [name, entry] : snapshot.entries)
+      entries[name] = {{"inode", entry.inode}, {"size", entry.size}, {"mtime_ns", entry.mtime_ns}};
+    d["entries"] = std::move(entries);
+    directories[dir] = std::move(d);
+  }
+  nlohmann::json j;
+  j["directories"] = std::move(directories);
+  std::error_code ec;
+  fs::create_directories(cache_dir_, ec);
+  store_file(writer_, cache_path(), j.dump());
+}
+
+std::optional<domain::DirectorySnapshot> JsonDirectorySnapshotRepository::load(const std::string& dir) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ensure_loaded();
+  auto it = snapshots_.find(dir);
+  if (it == snapshots_.end())
+    return std::nullopt;
+  return it->second;
+}
+
+void JsonDirectorySnapshotRepository::save(const std::string& dir, const domain::DirectorySnapshot& snapshot) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ensure_loaded();
+  snapshots_[dir] = snapshot;
+  write_back();
+}
+
+void JsonDirectorySnapshotRepository::remove(const std::string& dir) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ensure_loaded();
+  if (snapshots_.erase(dir) == 0)
+    return;
+  write_back();
+}
+
+void JsonDirectorySnapshotRepository::begin() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++batch_depth_;
+}
+
+void JsonDirectorySnapshotRepository::commit() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (batch_depth_ == 0 || --batch_depth_ > 0)
+    return;
+  if (dirty_)
+    write_back();
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../../domain/repositories/directory_snapshot_repository.hpp"
+#include "../../domain/entities/directory_snapshot.hpp"
+#include "../persistence/write_behind_queue.hpp"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace appimage_manager::infrastructure {
+
+class JsonDirectorySnapshotRepository : public domain::DirectorySnapshotRepository {
+public:
+  explicit JsonDirectorySnapshotRepository(const std::string& cache_dir,
+                                           WriteBehindQueue* writer = nullptr);
+  std::optional<domain::DirectorySnapshot> load(const std::string& dir) const override;
+  void save(const std::string& dir, const domain::DirectorySnapshot& snapshot) override;
+  void remove(const std::string& dir) override;
+  void begin() override;
+  void commit() override;
+
+private:
+  std::string cache_dir_;
+  WriteBehindQueue* writer_;
+  mutable std::mutex mutex_;
+  mutable bool loaded_{false};
+  mutable std::unordered_map<std::string, domain::DirectorySnapshot> snapshots_;
+  int batch_depth_{0};
+  bool dirty_{false};
+
+  std::string cache_path() const;
+  void ensure_loaded() const;
+  void write_back();
+};
+
+}
@@ -1,6 +1,6 @@
 #include "json_launch_settings_repository.hpp"
+#include "../persistence/write_behind_queue.hpp"
 #include <nlohmann/json.hpp>
-#include <fstream>
 #include <filesystem>
 
 namespace fs = std::filesystem;
@@ -49,31 +49,22 @@ nlohmann::json launch_settings_to_json(const domain::LaunchSettings& ls) {
 
 }
 
-JsonLaunchSettingsRepository::JsonLaunchSettingsRepository(const std::string& config_dir)
-  : config_dir_(config_dir) {}
+JsonLaunchSettingsRepository::JsonLaunchSettingsRepository(const std::string& config_dir,
+                                                           WriteBehindQueue* writer)
+  : config_dir_(config_dir)
+  , writer_(writer) {}
 
 std::string JsonLaunchSettingsRepository::launch_settings_path() const {
   return (fs::path(config_dir_) / launch_settings_filename).string();
 }
 
-std::optional<domain::LaunchSettings> JsonLaunchSettingsRepository::load(const std::string& app_id) const {
-  auto all = load_all();
-  auto it = all.find(app_id);
-  if (it == all.end())
-    return std::nullopt;
-  return it->second;
-}
-
-std::unordered_map<std::string, domain::LaunchSettings> JsonLaunchSettingsRepository::load_all() const {
+std::unordered_map<std::string, domain::LaunchSettings> JsonLaunchSettingsRepository::read() const {
   std::unordered_map<std::string, domain::LaunchSettings> result;
-  std::string path = launch_settings_path();
-  if (!fs::is_regular_file(path))
-    return result;
-  std::ifstream f(path);
-  if (!f)
+  auto content = load_file(writer_, launch_settings_path());
+  if (!content)
     return result;
   try {
-    nlohmann::json j = nlohmann::json::parse(f);
+    nlohmann::json j = nlohmann::json::parse(*content);
     if (!j.contains("settings") || !j["settings"].is_object())
       return result;
     for (auto it = j["settings"].begin(); it != j["settings"].end(); ++it)
@@ -83,40 +74,69 @@ std::unordered_map<std::string, domain::LaunchSettings> JsonLaunchSettingsReposi
   return result;
 }
 
-void JsonLaunchSettingsRepository::save(const std::string& app_id, const domain::LaunchSettings& settings) {
-  auto all = load_all();
-  all[app_id] = settings;
-  std::string path = launch_settings_path();
-  fs::path dir(path);
-  dir.remove_filename();
-  if (!dir.empty())
-    fs::create_directories(dir);
+void JsonLaunchSettingsRepository::persist(const std::unordered_map<std::string, domain::LaunchSettings>& all) const {
   nlohmann::json j;
-  nlohmann::json settings_obj;
+  nlohmann::json settings_obj = nlohmann::json::object();
   for (const auto& [id, ls] : all)
     settings_obj[id] = launch_settings_to_json(ls);
   j["settings"] = settings_obj;
-  std::ofstream f(path);
-  if (f)
-    f << j.dump(2);
+  store_file(writer_, launch_settings_path(), j.dump(2));
+}
+
+void JsonLaunchSettingsRepository::refresh() const {
+  FileStamp stamp = stat_file(launch_settings_path());
+  if (loaded_ && (dirty_ || stamp == stamp_ || (writer_ && writer_->has_pending(launch_settings_path()))))
+    return;
+  settings_ = read();
+  stamp_ = stamp;
+  loaded_ = true;
+}
+
+void JsonLaunchSettingsRepository::write_back() {
+  if (batch_depth_ > 0) {
+    dirty_ = true;
+    return;
+  }
+  persist(settings_);
+  stamp_ = stat_file(launch_settings_path());
+  dirty_ = false;
+}
+
+void JsonLaunchSettingsRepository::begin() {
+  ++batch_depth_;
+}
+
+void JsonLaunchSettingsRepository::commit() {
+  if (batch_depth_ == 0 || --batch_depth_ > 0)
+    return;
+  if (dirty_)
+    write_back();
+}
+
+std::optional<domain::LaunchSettings> JsonLaunchSettingsRepository::load(const std::string& app_id) const {
+  refresh();
+  auto it = settings_.find(app_id);
+  if (it == settings_.end())
+    return std::nullopt;
+  return it->second;
+}
+
+std::unordered_map<std::string, domain::LaunchSettings> JsonLaunchSettingsRepository::load_all() const {
+  refresh();
+  return settings_;
+}
+
+void JsonLaunchSettingsRepository::save(const std::string& app_id, const domain::LaunchSettings& settings) {
+  refresh();
+  settings_[app_id] = settings;
+  write_back();
 }
 
 void JsonLaunchSettingsRepository::remove(const std::string& app_id) {
-  auto all = load_all();
-  all.erase(app_id);
-  std::string path = launch_settings_path();
-  fs::path dir(path);
-  dir.remove_filename();
-  if (!dir.empty())
-    fs::create_directories(dir);
-  nlohmann::json j;
-  nlohmann::json settings_obj;
-  for (const auto& [id, ls] : all)
-    settings_obj[id] = launch_settings_to_json(ls);
-  j["settings"] = settings_obj;
-  std::ofstream f(path);
-  if (f)
-    f << j.dump(2);
+  refresh();
+  if (settings_.erase(app_id) == 0)
+    return;
+  write_back();
 }
 
 }
@@ -2,21 +2,38 @@
 
 #include "../../domain/repositories/launch_settings_repository.hpp"
 #include "../../domain/entities/launch_settings.hpp"
+#include "../persistence/file_stamp.hpp"
+#include "../persistence/write_behind_queue.hpp"
 #include <string>
+#include <unordered_map>
 
 namespace appimage_manager::infrastructure {
 
 class JsonLaunchSettingsRepository : public domain::LaunchSettingsRepository {
 public:
-  explicit JsonLaunchSettingsRepository(const std::string& config_dir);
+  explicit JsonLaunchSettingsRepository(const std::string& config_dir,
+                                        WriteBehindQueue* writer = nullptr);
   std::optional<domain::LaunchSettings> load(const std::string& app_id) const override;
   void save(const std::string& app_id, const domain::LaunchSettings& settings) override;
   std::unordered_map<std::string, domain::LaunchSettings> load_all() const override;
   void remove(const std::string& app_id) override;
+  void begin() override;
+  void commit() override;
 
 private:
   std::string config_dir_;
+  WriteBehindQueue* writer_;
+  mutable bool loaded_{false};
+  mutable FileStamp stamp_;
+  mutable std::unordered_map<std::string, domain::LaunchSettings> settings_;
+  int batch_depth_{0};
+  bool dirty_{false};
+
   std::string launch_settings_path() const;
+  void refresh() const;
+  void write_back();
+  std::unordered_map<std::string, domain::LaunchSettings> read() const;
+  void persist(const std::unordered_map<std::string, domain::LaunchSettings>& all) const;
 };
 
 }
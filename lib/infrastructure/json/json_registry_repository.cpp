@@ -1,8 +1,9 @@
 #include "json_registry_repository.hpp"
+#include "../persistence/write_behind_queue.hpp"
 #include <nlohmann/json.hpp>
 #include <chrono>
+#include <cstdint>
 #include <ctime>
-#include <fstream>
 #include <filesystem>
 #include <algorithm>
 
@@ -14,6 +15,22 @@ namespace {
 
 constexpr const char* registry_filename = "registry.json";
 
+std::string directory_of(const std::string& path) {
+  std::size_t slash = path.rfind('/');
+  return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+template <typename Map, typename Key>
+void erase_entry(Map& map, const Key& key, std::size_t i) {
+  auto [first, last] = map.equal_range(key);
+  for (auto it = first; it != last; ++it) {
+    if (it->second == i) {
+      map.erase(it);
+      return;
+    }
+  }
+}
+
 std::string now_iso8601_utc() {
   auto now = std::chrono::system_clock::now();
   auto t = std::chrono::system_clock::to_time_t(now);
@@ -40,10 +57,51 @@ domain::InstallType string_to_install_type(const std::string& s) {
   return domain::InstallType::Downloaded;
 }
 
+nlohmann::json metadata_to_json(const domain::AppImageMetadata& m) {
+  nlohmann::json j;
+  j["name"] = m.name;
+  j["summary"] = m.summary;
+  j["version"] = m.version;
+  j["appstream_id"] = m.appstream_id;
+  j["startup_wm_class"] = m.startup_wm_class;
+  j["categories"] = m.categories;
+  j["mime_types"] = m.mime_types;
+  j["icon_path"] = m.icon_path;
+  j["content_hash"] = m.content_hash;
+  return j;
+}
+
+void read_string_list(const nlohmann::json& j, const char* key, std::vector<std::string>& out) {
+  if (!j.contains(key) || !j[key].is_array())
+    return;
+  for (const auto& item : j[key])
+    if (item.is_string())
+      out.push_back(item.get<std::string>());
+}
+
+domain::AppImageMetadata metadata_from_json(const nlohmann::json& j) {
+  domain::AppImageMetadata m;
+  if (j.contains("name") && j["name"].is_string()) m.name = j["name"].get<std::string>();
+  if (j.contains("summary") && j["summary"].is_string()) m.summary = j["summary"].get<std::string>();
+  if (j.contains("version") && j["version"].is_string()) m.version = j["version"].get<std::string>();
+  if (j.contains("appstream_id") && j["appstream_id"].is_string())
+    m.appstream_id = j["appstream_id"].get<std::string>();
+  if (j.contains("startup_wm_class") && j["startup_wm_class"].is_string())
+    m.startup_wm_class = j["startup_wm_class"].get<std::string>();
+  read_string_list(j, "categories", m.categories);
+  read_string_list(j, "mime_types", m.mime_types);
+  if (j.contains("icon_path") && j["icon_path"].is_string()) m.icon_path = j["icon_path"].get<std::string>();
+  if (j.contains("content_hash") && j["content_hash"].is_number_unsigned())
+    m.content_hash = j["content_hash"].get<std::uint64_t>();
+  return m;
 }
 
-JsonRegistryRepository::JsonRegistryRepository(const std::string& config_dir)
-  : config_dir_(config_dir) {}
+}
+
+JsonRegistryRepository::JsonRegistryRepository(const std::string& config_dir,
+                                               WriteBehindQueue* writer)
+  : config_dir_(config_dir)
+  , writer_(writer) {}
 
 std::string JsonRegistryRepository::registry_path() const {
   return (fs::path(config_dir_) / registry_filename).string();
@@ -51,14 +109,11 @@ std::string JsonRegistryRepository::registry_path() const {
 
 std::vector<domain::AppImageRecord> JsonRegistryRepository::load() const {
   std::vector<domain::AppImageRecord> result;
-  std::string path = registry_path();
-  if (!fs::is_regular_file(path))
-    return result;
-  std::ifstream f(path);
-  if (!f)
+  auto content = load_file(writer_, registry_path());
+  if (!content)
     return result;
   try {
-    nlohmann::json j = nlohmann::json::parse(f);
+    nlohmann::json j = nlohmann::json::parse(*content);
     if (!j.contains("entries") || !j["entries"].is_array())
       return result;
     for (const auto& e : j["entries"]) {
@@ -70,6 +125,12 @@ std::vector<domain::AppImageRecord> JsonRegistryRepository::load() const {
         record.install_type = string_to_install_type(e["install_type"].get<std::string>());
       if (e.contains("added_at") && e["added_at"].is_string())
         record.added_at = e["added_at"].get<std::string>();
+      if (e.contains("fingerprint") && e["fingerprint"].is_number_unsigned())
+        record.fingerprint = e["fingerprint"].get<std::uint64_t>();
+      if (e.contains("inode") && e["inode"].is_number_unsigned())
+        record.inode = e["inode"].get<std::uint64_t>();
+      if (e.contains("metadata") && e["metadata"].is_object())
+        record.metadata = metadata_from_json(e["metadata"]);
       result.push_back(record);
     }
   } catch (...) {
@@ -78,11 +139,6 @@ std::vector<domain::AppImageRecord> JsonRegistryRepository::load() const {
 }
 
 void JsonRegistryRepository::persist(const std::vector<domain::AppImageRecord>& records) const {
-  std::string path = registry_path();
-  fs::path dir(path);
-  dir.remove_filename();
-  if (!dir.empty())
-    fs::create_directories(dir);
   nlohmann::json j;
   nlohmann::json arr = nlohmann::json::array();
   for (const auto& r : records) {
@@ -92,69 +148,173 @@ void JsonRegistryRepository::persist(const std::vector<domain::AppImageRecord>&
     e["name"] = r.name;
     e["install_type"] = install_type_to_string(r.install_type);
     e["added_at"] = r.added_at;
+    if (r.fingerprint != 0)
+      e["fingerprint"] = r.fingerprint;
+    if (r.inode != 0)
+      e["inode"] = r.inode;
+    if (r.metadata != domain::AppImageMetadata{})
+      e["metadata"] = metadata_to_json(r.metadata);
     arr.push_back(e);
   }
   j["entries"] = arr;
-  std::ofstream f(path);
-  if (f)
-    f << j.dump(2);
+  store_file(writer_, registry_path(), j.dump(2));
+}
+
+void JsonRegistryRepository::refresh() const {
+  FileStamp stamp = stat_file(registry_path());
+  if (loaded_ && (dirty_ || stamp == stamp_ || (writer_ && writer_->has_pending(registry_path()))))
+    return;
+  records_ = load();
+  stamp_ = stamp;
+  loaded_ = true;
+  reindex();
+}
+
+void JsonRegistryRepository::reindex() const {
+  index_by_id_.clear();
+  index_by_path_.clear();
+  index_by_fingerprint_.clear();
+  index_by_directory_.clear();
+  index_by_id_.reserve(records_.size());
+  index_by_path_.reserve(records_.size());
+  for (std::size_t i = 0; i < records_.size(); ++i)
+    index_record(i);
+}
+
+void JsonRegistryRepository::index_record(std::size_t i) const {
+  const domain::AppImageRecord& record = records_[i];
+  index_by_id_.emplace(record.id, i);
+  index_by_path_.emplace(record.path, i);
+  if (record.fingerprint != 0)
+    index_by_fingerprint_.emplace(record.fingerprint, i);
+  std::string dir = directory_of(record.path);
+  if (!dir.empty())
+    index_by_directory_.emplace(std::move(dir), i);
+}
+
+void JsonRegistryRepository::unindex_record(std::size_t i) const {
+  const domain::AppImageRecord& record = records_[i];
+  erase_entry(index_by_id_, record.id, i);
+  erase_entry(index_by_path_, record.path, i);
+  if (record.fingerprint != 0)
+    erase_entry(index_by_fingerprint_, record.fingerprint, i);
+  std::string dir = directory_of(record.path);
+  if (!dir.empty())
+    erase_entry(index_by_directory_, dir, i);
+}
+
+void JsonRegistryRepository::erase_record(std::size_t i) {
+  for (std::size_t j = i; j < records_.size(); ++j)
+    unindex_record(j);
+  records_.erase(records_.begin() + static_cast<std::ptrdiff_t>(i));
+  for (std::size_t j = i; j < records_.size(); ++j)
+    index_record(j);
+}
+
+void JsonRegistryRepository::write_back() {
+  if (batch_depth_ > 0) {
+    dirty_ = true;
+    return;
+  }
+  persist(records_);
+  stamp_ = stat_file(registry_path());
+  dirty_ = false;
+}
+
+void JsonRegistryRepository::begin() {
+  ++batch_depth_;
+}
+
+void JsonRegistryRepository::commit() {
+  if (batch_depth_ == 0 || --batch_depth_ > 0)
+    return;
+  if (dirty_)
+    write_back();
 }
 
 std::vector<domain::AppImageRecord> JsonRegistryRepository::all() const {
-  return load();
+  refresh();
+  return records_;
+}
+
+std::vector<domain::AppImageRecord> JsonRegistryRepository::page(std::size_t offset, std::size_t limit) const {
+  refresh();
+  std::size_t begin = std::min(offset, records_.size());
+  std::size_t end = limit == 0 ? records_.size() : std::min(begin + limit, records_.size());
+  return std::vector<domain::AppImageRecord>(records_.begin() + static_cast<std::ptrdiff_t>(begin),
+                                             records_.begin() + static_cast<std::ptrdiff_t>(end));
 }
 
 std::optional<domain::AppImageRecord> JsonRegistryRepository::by_path(const std::string& path) const {
-  auto records = load();
-  auto it = std::find_if(records.begin(), records.end(),
-    [&path](const domain::AppImageRecord& r) { return r.path == path; });
-  if (it == records.end())
+  refresh();
+  auto it = index_by_path_.find(path);
+  if (it == index_by_path_.end())
     return std::nullopt;
-  return *it;
+  return records_[it->second];
 }
 
 std::optional<domain::AppImageRecord> JsonRegistryRepository::by_id(const std::string& id) const {
-  auto records = load();
-  auto it = std::find_if(records.begin(), records.end(),
-    [&id](const domain::AppImageRecord& r) { return r.id == id; });
-  if (it == records.end())
+  refresh();
+  auto it = index_by_id_.find(id);
+  if (it == index_by_id_.end())
     return std::nullopt;
-  return *it;
+  return records_[it->second];
+}
+
+std::vector<domain::AppImageRecord> JsonRegistryRepository::by_fingerprint(std::uint64_t fingerprint) const {
+  refresh();
+  std::vector<domain::AppImageRecord> result;
+  auto [first, last] = index_by_fingerprint_.equal_range(fingerprint);
+  for (auto it = first; it != last; ++it)
+    result.push_back(records_[it->second]);
+  return result;
+}
+
+std::vector<domain::AppImageRecord> JsonRegistryRepository::in_directory(const std::string& dir) const {
+  refresh();
+  std::vector<domain::AppImageRecord> result;
+  auto [first, last] = index_by_directory_.equal_range(domain::directory_prefix(dir));
+  for (auto it = first; it != last; ++it)
+    result.push_back(records_[it->second]);
+  return result;
 }
 
 void JsonRegistryRepository::save(const domain::AppImageRecord& record) {
-  auto records = load();
-  auto it = std::find_if(records.begin(), records.end(),
-    [&record](const domain::AppImageRecord& r) { return r.path == record.path; });
+  refresh();
   domain::AppImageRecord to_save = record;
-  if (it != records.end()) {
+  auto it = index_by_path_.find(record.path);
+  if (it != index_by_path_.end()) {
+    std::size_t i = it->second;
     if (to_save.added_at.empty())
-      to_save.added_at = it->added_at;
-    *it = to_save;
+      to_save.added_at = records_[i].added_at;
+    unindex_record(i);
+    records_[i] = std::move(to_save);
+    index_record(i);
   } else {
     if (to_save.added_at.empty())
       to_save.added_at = now_iso8601_utc();
-    records.push_back(to_save);
+    records_.push_back(std::move(to_save));
+    index_record(records_.size() - 1);
   }
-  persist(records);
+  write_back();
 }
 
 void JsonRegistryRepository::remove_by_path(const std::string& path) {
-  auto records = load();
-  records.erase(
-    std::remove_if(records.begin(), records.end(),
-      [&path](const domain::AppImageRecord& r) { return r.path == path; }),
-    records.end());
-  persist(records);
+  refresh();
+  auto it = index_by_path_.find(path);
+  if (it == index_by_path_.end())
+    return;
+  erase_record(it->second);
+  write_back();
 }
 
 void JsonRegistryRepository::remove(const std::string& id) {
-  auto records = load();
-  records.erase(
-    std::remove_if(records.begin(), records.end(),
-      [&id](const domain::AppImageRecord& r) { return r.id == id; }),
-    records.end());
-  persist(records);
+  refresh();
+  auto it = index_by_id_.find(id);
+  if (it == index_by_id_.end())
+    return;
+  erase_record(it->second);
+  write_back();
 }
 
 }
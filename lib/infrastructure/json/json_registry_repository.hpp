@@ -2,23 +2,51 @@
 
 #include "../../domain/repositories/registry_repository.hpp"
 #include "../../domain/entities/app_image_record.hpp"
+#include "../persistence/file_stamp.hpp"
+#include "../persistence/write_behind_queue.hpp"
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace appimage_manager::infrastructure {
 
 class JsonRegistryRepository : public domain::RegistryRepository {
 public:
-  explicit JsonRegistryRepository(const std::string& config_dir);
+  explicit JsonRegistryRepository(const std::string& config_dir,
+                                  WriteBehindQueue* writer = nullptr);
   std::vector<domain::AppImageRecord> all() const override;
   std::optional<domain::AppImageRecord> by_path(const std::string& path) const override;
   std::optional<domain::AppImageRecord> by_id(const std::string& id) const override;
   void save(const domain::AppImageRecord& record) override;
   void remove_by_path(const std::string& path) override;
   void remove(const std::string& id) override;
+  std::vector<domain::AppImageRecord> page(std::size_t offset, std::size_t limit) const override;
+  std::vector<domain::AppImageRecord> by_fingerprint(std::uint64_t fingerprint) const override;
+  std::vector<domain::AppImageRecord> in_directory(const std::string& dir) const override;
+  void begin() override;
+  void commit() override;
 
 private:
   std::string config_dir_;
+  WriteBehindQueue* writer_;
+  mutable bool loaded_{false};
+  mutable FileStamp stamp_;
+  mutable std::vector<domain::AppImageRecord> records_;
+  mutable std::unordered_map<std::string, std::size_t> index_by_id_;
+  mutable std::unordered_map<std::string, std::size_t> index_by_path_;
+  mutable std::unordered_multimap<std::uint64_t, std::size_t> index_by_fingerprint_;
+  mutable std::unordered_multimap<std::string, std::size_t> index_by_directory_;
+  int batch_depth_{0};
+  bool dirty_{false};
+
   std::string registry_path() const;
+  void refresh() const;
+  void reindex() const;
+  void index_record(std::size_t i) const;
+  void unindex_record(std::size_t i) const;
+  void erase_record(std::size_t i);
+  void write_back();
   void persist(const std::vector<domain::AppImageRecord>& records) const;
   std::vector<domain::AppImageRecord> load() const;
 };
@@ -0,0 +1,566 @@
+#include "mmap_registry_repository.hpp"
+#include "../json/json_registry_repository.hpp"
+#include "../persistence/atomic_file.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace appimage_manager::infrastructure {
+
+namespace {
+
+constexpr const char* registry_filename = "registry.bin";
+constexpr const char* json_registry_filename = "registry.json";
+constexpr char registry_magic[4] = {'A', 'I', 'M', 'R'};
+constexpr std::uint32_t registry_version = 3;
+constexpr std::uint32_t metadata_registry_version = 2;
+constexpr std::uint32_t legacy_registry_version = 1;
+
+struct StringRef {
+  std::uint32_t offset;
+  std::uint32_t length;
+};
+
+struct Header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t record_count;
+  std::uint32_t reserved;
+  std::uint64_t records_offset;
+  std::uint64_t id_index_offset;
+  std::uint64_t path_index_offset;
+  std::uint64_t strings_offset;
+  std::uint64_t strings_size;
+};
+
+struct RecordEntry {
+  StringRef id;
+  StringRef path;
+  StringRef name;
+  StringRef added_at;
+  std::uint32_t install_type;
+  std::uint32_t reserved;
+};
+
+struct MetadataEntry {
+  StringRef name;
+  StringRef summary;
+  StringRef version;
+  StringRef appstream_id;
+  StringRef startup_wm_class;
+  StringRef categories;
+  StringRef mime_types;
+  StringRef icon_path;
+  std::uint64_t content_hash;
+};
+
+struct IdentityEntry {
+  std::uint64_t fingerprint;
+  std::uint64_t inode;
+};
+
+static_assert(sizeof(Header) == 56);
+static_assert(sizeof(RecordEntry) == 40);
+static_assert(sizeof(MetadataEntry) == 72);
+static_assert(sizeof(IdentityEntry) == 16);
+
+std::size_t record_stride(std::uint32_t version) {
+  if (version == legacy_registry_version)
+    return sizeof(RecordEntry);
+  if (version == metadata_registry_version)
+    return sizeof(RecordEntry) + sizeof(MetadataEntry);
+  return sizeof(RecordEntry) + sizeof(MetadataEntry) + sizeof(IdentityEntry);
+}
+
+std::string join_list(const std::vector<std::string>& items) {
+  std::string out;
+  for (const auto& item : items)
+    out += item + ";";
+  return out;
+}
+
+std::vector<std::string> split_list(std::string_view s) {
+  std::vector<std::string> items;
+  std::size_t start = 0;
+  while (start < s.size()) {
+    std::size_t end = s.find(';', start);
+    if (end == std::string_view::npos)
+      end = s.size();
+    if (end > start)
+      items.emplace_back(s.substr(start, end - start));
+    start = end + 1;
+  }
+  return items;
+}
+
+std::string now_iso8601_utc() {
+  auto now = std::chrono::system_clock::now();
+  auto t = std::chrono::system_clock::to_time_t(now);
+  std::tm* tm = std::gmtime(&t);
+  if (!tm) return {};
+  char buf[32];
+  if (std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", tm) == 0)
+    return {};
+  return std::string(buf);
+}
+
+std::uint64_t align8(std::uint64_t n) {
+  return (n + 7u) & ~static_cast<std::uint64_t>(7u);
+}
+
+class RegistryView {
+public:
+  RegistryView(const char* data, std::size_t size) : data_(data), size_(size) {}
+
+  bool valid() const {
+    if (!data_ || size_ < sizeof(Header))
+      return false;
+    const Header& h = header();
+    if (std::memcmp(h.magic, registry_magic, sizeof(registry_magic)) != 0 ||
+        (h.version != registry_version && h.version != metadata_registry_version &&
+         h.version != legacy_registry_version))
+      return false;
+    std::uint64_t n = h.record_count;
+    if (!in_bounds(h.records_offset, n * record_stride(h.version)) ||
+        !in_bounds(h.id_index_offset, n * sizeof(std::uint32_t)) ||
+        !in_bounds(h.path_index_offset, n * sizeof(std::uint32_t)) ||
+        !in_bounds(h.strings_offset, h.strings_size))
+      return false;
+    if (h.records_offset % alignof(RecordEntry) != 0 ||
+        h.id_index_offset % alignof(std::uint32_t) != 0 ||
+        h.path_index_offset % alignof(std::uint32_t) != 0)
+      return false;
+    for (std::uint32_t i = 0; i < h.record_count; ++i) {
+      const RecordEntry& e = entry(i);
+      if (!string_in_bounds(e.id) || !string_in_bounds(e.path) ||
+          !string_in_bounds(e.name) || !string_in_bounds(e.added_at))
+        return false;
+      if (const MetadataEntry* m = metadata(i)) {
+        if (!string_in_bounds(m->name) || !string_in_bounds(m->summary) || !string_in_bounds(m->version) ||
+            !string_in_bounds(m->appstream_id) || !string_in_bounds(m->startup_wm_class) ||
+            !string_in_bounds(m->categories) || !string_in_bounds(m->mime_types) || !string_in_bounds(m->icon_path))
+          return false;
+      }
+      if (id_index()[i] >= h.record_count || path_index()[i] >= h.record_count)
+        return false;
+    }
+    return true;
+  }
+
+  std::uint32_t count() const { return header().record_count; }
+  const RecordEntry& entry(std::uint32_t i) const {
+    return *reinterpret_cast<const RecordEntry*>(data_ + header().records_offset + i * record_stride(header().version));
+  }
+  const MetadataEntry* metadata(std::uint32_t i) const {
+    if (header().version == legacy_registry_version)
+      return nullptr;
+    return reinterpret_cast<const MetadataEntry*>(&entry(i) + 1);
+  }
+  const IdentityEntry* identity(std::uint32_t i) const {
+    if (header().version != registry_version)
+      return nullptr;
+    return reinterpret_cast<const IdentityEntry*>(metadata(i) + 1);
+  }
+  const std::uint32_t* id_index() const {
+    return reinterpret_cast<const std::uint32_t*>(data_ + header().id_index_offset);
+  }
+  const std::uint32_t* path_index() const {
+    return reinterpret_cast<const std::uint32_t*>(data_ + header().path_index_offset);
+  }
+  std::string_view str(const StringRef& ref) const {
+    return std::string_view(data_ + header().strings_offset + ref.offset, ref.length);
+  }
+
+  domain::AppImageRecord record(std::uint32_t i) const {
+    const RecordEntry& e = entry(i);
+    domain::AppImageRecord r;
+    r.id = std::string(str(e.id));
+    r.path = std::string(str(e.path));
+    r.name = std::string(str(e.name));
+    r.added_at = std::string(str(e.added_at));
+    if (e.install_type <= static_cast<std::uint32_t>(domain::InstallType::Direct))
+      r.install_type = static_cast<domain::InstallType>(e.install_type);
+    if (const MetadataEntry* m = metadata(i)) {
+      r.metadata.name = std::string(str(m->name));
+      r.metadata.summary = std::string(str(m->summary));
+      r.metadata.version = std::string(str(m->version));
+      r.metadata.appstream_id = std::string(str(m->appstream_id));
+      r.metadata.startup_wm_class = std::string(str(m->startup_wm_class));
+      r.metadata.categories = split_list(str(m->categories));
+      r.metadata.mime_types = split_list(str(m->mime_types));
+      r.metadata.icon_path = std::string(str(m->icon_path));
+      r.metadata.content_hash = m->content_hash;
+    }
+    if (const IdentityEntry* identity_entry = identity(i)) {
+      r.fingerprint = identity_entry->fingerprint;
+      r.inode = identity_entry->inode;
+    }
+    return r;
+  }
+
+  std::optional<std::uint32_t> find(std::string_view key, bool by_id) const {
+    const std::uint32_t* index = by_id ? id_index() : path_index();
+    auto key_of = [&](std::uint32_t i) { return str(by_id ? entry(i).id : entry(i).path); };
+    const std::uint32_t* end = index + count();
+    const std::uint32_t* it = std::lower_bound(index, end, key,
+      [&](std::uint32_t i, std::string_view k) { return key_of(i) < k; });
+    if (it == end || key_of(*it) != key)
+      return std::nullopt;
+    return *it;
+  }
+
+  std::vector<std::uint32_t> in_directory(const std::string& prefix) const {
+    const std::uint32_t* end = path_index() + count();
+    const std::uint32_t* it = std::lower_bound(path_index(), end, std::string_view(prefix),
+      [&](std::uint32_t i, std::string_view k) { return str(entry(i).path) < k; });
+    std::vector<std::uint32_t> result;
+    for (; it != end; ++it) {
+      std::string_view path = str(entry(*it).path);
+      if (path.compare(0, prefix.size(), prefix) != 0)
+        break;
+      if (path.find('/', prefix.size()) == std::string_view::npos)
+        result.push_back(*it);
+    }
+    return result;
+  }
+
+private:
+  const Header& header() const { return *reinterpret_cast<const Header*>(data_); }
+  bool in_bounds(std::uint64_t offset, std::uint64_t length) const {
+    return offset <= size_ && length <= size_ - offset;
+  }
+  bool string_in_bounds(const StringRef& ref) const {
+    return static_cast<std::uint64_t>(ref.offset) + ref.length <= header().strings_size;
+  }
+
+  const char* data_;
+  std::size_t size_;
+};
+
+std::string serialize_registry(const std::vector<domain::AppImageRecord>& records) {
+  std::string strings;
+  std::string entries;
+  entries.reserve(records.size() * record_stride(registry_version));
+  auto add_string = [&strings](const std::string& s) {
+    StringRef ref{static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(s.size())};
+    strings += s;
+    return ref;
+  };
+  for (const auto& r : records) {
+    RecordEntry e{};
+    e.id = add_string(r.id);
+    e.path = add_string(r.path);
+    e.name = add_string(r.name);
+    e.added_at = add_string(r.added_at);
+    e.install_type = static_cast<std::uint32_t>(r.install_type);
+    MetadataEntry m{};
+    m.name = add_string(r.metadata.name);
+    m.summary = add_string(r.metadata.summary);
+    m.version = add_string(r.metadata.version);
+    m.appstream_id = add_string(r.metadata.appstream_id);
+    m.startup_wm_class = add_string(r.metadata.startup_wm_class);
+    m.categories = add_string(join_list(r.metadata.categories));
+    m.mime_types = add_string(join_list(r.metadata.mime_types));
+    m.icon_path = add_string(r.metadata.icon_path);
+    m.content_hash = r.metadata.content_hash;
+    IdentityEntry identity{r.fingerprint, r.inode};
+    entries.append(reinterpret_cast<const char*>(&e), sizeof(e));
+    entries.append(reinterpret_cast<const char*>(&m), sizeof(m));
+    entries.append(reinterpret_cast<const char*>(&identity), sizeof(identity));
+  }
+  std::vector<std::uint32_t> id_index(records.size());
+  std::vector<std::uint32_t> path_index(records.size());
+  for (std::uint32_t i = 0; i < records.size(); ++i)
+    id_index[i] = path_index[i] = i;
+  std::stable_sort(id_index.begin(), id_index.end(),
+    [&records](std::uint32_t a, std::uint32_t b) { return records[a].id < records[b].id; });
+  std::stable_sort(path_index.begin(), path_index.end(),
+    [&records](std::uint32_t a, std::uint32_t b) { return records[a].path < records[b].path; });
+
+  Header h{};
+  std::memcpy(h.magic, registry_magic, sizeof(registry_magic));
+  h.version = registry_version;
+  h.record_count = static_cast<std::uint32_t>(records.size());
+  h.records_offset = align8(sizeof(Header));
+  h.id_index_offset = align8(h.records_offset + entries.size());
+  h.path_index_offset = align8(h.id_index_offset + id_index.size() * sizeof(std::uint32_t));
+  h.strings_offset = align8(h.path_index_offset + path_index.size() * sizeof(std::uint32_t));
+  h.strings_size = strings.size();
+
+  std::string out(h.strings_offset + strings.size(), '\0');
+  std::memcpy(out.data(), &h, sizeof(h));
+  if (!entries.empty()) {
+    std::memcpy(out.data() + h.records_offset, entries.data(), entries.size());
+    std::memcpy(out.data() + h.id_index_offset, id_index.data(), id_index.size() * sizeof(std::uint32_t));
+    std::memcpy(out.data() + h.path_index_offset, path_index.data(), path_index.size() * sizeof(std::uint32_t));
+  }
+  std::memcpy(out.data() + h.strings_offset, strings.data(), strings.size());
+  return out;
+}
+
+}
+
+MmapRegistryRepository::MmapRegistryRepository(const std::string& config_dir)
+  : config_dir_(config_dir) {}
+
+MmapRegistryRepository::~MmapRegistryRepository() {
+  unmap();
+}
+
+std::string MmapRegistryRepository::registry_path() const {
+  return (fs::path(config_dir_) / registry_filename).string();
+}
+
+void MmapRegistryRepository::unmap() const {
+  if (data_)
+    ::munmap(const_cast<char*>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void MmapRegistryRepository::refresh() const {
+  FileStamp stamp = stat_file(registry_path());
+  if (mapped_ && stamp == stamp_)
+    return;
+  unmap();
+  stamp_ = stamp;
+  mapped_ = true;
+  if (!stamp.exists || stamp.size <= 0)
+    return;
+  int fd = ::open(registry_path().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+    void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      data_ = static_cast<const char*>(p);
+      size_ = static_cast<std::size_t>(st.st_size);
+    }
+  }
+  ::close(fd);
+  if (data_ && !RegistryView(data_, size_).valid())
+    unmap();
+}
+
+std::optional<domain::AppImageRecord> MmapRegistryRepository::find(std::string_view key, bool by_id) const {
+  if (staged_) {
+    const auto& index = by_id ? staged_by_id_ : staged_by_path_;
+    auto it = index.find(std::string(key));
+    if (it == index.end())
+      return std::nullopt;
+    return (*staged_)[it->second];
+  }
+  refresh();
+  if (!data_)
+    return std::nullopt;
+  RegistryView view(data_, size_);
+  auto i = view.find(key, by_id);
+  if (!i)
+    return std::nullopt;
+  return view.record(*i);
+}
+
+std::vector<domain::AppImageRecord> MmapRegistryRepository::all() const {
+  if (staged_)
+    return *staged_;
+  refresh();
+  std::vector<domain::AppImageRecord> result;
+  if (!data_)
+    return result;
+  RegistryView view(data_, size_);
+  result.reserve(view.count());
+  for (std::uint32_t i = 0; i < view.count(); ++i)
+    result.push_back(view.record(i));
+  return result;
+}
+
+std::vector<domain::AppImageRecord> MmapRegistryRepository::page(std::size_t offset, std::size_t limit) const {
+  std::vector<domain::AppImageRecord> result;
+  auto bounds = [offset, limit](std::size_t count) {
+    std::size_t begin = std::min(offset, count);
+    return std::make_pair(begin, limit == 0 ? count : std::min(begin + limit, count));
+  };
+  if (staged_) {
+    auto [begin, end] = bounds(staged_->size());
+    result.assign(staged_->begin() + static_cast<std::ptrdiff_t>(begin), staged_->begin() + static_cast<std::ptrdiff_t>(end));
+    return result;
+  }
+  refresh();
+  if (!data_)
+    return result;
+  RegistryView view(data_, size_);
+  auto [begin, end] = bounds(view.count());
+  result.reserve(end - begin);
+  for (std::size_t i = begin; i < end; ++i)
+    result.push_back(view.record(static_cast<std::uint32_t>(i)));
+  return result;
+}
+
+std::vector<domain::AppImageRecord> MmapRegistryRepository::by_fingerprint(std::uint64_t fingerprint) const {
+  std::vector<domain::AppImageRecord> result;
+  if (staged_) {
+    for (const auto& r : *staged_) {
+      if (r.fingerprint == fingerprint)
+        result.push_back(r);
+    }
+    return result;
+  }
+  refresh();
+  if (!data_)
+    return result;
+  RegistryView view(data_, size_);
+  for (std::uint32_t i = 0; i < view.count(); ++i) {
+    const IdentityEntry* identity = view.identity(i);
+    if (identity && identity->fingerprint == fingerprint)
+      result.push_back(view.record(i));
+  }
+  return result;
+}
+
+std::vector<domain::AppImageRecord> MmapRegistryRepository::in_directory(const std::string& dir) const {
+  std::string prefix = domain::directory_prefix(dir);
+  std::vector<domain::AppImageRecord> result;
+  if (staged_) {
+    for (const auto& r : *staged_) {
+      if (domain::directly_in(r.path, prefix))
+        result.push_back(r);
+    }
+    return result;
+  }
+  refresh();
+  if (!data_)
+    return result;
+  RegistryView view(data_, size_);
+  for (std::uint32_t i : view.in_directory(prefix))
+    result.push_back(view.record(i));
+  return result;
+}
+
+std::optional<domain::AppImageRecord> MmapRegistryRepository::by_path(const std::string& path) const {
+  return find(path, false);
+}
+
+std::optional<domain::AppImageRecord> MmapRegistryRepository::by_id(const std::string& id) const {
+  return find(id, true);
+}
+
+std::vector<domain::AppImageRecord>& MmapRegistryRepository::stage() {
+  if (!staged_) {
+    staged_ = all();
+    restage_indexes();
+  }
+  return *staged_;
+}
+
+void MmapRegistryRepository::restage_indexes() {
+  staged_by_id_.clear();
+  staged_by_path_.clear();
+  for (std::size_t i = 0; i < staged_->size(); ++i) {
+    staged_by_id_.emplace((*staged_)[i].id, i);
+    staged_by_path_.emplace((*staged_)[i].path, i);
+  }
+}
+
+void MmapRegistryRepository::unstage(std::size_t i) {
+  auto& records = *staged_;
+  staged_by_id_.erase(records[i].id);
+  staged_by_path_.erase(records[i].path);
+  records.erase(records.begin() + static_cast<std::ptrdiff_t>(i));
+  for (std::size_t j = i; j < records.size(); ++j) {
+    staged_by_id_[records[j].id] = j;
+    staged_by_path_[records[j].path] = j;
+  }
+}
+
+void MmapRegistryRepository::write_back() {
+  if (batch_depth_ > 0 || !staged_)
+    return;
+  if (!write_registry_file(registry_path(), *staged_)) {
+    std::cerr << "appimage-manager: failed to write " << registry_path() << ", keeping changes staged\n";
+    return;
+  }
+  staged_.reset();
+  staged_by_id_.clear();
+  staged_by_path_.clear();
+  refresh();
+}
+
+void MmapRegistryRepository::save(const domain::AppImageRecord& record) {
+  auto& records = stage();
+  domain::AppImageRecord to_save = record;
+  auto it = staged_by_path_.find(record.path);
+  if (it != staged_by_path_.end()) {
+    std::size_t i = it->second;
+    if (to_save.added_at.empty())
+      to_save.added_at = records[i].added_at;
+    if (records[i].id != to_save.id) {
+      staged_by_id_.erase(records[i].id);
+      staged_by_id_[to_save.id] = i;
+    }
+    records[i] = std::move(to_save);
+  } else {
+    if (to_save.added_at.empty())
+      to_save.added_at = now_iso8601_utc();
+    staged_by_id_[to_save.id] = records.size();
+    staged_by_path_[to_save.path] = records.size();
+    records.push_back(std::move(to_save));
+  }
+  write_back();
+}
+
+void MmapRegistryRepository::remove_by_path(const std::string& path) {
+  if (!staged_ && !find(path, false))
+    return;
+  stage();
+  auto it = staged_by_path_.find(path);
+  if (it != staged_by_path_.end())
+    unstage(it->second);
+  write_back();
+}
+
+void MmapRegistryRepository::remove(const std::string& id) {
+  if (!staged_ && !find(id, true))
+    return;
+  stage();
+  auto it = staged_by_id_.find(id);
+  if (it != staged_by_id_.end())
+    unstage(it->second);
+  write_back();
+}
+
+void MmapRegistryRepository::begin() {
+  ++batch_depth_;
+}
+
+void MmapRegistryRepository::commit() {
+  if (batch_depth_ == 0 || --batch_depth_ > 0)
+    return;
+  write_back();
+}
+
+bool write_registry_file(const std::string& path, const std::vector<domain::AppImageRecord>& records) {
+  return write_file_atomically(path, serialize_registry(records));
+}
+
+bool migrate_json_registry(const std::string& config_dir) {
+  fs::path bin_path = fs::path(config_dir) / registry_filename;
+  fs::path json_path = fs::path(config_dir) / json_registry_filename;
+  if (fs::exists(bin_path) || !fs::is_regular_file(json_path))
+    return false;
+  JsonRegistryRepository json_registry(config_dir);
+  return write_registry_file(bin_path.string(), json_registry.all());
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../../domain/repositories/registry_repository.hpp"
+#include "../../domain/entities/app_image_record.hpp"
+#include "../persistence/file_stamp.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace appimage_manager::infrastructure {
+
+class MmapRegistryRepository : public domain::RegistryRepository {
+public:
+  explicit MmapRegistryRepository(const std::string& config_dir);
+  ~MmapRegistryRepository() override;
+  MmapRegistryRepository(const MmapRegistryRepository&) = delete;
+  MmapRegistryRepository& operator=(const MmapRegistryRepository&) = delete;
+
+  std::vector<domain::AppImageRecord> all() const override;
+  std::optional<domain::AppImageRecord> by_path(const std::string& path) const override;
+  std::optional<domain::AppImageRecord> by_id(const std::string& id) const override;
+  std::vector<domain::AppImageRecord> page(std::size_t offset, std::size_t limit) const override;
+  std::vector<domain::AppImageRecord> by_fingerprint(std::uint64_t fingerprint) const override;
+  std::vector<domain::AppImageRecord> in_directory(const std::string& dir) const override;
+  void save(const domain::AppImageRecord& record) override;
+  void remove_by_path(const std::string& path) override;
+  void remove(const std::string& id) override;
+  void begin() override;
+  void commit() override;
+
+private:
+  std::string config_dir_;
+  mutable FileStamp stamp_;
+  mutable bool mapped_{false};
+  mutable const char* data_{nullptr};
+  mutable std::size_t size_{0};
+  int batch_depth_{0};
+  std::optional<std::vector<domain::AppImageRecord>> staged_;
+  std::unordered_map<std::string, std::size_t> staged_by_id_;
+  std::unordered_map<std::string, std::size_t> staged_by_path_;
+
+  std::string registry_path() const;
+  void refresh() const;
+  void unmap() const;
+  std::optional<domain::AppImageRecord> find(std::string_view key, bool by_id) const;
+  std::vector<domain::AppImageRecord>& stage();
+  void restage_indexes();
+  void unstage(std::size_t i);
+  void write_back();
+};
+
+bool write_registry_file(const std::string& path, const std::vector<domain::AppImageRecord>& records);
+
+bool migrate_json_registry(const std::string& config_dir);
+
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+namespace appimage_manager::infrastructure {
+
+bool write_file_atomically(const std::string& path, const std::string& content);
+
+std::optional<std::string> read_file(const std::string& path);
+
+}
@@ -0,0 +1,19 @@
+#include "file_stamp.hpp"
+#include <sys/stat.h>
+
+namespace appimage_manager::infrastructure {
+
+FileStamp stat_file(const std::string& path) {
+  FileStamp stamp;
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0)
+    return stamp;
+  stamp.exists = true;
+  stamp.device = st.st_dev;
+  stamp.inode = st.st_ino;
+  stamp.size = st.st_size;
+  stamp.mtime_ns = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+  return stamp;
+}
+
+}
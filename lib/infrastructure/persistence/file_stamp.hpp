@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+
+namespace appimage_manager::infrastructure {
+
+struct FileStamp {
+  bool exists{false};
+  dev_t device{0};
+  ino_t inode{0};
+  off_t size{0};
+  long long mtime_ns{0};
+  bool operator==(const FileStamp&) const = default;
+};
+
+FileStamp stat_file(const std::string& path);
+
+}
@@ -0,0 +1,125 @@
+#include "write_behind_queue.hpp"
+#include "atomic_file.hpp"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace appimage_manager::infrastructure {
+
+namespace {
+
+constexpr std::chrono::milliseconds min_retry_backoff{250};
+constexpr std::chrono::milliseconds max_retry_backoff{60000};
+
+}
+
+WriteBehindQueue::WriteBehindQueue(std::chrono::milliseconds window)
+  : window_(window)
+  , thread_([this] { run(); }) {}
+
+WriteBehindQueue::~WriteBehindQueue() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+  flush();
+}
+
+void WriteBehindQueue::schedule(const std::string& path, std::string content) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.empty())
+      deadline_ = std::chrono::steady_clock::now() + window_;
+    pending_[path] = std::move(content);
+  }
+  cv_.notify_all();
+}
+
+std::optional<std::string> WriteBehindQueue::pending(const std::string& path) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = pending_.find(path);
+  if (it != pending_.end())
+    return it->second;
+  it = in_flight_.find(path);
+  if (it != in_flight_.end())
+    return it->second;
+  return std::nullopt;
+}
+
+bool WriteBehindQueue::has_pending(const std::string& path) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_.count(path) > 0 || in_flight_.count(path) > 0;
+}
+
+void WriteBehindQueue::flush() {
+  std::unique_lock<std::mutex> write_lock(write_mutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  write_batch(lock);
+}
+
+void WriteBehindQueue::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (pending_.empty()) {
+      cv_.wait(lock);
+      continue;
+    }
+    if (cv_.wait_until(lock, deadline_, [this] { return stopping_; }))
+      break;
+    lock.unlock();
+    {
+      std::unique_lock<std::mutex> write_lock(write_mutex_);
+      std::unique_lock<std::mutex> batch_lock(mutex_);
+      write_batch(batch_lock);
+    }
+    lock.lock();
+  }
+}
+
+void WriteBehindQueue::write_batch(std::unique_lock<std::mutex>& lock) {
+  if (pending_.empty())
+    return;
+  in_flight_.swap(pending_);
+  lock.unlock();
+  std::vector<std::string> failed;
+  for (const auto& [path, content] : in_flight_) {
+    if (!write_file_atomically(path, content))
+      failed.push_back(path);
+  }
+  lock.lock();
+  if (failed.empty()) {
+    if (retry_backoff_.count() > 0)
+      std::cerr << "appimage-manager: pending writes succeeded again\n";
+    retry_backoff_ = std::chrono::milliseconds(0);
+  } else {
+    if (retry_backoff_.count() == 0)
+      std::cerr << "appimage-manager: failed to write " << failed.front() << ", retrying in the background\n";
+    retry_backoff_ = retry_backoff_.count() == 0 ? std::max(window_, min_retry_backoff)
+                                                : std::min(retry_backoff_ * 2, max_retry_backoff);
+    deadline_ = std::chrono::steady_clock::now() + retry_backoff_;
+    for (const auto& path : failed)
+      pending_.try_emplace(path, std::move(in_flight_[path]));
+  }
+  in_flight_.clear();
+}
+
+void store_file(WriteBehindQueue* queue, const std::string& path, std::string content) {
+  if (queue) {
+    queue->schedule(path, std::move(content));
+    return;
+  }
+  if (!write_file_atomically(path, content))
+    std::cerr << "appimage-manager: failed to write " << path << "\n";
+}
+
+std::optional<std::string> load_file(const WriteBehindQueue* queue, const std::string& path) {
+  if (queue) {
+    if (auto content = queue->pending(path))
+      return content;
+  }
+  return read_file(path);
+}
+
+}
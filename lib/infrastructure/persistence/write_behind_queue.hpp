@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace appimage_manager::infrastructure {
+
+class WriteBehindQueue {
+public:
+  explicit WriteBehindQueue(std::chrono::milliseconds window = std::chrono::milliseconds(250));
+  ~WriteBehindQueue();
+  WriteBehindQueue(const WriteBehindQueue&) = delete;
+  WriteBehindQueue& operator=(const WriteBehindQueue&) = delete;
+
+  void schedule(const std::string& path, std::string content);
+  std::optional<std::string> pending(const std::string& path) const;
+  bool has_pending(const std::string& path) const;
+  void flush();
+
+private:
+  void run();
+  void write_batch(std::unique_lock<std::mutex>& lock);
+
+  std::chrono::milliseconds window_;
+  mutable std::mutex mutex_;
+  std::mutex write_mutex_;
+  std::condition_variable cv_;
+  std::unordered_map<std::string, std::string> pending_;
+  std::unordered_map<std::string, std::string> in_flight_;
+  std::chrono::steady_clock::time_point deadline_;
+  std::chrono::milliseconds retry_backoff_{0};
+  bool stopping_{false};
+  std::thread thread_;
+};
+
+void store_file(WriteBehindQueue* queue, const std::string& path, std::string content);
+
+std::optional<std::string> load_file(const WriteBehindQueue* queue, const std::string& path);
+
+}
@@ -0,0 +1,112 @@
+#include "sqlite_config_repository.hpp"
+#include "sqlite_launch_settings_repository.hpp"
+#include "sqlite_registry_repository.hpp"
+#include "../json/json_config_repository.hpp"
+#include "../json/json_launch_settings_repository.hpp"
+#include "../json/json_registry_repository.hpp"
+#include <nlohmann/json.hpp>
+#include <string>
+
+namespace appimage_manager::infrastructure {
+
+namespace {
+
+constexpr int migrated_user_version = 1;
+
+void put_value(const SqliteDatabase& db, const std::string& key, const std::string& value) {
+  SqliteStatement stmt(db,
+    "INSERT INTO config (key, value) VALUES (?1, ?2) "
+    "ON CONFLICT(key) DO UPDATE SET value = excluded.value;");
+  stmt.bind(1, key);
+  stmt.bind(2, value);
+  stmt.run();
+}
+
+}
+
+SqliteConfigRepository::SqliteConfigRepository(SqliteDatabase& db)
+  : db_(&db) {}
+
+domain::Config SqliteConfigRepository::load() const {
+  domain::Config result;
+  SqliteStatement stmt(*db_, "SELECT key, value FROM config;");
+  while (stmt.step()) {
+    std::string key = stmt.text(0);
+    std::string value = stmt.text(1);
+    if (key == "watch_directories") {
+      try {
+        nlohmann::json j = nlohmann::json::parse(value);
+        if (j.is_array()) {
+          for (const auto& item : j)
+            if (item.is_string())
+              result.watch_directories.push_back(item.get<std::string>());
+        }
+      } catch (...) {
+      }
+    } else if (key == "registry_backend") {
+      result.registry_backend = value;
+    } else if (key == "icon_workers") {
+      try {
+        result.icon_workers = std::stoi(value);
+      } catch (...) {
+      }
+    } else if (key == "quiet_period_ms") {
+      try {
+        result.quiet_period_ms = std::stoi(value);
+      } catch (...) {
+      }
+    } else if (key == "recursive") {
+      result.recursive = value == "1";
+    } else if (key == "max_depth") {
+      try {
+        result.max_depth = std::stoi(value);
+      } catch (...) {
+      }
+    } else if (key == "exclude") {
+      try {
+        nlohmann::json j = nlohmann::json::parse(value);
+        if (j.is_array()) {
+          for (const auto& item : j)
+            if (item.is_string())
+              result.exclude.push_back(item.get<std::string>());
+        }
+      } catch (...) {
+      }
+    }
+  }
+  return result;
+}
+
+void SqliteConfigRepository::save(const domain::Config& config) {
+  db_->begin();
+  put_value(*db_, "watch_directories", nlohmann::json(config.watch_directories).dump());
+  put_value(*db_, "registry_backend", config.registry_backend);
+  put_value(*db_, "icon_workers", std::to_string(config.icon_workers));
+  put_value(*db_, "quiet_period_ms", std::to_string(config.quiet_period_ms));
+  put_value(*db_, "recursive", config.recursive ? "1" : "0");
+  put_value(*db_, "max_depth", std::to_string(config.max_depth));
+  put_value(*db_, "exclude", nlohmann::json(config.exclude).dump());
+  db_->commit();
+}
+
+bool migrate_json_storage(SqliteDatabase& db, const std::string& config_dir) {
+  if (!db.is_open() || db.user_version() >= migrated_user_version)
+    return false;
+  JsonConfigRepository json_config(config_dir);
+  JsonRegistryRepository json_registry(config_dir);
+  JsonLaunchSettingsRepository json_launch_settings(config_dir);
+  SqliteConfigRepository config(db);
+  SqliteRegistryRepository registry(db);
+  SqliteLaunchSettingsRepository launch_settings(db);
+  db.begin();
+  config.save(json_config.load());
+  for (const auto& record : json_registry.all())
+    registry.save(record);
+  for (const auto& [app_id, settings] : json_launch_settings.load_all())
+    launch_settings.save(app_id, settings);
+  db.set_user_version(migrated_user_version);
+  db.commit();
+  return true;
+}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "../../domain/repositories/config_repository.hpp"
+#include "../../domain/entities/config.hpp"
+#include "sqlite_database.hpp"
+#include <string>
+
+namespace appimage_manager::infrastructure {
+
+class SqliteConfigRepository : public domain::ConfigRepository {
+public:
+  explicit SqliteConfigRepository(SqliteDatabase& db);
+  domain::Config load() const override;
+  void save(const domain::Config& config) override;
+
+private:
+  SqliteDatabase* db_;
+};
+
+bool migrate_json_storage(SqliteDatabase& db, const std::string& config_dir);
+
+}
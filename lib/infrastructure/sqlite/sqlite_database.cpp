@@ -0,0 +1,157 @@
+#include "sqlite_database.hpp"
+#include <sqlite3.h>
+#include <filesystem>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace appimage_manager::infrastructure {
+
+namespace {
+
+constexpr const char* schema_sql =
+  "CREATE TABLE IF NOT EXISTS records ("
+  "  seq INTEGER PRIMARY KEY AUTOINCREMENT,"
+  "  id TEXT NOT NULL,"
+  "  path TEXT NOT NULL UNIQUE,"
+  "  name TEXT NOT NULL,"
+  "  install_type TEXT NOT NULL,"
+  "  added_at TEXT NOT NULL,"
+  "  metadata TEXT NOT NULL DEFAULT '',"
+  "  fingerprint INTEGER NOT NULL DEFAULT 0,"
+  "  inode INTEGER NOT NULL DEFAULT 0);"
+  "CREATE INDEX IF NOT EXISTS records_id ON records(id);"
+  "CREATE TABLE IF NOT EXISTS launch_settings ("
+  "  app_id TEXT PRIMARY KEY,"
+  "  args TEXT NOT NULL,"
+  "  env TEXT NOT NULL,"
+  "  sandbox TEXT NOT NULL);"
+  "CREATE TABLE IF NOT EXISTS config ("
+  "  key TEXT PRIMARY KEY,"
+  "  value TEXT NOT NULL);";
+
+constexpr std::pair<const char*, const char*> added_record_columns[] = {
+  {"metadata", "ALTER TABLE records ADD COLUMN metadata TEXT NOT NULL DEFAULT '';"},
+  {"fingerprint", "ALTER TABLE records ADD COLUMN fingerprint INTEGER NOT NULL DEFAULT 0;"},
+  {"inode", "ALTER TABLE records ADD COLUMN inode INTEGER NOT NULL DEFAULT 0;"},
+};
+
+}
+
+SqliteDatabase::SqliteDatabase(const std::string& path) {
+  fs::path dir = fs::path(path).parent_path();
+  std::error_code ec;
+  if (!dir.empty())
+    fs::create_directories(dir, ec);
+  if (sqlite3_open_v2(path.c_str(), &db_,
+                      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX,
+                      nullptr) != SQLITE_OK) {
+    sqlite3_close(db_);
+    db_ = nullptr;
+    return;
+  }
+  sqlite3_busy_timeout(db_, 5000);
+  exec("PRAGMA journal_mode=WAL;");
+  exec("PRAGMA synchronous=NORMAL;");
+  if (!exec(schema_sql)) {
+    sqlite3_close(db_);
+    db_ = nullptr;
+    return;
+  }
+  for (const auto& [column, alter_sql] : added_record_columns) {
+    SqliteStatement existing(*this, "SELECT 1 FROM pragma_table_info('records') WHERE name = ?1;");
+    existing.bind(1, column);
+    if (existing.ok() && !existing.step())
+      exec(alter_sql);
+  }
+  exec("CREATE INDEX IF NOT EXISTS records_fingerprint ON records(fingerprint);");
+}
+
+SqliteDatabase::~SqliteDatabase() {
+  if (db_)
+    sqlite3_close(db_);
+}
+
+bool SqliteDatabase::is_open() const {
+  return db_ != nullptr;
+}
+
+sqlite3* SqliteDatabase::handle() const {
+  return db_;
+}
+
+bool SqliteDatabase::exec(const char* sql) const {
+  if (!db_)
+    return false;
+  return sqlite3_exec(db_, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+void SqliteDatabase::begin() {
+  if (batch_depth_++ == 0)
+    exec("BEGIN IMMEDIATE;");
+}
+
+void SqliteDatabase::commit() {
+  if (batch_depth_ == 0 || --batch_depth_ > 0)
+    return;
+  if (!exec("COMMIT;"))
+    exec("ROLLBACK;");
+}
+
+int SqliteDatabase::user_version() const {
+  SqliteStatement stmt(*this, "PRAGMA user_version;");
+  if (!stmt.step())
+    return 0;
+  return static_cast<int>(stmt.integer(0));
+}
+
+void SqliteDatabase::set_user_version(int version) const {
+  exec(("PRAGMA user_version=" + std::to_string(version) + ";").c_str());
+}
+
+SqliteStatement::SqliteStatement(const SqliteDatabase& db, const char* sql) {
+  if (db.handle())
+    sqlite3_prepare_v2(db.handle(), sql, -1, &stmt_, nullptr);
+}
+
+SqliteStatement::~SqliteStatement() {
+  sqlite3_finalize(stmt_);
+}
+
+bool SqliteStatement::ok() const {
+  return stmt_ != nullptr;
+}
+
+void SqliteStatement::bind(int index, const std::string& value) {
+  if (stmt_)
+    sqlite3_bind_text(stmt_, index, value.data(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
+}
+
+void SqliteStatement::bind(int index, long long value) {
+  if (stmt_)
+    sqlite3_bind_int64(stmt_, index, value);
+}
+
+bool SqliteStatement::step() {
+  return stmt_ && sqlite3_step(stmt_) == SQLITE_ROW;
+}
+
+bool SqliteStatement::run() {
+  if (!stmt_)
+    return false;
+  int rc = sqlite3_step(stmt_);
+  return rc == SQLITE_DONE || rc == SQLITE_ROW;
+}
+
+std::string SqliteStatement::text(int column) const {
+  const unsigned char* p = sqlite3_column_text(stmt_, column);
+  if (!p)
+    return {};
+  return std::string(reinterpret_cast<const char*>(p), static_cast<std::size_t>(sqlite3_column_bytes(stmt_, column)));
+}
+
+long long SqliteStatement::integer(int column) const {
+  return sqlite3_column_int64(stmt_, column);
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace appimage_manager::infrastructure {
+
+class SqliteDatabase {
+public:
+  explicit SqliteDatabase(const std::string& path);
+  ~SqliteDatabase();
+  SqliteDatabase(const SqliteDatabase&) = delete;
+  SqliteDatabase& operator=(const SqliteDatabase&) = delete;
+
+  bool is_open() const;
+  sqlite3* handle() const;
+  bool exec(const char* sql) const;
+  void begin();
+  void commit();
+  int user_version() const;
+  void set_user_version(int version) const;
+
+private:
+  sqlite3* db_{nullptr};
+  int batch_depth_{0};
+};
+
+class SqliteStatement {
+public:
+  SqliteStatement(const SqliteDatabase& db, const char* sql);
+  ~SqliteStatement();
+  SqliteStatement(const SqliteStatement&) = delete;
+  SqliteStatement& operator=(const SqliteStatement&) = delete;
+
+  bool ok() const;
+  void bind(int index, const std::string& value);
+  void bind(int index, long long value);
+  bool step();
+  bool run();
+  std::string text(int column) const;
+  long long integer(int column) const;
+
+private:
+  sqlite3_stmt* stmt_{nullptr};
+};
+
+}
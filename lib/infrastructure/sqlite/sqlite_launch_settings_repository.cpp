@@ -0,0 +1,84 @@
+#include "sqlite_launch_settings_repository.hpp"
+#include <nlohmann/json.hpp>
+
+namespace appimage_manager::infrastructure {
+
+namespace {
+
+std::string sandbox_to_string(domain::SandboxMechanism s) {
+  switch (s) {
+    case domain::SandboxMechanism::Bwrap: return "bwrap";
+    case domain::SandboxMechanism::Firejail: return "firejail";
+    default: return "none";
+  }
+}
+
+domain::SandboxMechanism string_to_sandbox(const std::string& s) {
+  if (s == "bwrap") return domain::SandboxMechanism::Bwrap;
+  if (s == "firejail") return domain::SandboxMechanism::Firejail;
+  return domain::SandboxMechanism::None;
+}
+
+domain::LaunchSettings settings_from_row(const SqliteStatement& stmt, int first_column) {
+  domain::LaunchSettings ls;
+  ls.args = stmt.text(first_column);
+  try {
+    nlohmann::json env = nlohmann::json::parse(stmt.text(first_column + 1));
+    if (env.is_array()) {
+      for (const auto& e : env)
+        if (e.is_string())
+          ls.env.push_back(e.get<std::string>());
+    }
+  } catch (...) {
+  }
+  ls.sandbox = string_to_sandbox(stmt.text(first_column + 2));
+  return ls;
+}
+
+}
+
+SqliteLaunchSettingsRepository::SqliteLaunchSettingsRepository(SqliteDatabase& db)
+  : db_(&db) {}
+
+std::optional<domain::LaunchSettings> SqliteLaunchSettingsRepository::load(const std::string& app_id) const {
+  SqliteStatement stmt(*db_, "SELECT args, env, sandbox FROM launch_settings WHERE app_id = ?1;");
+  stmt.bind(1, app_id);
+  if (!stmt.step())
+    return std::nullopt;
+  return settings_from_row(stmt, 0);
+}
+
+void SqliteLaunchSettingsRepository::save(const std::string& app_id, const domain::LaunchSettings& settings) {
+  SqliteStatement stmt(*db_,
+    "INSERT INTO launch_settings (app_id, args, env, sandbox) VALUES (?1, ?2, ?3, ?4) "
+    "ON CONFLICT(app_id) DO UPDATE SET args = excluded.args, env = excluded.env, sandbox = excluded.sandbox;");
+  stmt.bind(1, app_id);
+  stmt.bind(2, settings.args);
+  stmt.bind(3, nlohmann::json(settings.env).dump());
+  stmt.bind(4, sandbox_to_string(settings.sandbox));
+  stmt.run();
+}
+
+std::unordered_map<std::string, domain::LaunchSettings> SqliteLaunchSettingsRepository::load_all() const {
+  std::unordered_map<std::string, domain::LaunchSettings> result;
+  SqliteStatement stmt(*db_, "SELECT app_id, args, env, sandbox FROM launch_settings;");
+  while (stmt.step())
+    result[stmt.text(0)] = settings_from_row(stmt, 1);
+  return result;
+}
+
+void SqliteLaunchSettingsRepository::remove(const std::string& app_id) {
+  SqliteStatement stmt(*db_, "DELETE FROM launch_settings WHERE app_id = ?1;");
+  stmt.bind(1, app_id);
+  stmt.run();
+}
+
+void SqliteLaunchSettingsRepository::begin() {
+  db_->begin();
+}
+
+void SqliteLaunchSettingsRepository::commit() {
+  db_->commit();
+}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../../domain/repositories/launch_settings_repository.hpp"
+#include "../../domain/entities/launch_settings.hpp"
+#include "sqlite_database.hpp"
+#include <string>
+
+namespace appimage_manager::infrastructure {
+
+class SqliteLaunchSettingsRepository : public domain::LaunchSettingsRepository {
+public:
+  explicit SqliteLaunchSettingsRepository(SqliteDatabase& db);
+  std::optional<domain::LaunchSettings> load(const std::string& app_id) const override;
+  void save(const std::string& app_id, const domain::LaunchSettings& settings) override;
+  std::unordered_map<std::string, domain::LaunchSettings> load_all() const override;
+  void remove(const std::string& app_id) override;
+  void begin() override;
+  void commit() override;
+
+private:
+  SqliteDatabase* db_;
+};
+
+}
@@ -0,0 +1,201 @@
+#include "sqlite_registry_repository.hpp"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+namespace appimage_manager::infrastructure {
+
+namespace {
+
+constexpr const char* select_columns = "SELECT id, path, name, install_type, added_at, metadata, fingerprint, inode FROM records ";
+
+std::string now_iso8601_utc() {
+  auto now = std::chrono::system_clock::now();
+  auto t = std::chrono::system_clock::to_time_t(now);
+  std::tm* tm = std::gmtime(&t);
+  if (!tm) return {};
+  char buf[32];
+  if (std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", tm) == 0)
+    return {};
+  return std::string(buf);
+}
+
+std::string install_type_to_string(domain::InstallType t) {
+  switch (t) {
+    case domain::InstallType::Downloaded: return "Downloaded";
+    case domain::InstallType::GitHub: return "GitHub";
+    case domain::InstallType::Direct: return "Direct";
+  }
+  return "Downloaded";
+}
+
+domain::InstallType string_to_install_type(const std::string& s) {
+  if (s == "GitHub") return domain::InstallType::GitHub;
+  if (s == "Direct") return domain::InstallType::Direct;
+  return domain::InstallType::Downloaded;
+}
+
+std::string metadata_to_string(const domain::AppImageMetadata& m) {
+  if (m == domain::AppImageMetadata{})
+    return {};
+  nlohmann::json j;
+  j["name"] = m.name;
+  j["summary"] = m.summary;
+  j["version"] = m.version;
+  j["appstream_id"] = m.appstream_id;
+  j["startup_wm_class"] = m.startup_wm_class;
+  j["categories"] = m.categories;
+  j["mime_types"] = m.mime_types;
+  j["icon_path"] = m.icon_path;
+  j["content_hash"] = m.content_hash;
+  return j.dump();
+}
+
+domain::AppImageMetadata metadata_from_string(const std::string& s) {
+  domain::AppImageMetadata m;
+  if (s.empty())
+    return m;
+  try {
+    nlohmann::json j = nlohmann::json::parse(s);
+    auto read_list = [&j](const char* key, std::vector<std::string>& out) {
+      if (!j.contains(key) || !j[key].is_array())
+        return;
+      for (const auto& item : j[key])
+        if (item.is_string())
+          out.push_back(item.get<std::string>());
+    };
+    if (j.contains("name") && j["name"].is_string()) m.name = j["name"].get<std::string>();
+    if (j.contains("summary") && j["summary"].is_string()) m.summary = j["summary"].get<std::string>();
+    if (j.contains("version") && j["version"].is_string()) m.version = j["version"].get<std::string>();
+    if (j.contains("appstream_id") && j["appstream_id"].is_string())
+      m.appstream_id = j["appstream_id"].get<std::string>();
+    if (j.contains("startup_wm_class") && j["startup_wm_class"].is_string())
+      m.startup_wm_class = j["startup_wm_class"].get<std::string>();
+    read_list("categories", m.categories);
+    read_list("mime_types", m.mime_types);
+    if (j.contains("icon_path") && j["icon_path"].is_string()) m.icon_path = j["icon_path"].get<std::string>();
+    if (j.contains("content_hash") && j["content_hash"].is_number_unsigned())
+      m.content_hash = j["content_hash"].get<std::uint64_t>();
+  } catch (...) {
+  }
+  return m;
+}
+
+domain::AppImageRecord record_from_row(const SqliteStatement& stmt) {
+  domain::AppImageRecord record;
+  record.id = stmt.text(0);
+  record.path = stmt.text(1);
+  record.name = stmt.text(2);
+  record.install_type = string_to_install_type(stmt.text(3));
+  record.added_at = stmt.text(4);
+  record.metadata = metadata_from_string(stmt.text(5));
+  record.fingerprint = static_cast<std::uint64_t>(stmt.integer(6));
+  record.inode = static_cast<std::uint64_t>(stmt.integer(7));
+  return record;
+}
+
+std::optional<domain::AppImageRecord> select_one(const SqliteDatabase& db, const std::string& where,
+                                                 const std::string& value) {
+  SqliteStatement stmt(db, (select_columns + where + " ORDER BY seq LIMIT 1;").c_str());
+  stmt.bind(1, value);
+  if (!stmt.step())
+    return std::nullopt;
+  return record_from_row(stmt);
+}
+
+}
+
+SqliteRegistryRepository::SqliteRegistryRepository(SqliteDatabase& db)
+  : db_(&db) {}
+
+std::vector<domain::AppImageRecord> SqliteRegistryRepository::all() const {
+  std::vector<domain::AppImageRecord> result;
+  SqliteStatement stmt(*db_, (std::string(select_columns) + "ORDER BY seq;").c_str());
+  while (stmt.step())
+    result.push_back(record_from_row(stmt));
+  return result;
+}
+
+std::vector<domain::AppImageRecord> SqliteRegistryRepository::page(std::size_t offset, std::size_t limit) const {
+  std::vector<domain::AppImageRecord> result;
+  SqliteStatement stmt(*db_, (std::string(select_columns) + "ORDER BY seq LIMIT ?1 OFFSET ?2;").c_str());
+  stmt.bind(1, limit == 0 ? -1LL : static_cast<long long>(limit));
+  stmt.bind(2, static_cast<long long>(offset));
+  while (stmt.step())
+    result.push_back(record_from_row(stmt));
+  return result;
+}
+
+std::optional<domain::AppImageRecord> SqliteRegistryRepository::by_path(const std::string& path) const {
+  return select_one(*db_, "WHERE path = ?1", path);
+}
+
+std::optional<domain::AppImageRecord> SqliteRegistryRepository::by_id(const std::string& id) const {
+  return select_one(*db_, "WHERE id = ?1", id);
+}
+
+std::vector<domain::AppImageRecord> SqliteRegistryRepository::by_fingerprint(std::uint64_t fingerprint) const {
+  std::vector<domain::AppImageRecord> result;
+  SqliteStatement stmt(*db_, (std::string(select_columns) + "WHERE fingerprint = ?1 ORDER BY seq;").c_str());
+  stmt.bind(1, static_cast<long long>(fingerprint));
+  while (stmt.step())
+    result.push_back(record_from_row(stmt));
+  return result;
+}
+
+std::vector<domain::AppImageRecord> SqliteRegistryRepository::in_directory(const std::string& dir) const {
+  std::string prefix = domain::directory_prefix(dir);
+  std::string upper = prefix.substr(0, prefix.size() - 1) + static_cast<char>('/' + 1);
+  std::vector<domain::AppImageRecord> result;
+  SqliteStatement stmt(*db_, (std::string(select_columns) +
+    "WHERE path > ?1 AND path < ?2 AND instr(substr(path, ?3), '/') = 0 ORDER BY path;").c_str());
+  stmt.bind(1, prefix);
+  stmt.bind(2, upper);
+  stmt.bind(3, static_cast<long long>(prefix.size() + 1));
+  while (stmt.step())
+    result.push_back(record_from_row(stmt));
+  return result;
+}
+
+void SqliteRegistryRepository::save(const domain::AppImageRecord& record) {
+  SqliteStatement stmt(*db_,
+    "INSERT INTO records (id, path, name, install_type, added_at, metadata, fingerprint, inode) "
+    "VALUES (?1, ?2, ?3, ?4, ?5, ?7, ?8, ?9) "
+    "ON CONFLICT(path) DO UPDATE SET id = excluded.id, name = excluded.name, "
+    "install_type = excluded.install_type, metadata = excluded.metadata, "
+    "fingerprint = excluded.fingerprint, inode = excluded.inode, "
+    "added_at = CASE WHEN ?6 = '' THEN records.added_at ELSE excluded.added_at END;");
+  stmt.bind(1, record.id);
+  stmt.bind(2, record.path);
+  stmt.bind(3, record.name);
+  stmt.bind(4, install_type_to_string(record.install_type));
+  stmt.bind(5, record.added_at.empty() ? now_iso8601_utc() : record.added_at);
+  stmt.bind(6, record.added_at);
+  stmt.bind(7, metadata_to_string(record.metadata));
+  stmt.bind(8, static_cast<long long>(record.fingerprint));
+  stmt.bind(9, static_cast<long long>(record.inode));
+  stmt.run();
+}
+
+void SqliteRegistryRepository::remove_by_path(const std::string& path) {
+  SqliteStatement stmt(*db_, "DELETE FROM records WHERE path = ?1;");
+  stmt.bind(1, path);
+  stmt.run();
+}
+
+void SqliteRegistryRepository::remove(const std::string& id) {
+  SqliteStatement stmt(*db_, "DELETE FROM records WHERE id = ?1;");
+  stmt.bind(1, id);
+  stmt.run();
+}
+
+void SqliteRegistryRepository::begin() {
+  db_->begin();
+}
+
+void SqliteRegistryRepository::commit() {
+  db_->commit();
+}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../../domain/repositories/registry_repository.hpp"
+#include "../../domain/entities/app_image_record.hpp"
+#include "sqlite_database.hpp"
+#include <cstdint>
+#include <string>
+
+namespace appimage_manager::infrastructure {
+
+class SqliteRegistryRepository : public domain::RegistryRepository {
+public:
+  explicit SqliteRegistryRepository(SqliteDatabase& db);
+  std::vector<domain::AppImageRecord> all() const override;
+  std::optional<domain::AppImageRecord> by_path(const std::string& path) const override;
+  std::optional<domain::AppImageRecord> by_id(const std::string& id) const override;
+  std::vector<domain::AppImageRecord> page(std::size_t offset, std::size_t limit) const override;
+  std::vector<domain::AppImageRecord> by_fingerprint(std::uint64_t fingerprint) const override;
+  std::vector<domain::AppImageRecord> in_directory(const std::string& dir) const override;
+  void save(const domain::AppImageRecord& record) override;
+  void remove_by_path(const std::string& path) override;
+  void remove(const std::string& id) override;
+  void begin() override;
+  void commit() override;
+
+private:
+  SqliteDatabase* db_;
+};
+
+}
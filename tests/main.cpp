@@ -13,6 +13,13 @@ static int run_one_test(const char* group, std::size_t index) {
   if (strcmp(group, "scan_directories") == 0) return run_scan_directories_test(index);
   if (strcmp(group, "generate_desktop") == 0) return run_generate_desktop_test(index);
   if (strcmp(group, "dbus_getallrecords") == 0) return run_dbus_getallrecords_test(index);
+  if (strcmp(group, "persistence") == 0) return run_persistence_test(index);
+  if (strcmp(group, "mmap_registry_repository") == 0) return run_mmap_registry_repository_test(index);
+#ifdef APPIMAGE_MANAGER_WITH_SQLITE
+  if (strcmp(group, "sqlite_repositories") == 0) return run_sqlite_repositories_test(index);
+#endif
+  if (strcmp(group, "squashfs_image") == 0) return run_squashfs_image_test(index);
+  if (strcmp(group, "extract_icon") == 0) return run_extract_icon_test(index);
   return EXIT_FAILURE;
 }
 
@@ -28,6 +35,13 @@ int main(int argc, char* argv[]) {
     if (strcmp(argv[1], "launch_settings_repository") == 0) return run_launch_settings_repository_tests() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     if (strcmp(argv[1], "scan_directories") == 0) return run_scan_directories_tests() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     if (strcmp(argv[1], "generate_desktop") == 0) return run_generate_desktop_tests() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (strcmp(argv[1], "persistence") == 0) return run_persistence_tests() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (strcmp(argv[1], "mmap_registry_repository") == 0) return run_mmap_registry_repository_tests() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+#ifdef APPIMAGE_MANAGER_WITH_SQLITE
+    if (strcmp(argv[1], "sqlite_repositories") == 0) return run_sqlite_repositories_tests() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
+    if (strcmp(argv[1], "squashfs_image") == 0) return run_squashfs_image_tests() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (strcmp(argv[1], "extract_icon") == 0) return run_extract_icon_tests() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
     if (strcmp(argv[1], "dbus_getallrecords") == 0) {
       QCoreApplication app(argc, argv);
       return run_dbus_getallrecords_tests() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -40,6 +54,13 @@ int main(int argc, char* argv[]) {
   if (run_launch_settings_repository_tests() != 0) return EXIT_FAILURE;
   if (run_scan_directories_tests() != 0) return EXIT_FAILURE;
   if (run_generate_desktop_tests() != 0) return EXIT_FAILURE;
+  if (run_persistence_tests() != 0) return EXIT_FAILURE;
+  if (run_mmap_registry_repository_tests() != 0) return EXIT_FAILURE;
+#ifdef APPIMAGE_MANAGER_WITH_SQLITE
+  if (run_sqlite_repositories_tests() != 0) return EXIT_FAILURE;
+#endif
+  if (run_squashfs_image_tests() != 0) return EXIT_FAILURE;
+  if (run_extract_icon_tests() != 0) return EXIT_FAILURE;
   {
     int argc = 1;
     char* argv0 = argv[0];
@@ -19,11 +19,23 @@ int test_config_round_trip() {
   appimage_manager::domain::Config config;
   config.watch_directories.push_back("/tmp");
   config.watch_directories.push_back("/home/user/Apps");
+  config.registry_backend = "mmap";
+  config.icon_workers = 3;
+  config.quiet_period_ms = 1500;
+  config.recursive = true;
+  config.max_depth = 3;
+  config.exclude = {"node_modules", "*/old/*"};
   repo.save(config);
   auto loaded = repo.load();
   assert(loaded.watch_directories.size() == config.watch_directories.size());
   assert(loaded.watch_directories[0] == "/tmp");
   assert(loaded.watch_directories[1] == "/home/user/Apps");
+  assert(loaded.registry_backend == "mmap");
+  assert(loaded.icon_workers == 3);
+  assert(loaded.quiet_period_ms == 1500);
+  assert(loaded.recursive);
+  assert(loaded.max_depth == 3);
+  assert(loaded.exclude == config.exclude);
   fs::remove_all(tmp);
   return 0;
 }
@@ -0,0 +1,292 @@
+#include "tests.hpp"
+#include <application/extract_icon.hpp>
+#include <infrastructure/json/json_appimage_probe_cache.hpp>
+#include <cassert>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void put(std::string& out, std::size_t pos, std::uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i)
+    out[pos + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+void put_be(std::string& out, std::size_t pos, std::uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i)
+    out[pos + size - 1 - i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+std::string elf64_with_load_end(std::uint64_t load_end) {
+  std::string elf(load_end, '\0');
+  elf[0] = 0x7f;
+  elf[1] = 'E';
+  elf[2] = 'L';
+  elf[3] = 'F';
+  elf[4] = 2;
+  elf[5] = 1;
+  put(elf, 0x20, 64, 8);
+  put(elf, 0x36, 56, 2);
+  put(elf, 0x38, 1, 2);
+  put(elf, 64, 1, 4);
+  put(elf, 64 + 8, 0, 8);
+  put(elf, 64 + 32, load_end, 8);
+  return elf;
+}
+
+std::string elf32_big_endian_with_load_end(std::uint64_t load_end) {
+  std::string elf(load_end, '\0');
+  elf[0] = 0x7f;
+  elf[1] = 'E';
+  elf[2] = 'L';
+  elf[3] = 'F';
+  elf[4] = 1;
+  elf[5] = 2;
+  put_be(elf, 0x1c, 52, 4);
+  put_be(elf, 0x2a, 32, 2);
+  put_be(elf, 0x2c, 2, 2);
+  put_be(elf, 52, 6, 4);
+  put_be(elf, 52 + 4, 0, 4);
+  put_be(elf, 52 + 16, load_end + 4096, 4);
+  put_be(elf, 84, 1, 4);
+  put_be(elf, 84 + 4, 0, 4);
+  put_be(elf, 84 + 16, load_end, 4);
+  return elf;
+}
+
+std::string superblock(std::uint64_t bytes_used) {
+  std::string sb(96, '\0');
+  sb.replace(0, 4, "hsqs");
+  put(sb, 12, 131072, 4);
+  put(sb, 20, 1, 2);
+  put(sb, 22, 17, 2);
+  put(sb, 28, 4, 2);
+  put(sb, 30, 0, 2);
+  put(sb, 40, bytes_used, 8);
+  return sb;
+}
+
+fs::path write_file(const std::string& name, const std::string& content) {
+  fs::path path = fs::temp_directory_path() / name;
+  std::ofstream(path, std::ios::binary) << content;
+  return path;
+}
+
+int test_offset_skips_false_magic_and_crosses_chunks() {
+  std::string content = elf64_with_load_end(4096);
+  content += "runtime hsqs string";
+  content += superblock(1ull << 40);
+  content.resize(4096 + 65536 - 2, 'x');
+  std::uint64_t expected = content.size();
+  content += superblock(4096);
+  content.resize(expected + 4096, '\0');
+  fs::path path = write_file("appimage-manager-test-offset", content);
+  auto offset = appimage_manager::application::get_appimage_squashfs_offset(path.string());
+  assert(offset && *offset == expected);
+  fs::remove(path);
+  return 0;
+}
+
+int test_offset_rejects_invalid_files() {
+  fs::path not_elf = write_file("appimage-manager-test-offset-not-elf", "hsqs" + std::string(200, '\0'));
+  assert(!appimage_manager::application::get_appimage_squashfs_offset(not_elf.string()));
+  std::string content = elf64_with_load_end(4096);
+  std::string bad = superblock(96);
+  put(bad, 28, 3, 2);
+  content += bad;
+  content += superblock(1ull << 32);
+  fs::path no_image = write_file("appimage-manager-test-offset-no-image", content);
+  assert(!appimage_manager::application::get_appimage_squashfs_offset(no_image.string()));
+  assert(!appimage_manager::application::get_appimage_squashfs_offset("/nonexistent/file.AppImage"));
+  std::string oversized = elf64_with_load_end(4096) + superblock(4096);
+  oversized.resize(4096 + 4096, '\0');
+  put(oversized, 0x36, 0xffff, 2);
+  put(oversized, 0x38, 0xffff, 2);
+  fs::path huge_table = write_file("appimage-manager-test-offset-huge-table", oversized);
+  assert(!appimage_manager::application::get_appimage_squashfs_offset(huge_table.string()));
+  std::string past_end = elf64_with_load_end(4096) + superblock(4096);
+  past_end.resize(4096 + 4096, '\0');
+  put(past_end, 0x20, 1ull << 40, 8);
+  fs::path table_past_end = write_file("appimage-manager-test-offset-table-past-end", past_end);
+  assert(!appimage_manager::application::get_appimage_squashfs_offset(table_past_end.string()));
+  fs::remove(not_elf);
+  fs::remove(no_image);
+  fs::remove(huge_table);
+  fs::remove(table_past_end);
+  return 0;
+}
+
+int test_offset_reads_big_endian_elf32() {
+  std::string content = elf32_big_endian_with_load_end(2048);
+  content += superblock(4096);
+  content.resize(2048 + 4096, '\0');
+  fs::path path = write_file("appimage-manager-test-offset-elf32-be", content);
+  auto offset = appimage_manager::application::get_appimage_squashfs_offset(path.string());
+  assert(offset && *offset == 2048u);
+  fs::remove(path);
+  return 0;
+}
+
+int test_probe_cache_skips_unchanged_files() {
+  fs::path cache_dir = fs::temp_directory_path() / "appimage-manager-test-probe-cache";
+  fs::remove_all(cache_dir);
+  std::string content = elf64_with_load_end(4096);
+  content += superblock(4096);
+  content.resize(4096 + 4096, '\0');
+  fs::path path = write_file("appimage-manager-test-probe.AppImage", content);
+  auto direct = appimage_manager::application::probe_appimage(path.string());
+  assert(direct && direct->squashfs_offset == 4096u && direct->compression == 1u);
+  {
+    appimage_manager::infrastructure::JsonAppImageProbeCache cache(cache_dir.string(), appimage_manager::application::probe_appimage);
+    auto probe = cache.probe(path.string());
+    assert(probe && probe->squashfs_offset == 4096u && probe->content_hash == direct->content_hash);
+  }
+  assert(fs::is_regular_file(cache_dir / "probe-cache.json"));
+  auto mtime = fs::last_write_time(path);
+  {
+    std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(4096);
+    f.write("xxxx", 4);
+  }
+  fs::last_write_time(path, mtime);
+  assert(!appimage_manager::application::probe_appimage(path.string()));
+  appimage_manager::infrastructure::JsonAppImageProbeCache reloaded(cache_dir.string(), appimage_manager::application::probe_appimage);
+  auto cached = reloaded.probe(path.string());
+  assert(cached && cached->squashfs_offset == 4096u && cached->content_hash == direct->content_hash);
+  fs::remove(path);
+  fs::remove_all(cache_dir);
+  return 0;
+}
+
+int test_probe_cache_reprobes_changed_files() {
+  fs::path cache_dir = fs::temp_directory_path() / "appimage-manager-test-probe-cache-changed";
+  fs::remove_all(cache_dir);
+  std::string content = elf64_with_load_end(4096);
+  content += superblock(4096);
+  content.resize(4096 + 4096, '\0');
+  fs::path path = write_file("appimage-manager-test-probe-changed.AppImage", content);
+  appimage_manager::infrastructure::JsonAppImageProbeCache cache(cache_dir.string(), appimage_manager::application::probe_appimage);
+  auto first = cache.probe(path.string());
+  assert(first && first->squashfs_offset == 4096u);
+  std::string moved = elf64_with_load_end(8192);
+  moved += superblock(4096);
+  moved.resize(8192 + 4096, '\0');
+  write_file("appimage-manager-test-probe-changed.AppImage", moved);
+  auto second = cache.probe(path.string());
+  assert(second && second->squashfs_offset == 8192u);
+  assert(second->content_hash != first->content_hash);
+  fs::remove(path);
+  auto removed = cache.probe(path.string());
+  assert(!removed);
+  fs::remove_all(cache_dir);
+  return 0;
+}
+
+int test_probe_cache_batches_writes() {
+  fs::path cache_dir = fs::temp_directory_path() / "appimage-manager-test-probe-cache-batch";
+  fs::remove_all(cache_dir);
+  std::string content = elf64_with_load_end(4096);
+  content += superblock(4096);
+  content.resize(4096 + 4096, '\0');
+  fs::path first = write_file("appimage-manager-test-probe-batch-1.AppImage", content);
+  fs::path second = write_file("appimage-manager-test-probe-batch-2.AppImage", content);
+  fs::path cache_file = cache_dir / "probe-cache.json";
+  {
+    appimage_manager::infrastructure::JsonAppImageProbeCache cache(cache_dir.string(), appimage_manager::application::probe_appimage);
+    cache.begin();
+    auto a = cache.probe(first.string());
+    auto b = cache.probe(second.string());
+    assert(a && b && a->squashfs_offset == 4096u);
+    assert(!fs::exists(cache_file));
+    cache.commit();
+    assert(fs::is_regular_file(cache_file));
+    fs::remove(cache_file);
+    cache.begin();
+    fs::path third = write_file("appimage-manager-test-probe-batch-3.AppImage", content);
+    auto c = cache.probe(third.string());
+    assert(c && !fs::exists(cache_file));
+    fs::remove(third);
+  }
+  assert(fs::is_regular_file(cache_file));
+  fs::remove(first);
+  fs::remove(second);
+  fs::remove_all(cache_dir);
+  return 0;
+}
+
+int test_probe_cache_forgets_and_prunes_entries() {
+  fs::path cache_dir = fs::temp_directory_path() / "appimage-manager-test-probe-cache-evict";
+  fs::remove_all(cache_dir);
+  std::string content = elf64_with_load_end(4096);
+  content += superblock(4096);
+  content.resize(4096 + 4096, '\0');
+  fs::path first = write_file("appimage-manager-test-probe-evict-1.AppImage", content);
+  fs::path second = write_file("appimage-manager-test-probe-evict-2.AppImage", content);
+  fs::path moved = fs::temp_directory_path() / "appimage-manager-test-probe-evict-moved.AppImage";
+  int probes = 0;
+  auto counting = [&probes](const std::string& path) {
+    ++probes;
+    return appimage_manager::application::probe_appimage(path);
+  };
+  {
+    appimage_manager::infrastructure::JsonAppImageProbeCache cache(cache_dir.string(), counting);
+    [[maybe_unused]] auto a = cache.probe(first.string());
+    [[maybe_unused]] auto b = cache.probe(second.string());
+    [[maybe_unused]] auto again = cache.probe(first.string());
+    assert(a && b && again && probes == 2);
+    cache.forget(first.string());
+    [[maybe_unused]] auto reprobed = cache.probe(first.string());
+    assert(reprobed && probes == 3);
+    fs::rename(second, moved);
+    [[maybe_unused]] auto renamed = cache.probe(moved.string());
+    assert(renamed && probes == 3);
+  }
+  fs::remove(first);
+  {
+    appimage_manager::infrastructure::JsonAppImageProbeCache reloaded(cache_dir.string(), counting);
+    [[maybe_unused]] auto cached = reloaded.probe(moved.string());
+    assert(cached && probes == 3);
+  }
+  std::ifstream in(cache_dir / "probe-cache.json");
+  std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  assert(json.find(moved.filename().string()) != std::string::npos);
+  assert(json.find(first.filename().string()) == std::string::npos);
+  assert(json.find(second.filename().string()) == std::string::npos);
+  fs::remove(moved);
+  fs::remove_all(cache_dir);
+  return 0;
+}
+
+using test_fn = int (*)();
+static const test_fn tests[] = {
+  test_offset_skips_false_magic_and_crosses_chunks,
+  test_offset_rejects_invalid_files,
+  test_offset_reads_big_endian_elf32,
+  test_probe_cache_skips_unchanged_files,
+  test_probe_cache_reprobes_changed_files,
+  test_probe_cache_batches_writes,
+  test_probe_cache_forgets_and_prunes_entries,
+};
+static constexpr std::size_t num_tests = sizeof(tests) / sizeof(tests[0]);
+
+}
+
+std::size_t extract_icon_test_count() { return num_tests; }
+
+int run_extract_icon_test(std::size_t i) {
+  if (i >= num_tests) return EXIT_FAILURE;
+  return tests[i]();
+}
+
+int run_extract_icon_tests() {
+  for (std::size_t i = 0; i < num_tests; ++i)
+    if (run_extract_icon_test(i) != 0) return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -8,6 +8,7 @@
 #include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <sys/stat.h>
 
 namespace fs = std::filesystem;
 
@@ -109,6 +110,68 @@ int test_remove_desktop_deletes_file() {
   return 0;
 }
 
+int test_generate_desktop_writes_only_when_changed() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-desktop-unchanged";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  appimage_manager::domain::AppImageRecord record;
+  record.id = "same-id";
+  record.path = "/opt/Same.AppImage";
+  record.name = "Same";
+  appimage_manager::domain::LaunchSettings settings;
+  assert(appimage_manager::application::generate_desktop(record, settings, tmp.string()));
+  std::string path = appimage_manager::application::desktop_file_path(record.id, record.name, tmp.string());
+  auto inode_of = [](const std::string& p) {
+    struct stat st;
+    return ::stat(p.c_str(), &st) == 0 ? st.st_ino : 0;
+  };
+  auto inode = inode_of(path);
+  assert(!appimage_manager::application::generate_desktop(record, settings, tmp.string()));
+  assert(inode_of(path) == inode);
+  settings.args = "--changed";
+  assert(appimage_manager::application::generate_desktop(record, settings, tmp.string()));
+  assert(inode_of(path) != inode);
+  std::ifstream in(path);
+  std::stringstream buf;
+  buf << in.rdbuf();
+  assert(buf.str() == appimage_manager::application::render_desktop(record, settings));
+  assert(!fs::exists(path + ".tmp"));
+  [[maybe_unused]] bool removed = appimage_manager::application::remove_desktop(record.id, record.name, tmp.string());
+  [[maybe_unused]] bool removed_again = appimage_manager::application::remove_desktop(record.id, record.name, tmp.string());
+  assert(removed && !removed_again);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_render_desktop_uses_extracted_metadata() {
+  appimage_manager::domain::AppImageRecord record;
+  record.id = "meta-id";
+  record.path = "/opt/Viewer.AppImage";
+  record.name = "Viewer";
+  record.metadata.name = "Image Viewer";
+  record.metadata.summary = "Views images";
+  record.metadata.version = "1.4.2";
+  record.metadata.categories = {"Graphics", "Viewer"};
+  record.metadata.mime_types = {"image/png"};
+  record.metadata.startup_wm_class = "viewer";
+  record.metadata.icon_path = "/icons/meta-id.svg";
+  appimage_manager::domain::LaunchSettings settings;
+  std::string content = appimage_manager::application::render_desktop(record, settings);
+  assert(content.find("Name=Image Viewer\n") != std::string::npos);
+  assert(content.find("Comment=Views images\n") != std::string::npos);
+  assert(content.find("Exec=/opt/Viewer.AppImage %U\n") != std::string::npos);
+  assert(content.find("Icon=/icons/meta-id.svg\n") != std::string::npos);
+  assert(content.find("Categories=Graphics;Viewer;\n") != std::string::npos);
+  assert(content.find("MimeType=image/png;\n") != std::string::npos);
+  assert(content.find("StartupWMClass=viewer\n") != std::string::npos);
+  assert(content.find("X-AppImage-Version=1.4.2\n") != std::string::npos);
+  record.name = "My Viewer";
+  content = appimage_manager::application::render_desktop(record, settings, "/icons/override.png");
+  assert(content.find("Name=My Viewer\n") != std::string::npos);
+  assert(content.find("Icon=/icons/override.png\n") != std::string::npos);
+  return 0;
+}
+
 using test_fn = int (*)();
 static const test_fn tests[] = {
   test_desktop_file_path_format,
@@ -116,6 +179,8 @@ static const test_fn tests[] = {
   test_generate_desktop_bwrap_wraps_exec,
   test_generate_desktop_writes_icon_when_provided,
   test_remove_desktop_deletes_file,
+  test_generate_desktop_writes_only_when_changed,
+  test_render_desktop_uses_extracted_metadata,
 };
 static constexpr std::size_t num_tests = sizeof(tests) / sizeof(tests[0]);
 
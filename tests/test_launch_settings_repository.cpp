@@ -6,6 +6,7 @@
 #include <cstddef>
 #include <filesystem>
 #include <fstream>
+#include <string>
 
 namespace fs = std::filesystem;
 
@@ -72,12 +73,60 @@ int test_launch_settings_remove() {
   return 0;
 }
 
+int test_launch_settings_reloads_after_external_change() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-launch-external";
+  fs::create_directories(tmp);
+  appimage_manager::infrastructure::JsonLaunchSettingsRepository repo(tmp.string());
+  appimage_manager::domain::LaunchSettings ls;
+  ls.args = "--one";
+  repo.save("app-a", ls);
+  assert(repo.load("app-a"));
+  {
+    appimage_manager::infrastructure::JsonLaunchSettingsRepository other(tmp.string());
+    ls.args = "--two";
+    other.save("app-b", ls);
+  }
+  auto loaded = repo.load("app-b");
+  assert(loaded && loaded->args == "--two");
+  assert(repo.load_all().size() == 2u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_launch_settings_batch_writes_once_on_commit() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-launch-batch";
+  fs::create_directories(tmp);
+  appimage_manager::infrastructure::JsonLaunchSettingsRepository repo(tmp.string());
+  {
+    appimage_manager::domain::LaunchSettingsBatch batch(repo);
+    for (int i = 0; i < 3; ++i) {
+      appimage_manager::domain::LaunchSettings ls;
+      ls.args = "--n=" + std::to_string(i);
+      repo.save("app-" + std::to_string(i), ls);
+    }
+    repo.remove("app-1");
+    assert(!fs::exists(tmp / "launch_settings.json"));
+    assert(repo.load_all().size() == 2u);
+    assert(repo.load("app-2"));
+  }
+  assert(fs::is_regular_file(tmp / "launch_settings.json"));
+  appimage_manager::infrastructure::JsonLaunchSettingsRepository reread(tmp.string());
+  auto all = reread.load_all();
+  assert(all.size() == 2u);
+  assert(all.at("app-0").args == "--n=0");
+  assert(!all.count("app-1"));
+  fs::remove_all(tmp);
+  return 0;
+}
+
 using test_fn = int (*)();
 static const test_fn tests[] = {
   test_launch_settings_round_trip,
   test_launch_settings_missing_returns_nullopt,
   test_launch_settings_invalid_json_returns_empty,
   test_launch_settings_remove,
+  test_launch_settings_reloads_after_external_change,
+  test_launch_settings_batch_writes_once_on_commit,
 };
 static constexpr std::size_t num_tests = sizeof(tests) / sizeof(tests[0]);
 
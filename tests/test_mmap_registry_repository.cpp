@@ -0,0 +1,252 @@
+#include "tests.hpp"
+#include <domain/entities/app_image_record.hpp>
+#include <infrastructure/json/json_registry_repository.hpp>
+#include <infrastructure/mmap/mmap_registry_repository.hpp>
+#include <cassert>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+appimage_manager::domain::AppImageRecord make_record(const std::string& id, const std::string& path) {
+  appimage_manager::domain::AppImageRecord r;
+  r.id = id;
+  r.path = path;
+  r.name = fs::path(path).stem().string();
+  r.install_type = appimage_manager::domain::InstallType::GitHub;
+  return r;
+}
+
+int test_mmap_registry_round_trip() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-mmap";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  {
+    appimage_manager::infrastructure::MmapRegistryRepository repo(tmp.string());
+    repo.save(make_record("b-id", "/opt/B.AppImage"));
+    repo.save(make_record("a-id", "/opt/A.AppImage"));
+    repo.save(make_record("c-id", "/opt/C.AppImage"));
+  }
+  appimage_manager::infrastructure::MmapRegistryRepository repo(tmp.string());
+  auto all = repo.all();
+  assert(all.size() == 3u);
+  assert(all[0].id == "b-id" && all[1].id == "a-id" && all[2].id == "c-id");
+  assert(!all[0].added_at.empty());
+  auto by_i = repo.by_id("a-id");
+  assert(by_i && by_i->path == "/opt/A.AppImage" && by_i->name == "A");
+  assert(by_i->install_type == appimage_manager::domain::InstallType::GitHub);
+  auto by_p = repo.by_path("/opt/C.AppImage");
+  assert(by_p && by_p->id == "c-id");
+  assert(!repo.by_id("missing"));
+  assert(!repo.by_path("/opt/Missing.AppImage"));
+  assert(repo.in_directory("/opt").size() == 3u && repo.in_directory("/opt/").size() == 3u);
+  assert(repo.in_directory("/op").empty() && repo.in_directory("/").empty());
+  auto page = repo.page(1, 1);
+  assert(page.size() == 1u && page[0].id == "a-id");
+  assert(repo.page(1, 0).size() == 2u && repo.page(5, 2).empty());
+  {
+    appimage_manager::domain::RegistryBatch batch(repo);
+    repo.save(make_record("d-id", "/opt/sub/D.AppImage"));
+    assert(repo.in_directory("/opt").size() == 3u);
+  }
+  auto in_sub = repo.in_directory("/opt/sub");
+  assert(in_sub.size() == 1u && in_sub[0].id == "d-id");
+  assert(repo.in_directory("/opt").size() == 3u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_mmap_registry_update_and_remove() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-mmap-update";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  appimage_manager::infrastructure::MmapRegistryRepository repo(tmp.string());
+  auto r = make_record("id1", "/opt/App.AppImage");
+  r.added_at = "2020-01-01T12:00:00Z";
+  repo.save(r);
+  r.name = "Renamed";
+  r.added_at.clear();
+  repo.save(r);
+  repo.save(make_record("id2", "/opt/Other.AppImage"));
+  auto all = repo.all();
+  assert(all.size() == 2u);
+  assert(all[0].name == "Renamed" && all[0].added_at == "2020-01-01T12:00:00Z");
+  {
+    appimage_manager::domain::RegistryBatch batch(repo);
+    repo.save(make_record("id3", "/opt/Third.AppImage"));
+    repo.remove("id1");
+    assert(repo.by_id("id3")->path == "/opt/Third.AppImage");
+  }
+  auto remaining = repo.all();
+  assert(remaining.size() == 2u && remaining[0].id == "id2" && remaining[1].id == "id3");
+  repo.remove("id3");
+  assert(!repo.by_id("id1"));
+  repo.remove_by_path("/opt/Other.AppImage");
+  assert(repo.all().empty());
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_mmap_registry_batch_and_migration() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-mmap-migrate";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  {
+    appimage_manager::infrastructure::JsonRegistryRepository json_repo(tmp.string());
+    json_repo.save(make_record("json-id", "/opt/Json.AppImage"));
+  }
+  [[maybe_unused]] bool migrated = appimage_manager::infrastructure::migrate_json_registry(tmp.string());
+  [[maybe_unused]] bool migrated_again = appimage_manager::infrastructure::migrate_json_registry(tmp.string());
+  assert(migrated && !migrated_again);
+  appimage_manager::infrastructure::MmapRegistryRepository repo(tmp.string());
+  assert(repo.by_id("json-id"));
+  {
+    appimage_manager::domain::RegistryBatch batch(repo);
+    repo.save(make_record("x", "/opt/X.AppImage"));
+    repo.save(make_record("y", "/opt/Y.AppImage"));
+    assert(repo.by_path("/opt/Y.AppImage"));
+    appimage_manager::infrastructure::MmapRegistryRepository other(tmp.string());
+    assert(other.all().size() == 1u);
+  }
+  appimage_manager::infrastructure::MmapRegistryRepository other(tmp.string());
+  assert(other.all().size() == 3u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_mmap_registry_invalid_file_returns_empty() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-mmap-invalid";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  std::ofstream((tmp / "registry.bin").string()) << "AIMR but not really a registry";
+  appimage_manager::infrastructure::MmapRegistryRepository repo(tmp.string());
+  assert(repo.all().empty());
+  assert(!repo.by_id("any"));
+  fs::remove_all(tmp);
+  return 0;
+}
+
+void put(std::string& out, std::uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i)
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+int test_mmap_registry_metadata_and_version_1_file() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-mmap-metadata";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  std::string strings = "v1-id/opt/Old.AppImageOld2020-01-01T12:00:00Z";
+  std::string file;
+  file += "AIMR";
+  put(file, 1, 4);
+  put(file, 1, 4);
+  put(file, 0, 4);
+  put(file, 56, 8);
+  put(file, 96, 8);
+  put(file, 104, 8);
+  put(file, 112, 8);
+  put(file, strings.size(), 8);
+  for (auto [offset, length] : {std::pair{0, 5}, std::pair{5, 17}, std::pair{22, 3}, std::pair{25, 20}}) {
+    put(file, offset, 4);
+    put(file, length, 4);
+  }
+  put(file, 2, 4);
+  put(file, 0, 4);
+  put(file, 0, 8);
+  put(file, 0, 8);
+  file += strings;
+  std::ofstream((tmp / "registry.bin").string(), std::ios::binary) << file;
+
+  appimage_manager::infrastructure::MmapRegistryRepository repo(tmp.string());
+  auto old = repo.by_id("v1-id");
+  assert(old && old->path == "/opt/Old.AppImage" && old->name == "Old");
+  assert(old->added_at == "2020-01-01T12:00:00Z");
+  assert(old->install_type == appimage_manager::domain::InstallType::Direct);
+  assert(old->metadata == appimage_manager::domain::AppImageMetadata{});
+  assert(old->fingerprint == 0u && old->inode == 0u);
+
+  old->metadata.name = "Old App";
+  old->metadata.summary = "Does old things";
+  old->metadata.version = "1.2.3";
+  old->metadata.categories = {"Development", "IDE"};
+  old->metadata.mime_types = {"text/plain"};
+  old->metadata.startup_wm_class = "old-app";
+  old->metadata.icon_path = "/icons/v1-id.png";
+  old->metadata.content_hash = 0x0123456789abcdefull;
+  old->fingerprint = 0x0123456789abcdefull;
+  old->inode = 4242;
+  repo.save(*old);
+  repo.save(make_record("new-id", "/opt/New.AppImage"));
+  appimage_manager::infrastructure::MmapRegistryRepository reread(tmp.string());
+  auto updated = reread.by_path("/opt/Old.AppImage");
+  assert(updated && updated->metadata == old->metadata);
+  assert(updated->added_at == "2020-01-01T12:00:00Z");
+  assert(updated->fingerprint == 0x0123456789abcdefull && updated->inode == 4242u);
+  auto same_content = reread.by_fingerprint(0x0123456789abcdefull);
+  assert(same_content.size() == 1u && same_content[0].id == "v1-id");
+  assert(reread.by_fingerprint(1).empty());
+  auto fresh = reread.by_id("new-id");
+  assert(fresh && fresh->metadata == appimage_manager::domain::AppImageMetadata{});
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_mmap_registry_keeps_staged_changes_when_write_fails() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-mmap-write-fail";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  fs::path blocker = tmp / "blocker";
+  std::ofstream(blocker) << "not a directory";
+  std::string config_dir = (blocker / "config").string();
+  appimage_manager::infrastructure::MmapRegistryRepository repo(config_dir);
+  repo.save(make_record("a", "/opt/A.AppImage"));
+  repo.save(make_record("b", "/opt/B.AppImage"));
+  repo.save(make_record("c", "/opt/C.AppImage"));
+  repo.remove("a");
+  repo.remove_by_path("/opt/Missing.AppImage");
+  assert(repo.all().size() == 2u);
+  assert(!repo.by_id("a"));
+  auto moved = repo.by_id("c");
+  assert(moved && moved->path == "/opt/C.AppImage");
+  assert(repo.by_path("/opt/B.AppImage")->id == "b");
+  fs::remove(blocker);
+  repo.save(make_record("d", "/opt/D.AppImage"));
+  appimage_manager::infrastructure::MmapRegistryRepository reread(config_dir);
+  assert(reread.all().size() == 3u);
+  assert(reread.by_id("b") && reread.by_id("c") && reread.by_id("d"));
+  assert(!reread.by_id("a"));
+  fs::remove_all(tmp);
+  return 0;
+}
+
+using test_fn = int (*)();
+static const test_fn tests[] = {
+  test_mmap_registry_round_trip,
+  test_mmap_registry_update_and_remove,
+  test_mmap_registry_batch_and_migration,
+  test_mmap_registry_invalid_file_returns_empty,
+  test_mmap_registry_metadata_and_version_1_file,
+  test_mmap_registry_keeps_staged_changes_when_write_fails,
+};
+static constexpr std::size_t num_tests = sizeof(tests) / sizeof(tests[0]);
+
+}
+
+std::size_t mmap_registry_repository_test_count() { return num_tests; }
+
+int run_mmap_registry_repository_test(std::size_t i) {
+  if (i >= num_tests) return EXIT_FAILURE;
+  return tests[i]();
+}
+
+int run_mmap_registry_repository_tests() {
+  for (std::size_t i = 0; i < num_tests; ++i)
+    if (run_mmap_registry_repository_test(i) != 0) return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
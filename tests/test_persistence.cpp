@@ -0,0 +1,136 @@
+#include "tests.hpp"
+#include <infrastructure/persistence/atomic_file.hpp>
+#include <infrastructure/persistence/write_behind_queue.hpp>
+#include <infrastructure/json/json_registry_repository.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int test_write_file_atomically_replaces_content() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-atomic";
+  fs::remove_all(tmp);
+  std::string path = (tmp / "nested" / "file.json").string();
+  [[maybe_unused]] bool first = appimage_manager::infrastructure::write_file_atomically(path, "first");
+  [[maybe_unused]] bool second = appimage_manager::infrastructure::write_file_atomically(path, "second");
+  assert(first && second);
+  auto content = appimage_manager::infrastructure::read_file(path);
+  assert(content && *content == "second");
+  std::size_t entries = 0;
+  for ([[maybe_unused]] const auto& e : fs::directory_iterator(tmp / "nested"))
+    ++entries;
+  assert(entries == 1u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_write_behind_queue_coalesces_until_flush() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-write-behind";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  std::string path = (tmp / "file.json").string();
+  appimage_manager::infrastructure::WriteBehindQueue queue(std::chrono::hours(1));
+  queue.schedule(path, "one");
+  queue.schedule(path, "two");
+  assert(!fs::exists(path));
+  auto pending = queue.pending(path);
+  assert(pending && *pending == "two");
+  queue.flush();
+  assert(!queue.pending(path));
+  auto content = appimage_manager::infrastructure::read_file(path);
+  assert(content && *content == "two");
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_write_behind_queue_flushes_after_window() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-write-behind-window";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  std::string path = (tmp / "file.json").string();
+  appimage_manager::infrastructure::WriteBehindQueue queue(std::chrono::milliseconds(10));
+  queue.schedule(path, "data");
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!fs::exists(path) && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  auto content = appimage_manager::infrastructure::read_file(path);
+  assert(content && *content == "data");
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_registry_reads_pending_writes() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-write-behind-registry";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  {
+    appimage_manager::infrastructure::WriteBehindQueue queue(std::chrono::hours(1));
+    appimage_manager::infrastructure::JsonRegistryRepository repo(tmp.string(), &queue);
+    appimage_manager::domain::AppImageRecord r;
+    r.id = "id1";
+    r.path = "/opt/App.AppImage";
+    r.name = "App";
+    repo.save(r);
+    appimage_manager::infrastructure::JsonRegistryRepository other(tmp.string(), &queue);
+    assert(other.by_id("id1"));
+    assert(!fs::exists(tmp / "registry.json"));
+  }
+  appimage_manager::infrastructure::JsonRegistryRepository reread(tmp.string());
+  assert(reread.by_id("id1"));
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_write_behind_queue_keeps_failed_writes_pending() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-write-behind-failure";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  fs::path blocker = tmp / "blocker";
+  appimage_manager::infrastructure::write_file_atomically(blocker.string(), "not a directory");
+  std::string path = (blocker / "file.json").string();
+  appimage_manager::infrastructure::WriteBehindQueue queue(std::chrono::hours(1));
+  queue.schedule(path, "data");
+  queue.flush();
+  assert(queue.has_pending(path));
+  auto pending = queue.pending(path);
+  assert(pending && *pending == "data");
+  fs::remove(blocker);
+  queue.flush();
+  assert(!queue.has_pending(path));
+  auto content = appimage_manager::infrastructure::read_file(path);
+  assert(content && *content == "data");
+  fs::remove_all(tmp);
+  return 0;
+}
+
+using test_fn = int (*)();
+static const test_fn tests[] = {
+  test_write_file_atomically_replaces_content,
+  test_write_behind_queue_coalesces_until_flush,
+  test_write_behind_queue_flushes_after_window,
+  test_registry_reads_pending_writes,
+  test_write_behind_queue_keeps_failed_writes_pending,
+};
+static constexpr std::size_t num_tests = sizeof(tests) / sizeof(tests[0]);
+
+}
+
+std::size_t persistence_test_count() { return num_tests; }
+
+int run_persistence_test(std::size_t i) {
+  if (i >= num_tests) return EXIT_FAILURE;
+  return tests[i]();
+}
+
+int run_persistence_tests() {
+  for (std::size_t i = 0; i < num_tests; ++i)
+    if (run_persistence_test(i) != 0) return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -6,6 +6,7 @@
 #include <cstddef>
 #include <filesystem>
 #include <fstream>
+#include <string>
 
 namespace fs = std::filesystem;
 
@@ -109,6 +110,195 @@ int test_registry_invalid_json_returns_empty() {
   return 0;
 }
 
+int test_registry_reloads_after_external_change() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-registry-external";
+  fs::create_directories(tmp);
+  appimage_manager::infrastructure::JsonRegistryRepository repo(tmp.string());
+  appimage_manager::domain::AppImageRecord r;
+  r.id = "id1";
+  r.path = "/opt/App.AppImage";
+  r.name = "App";
+  repo.save(r);
+  assert(repo.by_id("id1"));
+  {
+    appimage_manager::infrastructure::JsonRegistryRepository other(tmp.string());
+    appimage_manager::domain::AppImageRecord r2;
+    r2.id = "id2";
+    r2.path = "/opt/Other.AppImage";
+    r2.name = "Other";
+    other.save(r2);
+  }
+  auto by_p = repo.by_path("/opt/Other.AppImage");
+  assert(by_p && by_p->id == "id2");
+  assert(repo.all().size() == 2u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_registry_batch_writes_once_on_commit() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-registry-batch";
+  fs::create_directories(tmp);
+  appimage_manager::infrastructure::JsonRegistryRepository repo(tmp.string());
+  {
+    appimage_manager::domain::RegistryBatch batch(repo);
+    for (int i = 0; i < 3; ++i) {
+      appimage_manager::domain::AppImageRecord r;
+      r.id = "id" + std::to_string(i);
+      r.path = "/opt/App" + std::to_string(i) + ".AppImage";
+      r.name = "App";
+      repo.save(r);
+    }
+    repo.remove("id1");
+    assert(!fs::exists(tmp / "registry.json"));
+    assert(repo.all().size() == 2u);
+    assert(repo.by_id("id2"));
+  }
+  assert(fs::is_regular_file(tmp / "registry.json"));
+  appimage_manager::infrastructure::JsonRegistryRepository reread(tmp.string());
+  auto all = reread.all();
+  assert(all.size() == 2u);
+  assert(all[0].id == "id0" && all[1].id == "id2");
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_registry_metadata_round_trip() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-registry-metadata";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  appimage_manager::domain::AppImageRecord r;
+  r.id = "meta-id";
+  r.path = "/opt/Meta.AppImage";
+  r.name = "Meta";
+  r.metadata.name = "Meta Editor";
+  r.metadata.summary = "Edits metadata";
+  r.metadata.version = "2.0";
+  r.metadata.appstream_id = "org.example.Meta";
+  r.metadata.startup_wm_class = "meta";
+  r.metadata.categories = {"Utility", "TextEditor"};
+  r.metadata.mime_types = {"text/plain", "text/markdown"};
+  r.metadata.icon_path = "/icons/meta-id.svg";
+  r.metadata.content_hash = 0xfedcba9876543210ull;
+  r.fingerprint = 0xfedcba9876543210ull;
+  r.inode = 77;
+  {
+    appimage_manager::infrastructure::JsonRegistryRepository repo(tmp.string());
+    repo.save(r);
+    appimage_manager::domain::AppImageRecord plain;
+    plain.id = "plain-id";
+    plain.path = "/opt/Plain.AppImage";
+    plain.name = "Plain";
+    repo.save(plain);
+  }
+  appimage_manager::infrastructure::JsonRegistryRepository reread(tmp.string());
+  auto loaded = reread.by_id("meta-id");
+  assert(loaded && loaded->metadata == r.metadata);
+  assert(loaded->fingerprint == r.fingerprint && loaded->inode == 77u);
+  auto plain = reread.by_id("plain-id");
+  assert(plain && plain->metadata == appimage_manager::domain::AppImageMetadata{});
+  assert(plain->fingerprint == 0u && plain->inode == 0u);
+  auto same_content = reread.by_fingerprint(0xfedcba9876543210ull);
+  assert(same_content.size() == 1u && same_content[0].id == "meta-id");
+  std::ifstream f(tmp / "registry.json");
+  std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  assert(content.find("\"metadata\"") == content.rfind("\"metadata\""));
+  assert(content.find("\"fingerprint\"") == content.rfind("\"fingerprint\""));
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_registry_in_directory() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-registry-in-directory";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  {
+    appimage_manager::infrastructure::JsonRegistryRepository repo(tmp.string());
+    for (const char* path : {"/opt/B.AppImage", "/opt/sub/C.AppImage", "/opt/A.AppImage", "/optional/D.AppImage"}) {
+      appimage_manager::domain::AppImageRecord r;
+      r.id = path;
+      r.path = path;
+      r.name = fs::path(path).stem().string();
+      repo.save(r);
+    }
+  }
+  appimage_manager::infrastructure::JsonRegistryRepository repo(tmp.string());
+  auto in_opt = repo.in_directory("/opt");
+  assert(in_opt.size() == 2u);
+  assert((in_opt[0].path == "/opt/A.AppImage") != (in_opt[1].path == "/opt/A.AppImage"));
+  assert(repo.in_directory("/opt/").size() == 2u);
+  auto in_sub = repo.in_directory("/opt/sub");
+  assert(in_sub.size() == 1u && in_sub[0].path == "/opt/sub/C.AppImage");
+  assert(repo.in_directory("/op").empty() && repo.in_directory("/").empty());
+  repo.remove_by_path("/opt/B.AppImage");
+  assert(repo.in_directory("/opt").size() == 1u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_registry_indexes_follow_mutations() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-registry-indexes";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  appimage_manager::infrastructure::JsonRegistryRepository repo(tmp.string());
+  {
+    appimage_manager::domain::RegistryBatch batch(repo);
+    for (int i = 0; i < 6; ++i) {
+      appimage_manager::domain::AppImageRecord r;
+      r.id = "id" + std::to_string(i);
+      r.path = std::string(i % 2 ? "/a/" : "/b/") + "App" + std::to_string(i) + ".AppImage";
+      r.fingerprint = 100 + i % 3;
+      repo.save(r);
+    }
+  }
+  repo.remove("id0");
+  repo.remove_by_path("/a/App3.AppImage");
+  auto moved = *repo.by_id("id5");
+  moved.path = "/b/App5.AppImage";
+  moved.fingerprint = 0;
+  repo.save(moved);
+  auto retagged = *repo.by_id("id2");
+  retagged.id = "id2b";
+  repo.save(retagged);
+  assert(repo.all().size() == 5u);
+  assert(!repo.by_id("id0") && !repo.by_path("/b/App0.AppImage") && !repo.by_path("/a/App3.AppImage"));
+  assert(!repo.by_id("id2") && repo.by_id("id2b")->path == "/b/App2.AppImage");
+  assert(repo.by_path("/a/App5.AppImage")->id == "id5" && repo.by_path("/b/App5.AppImage")->id == "id5");
+  assert(repo.in_directory("/a").size() == 2u && repo.in_directory("/b").size() == 3u);
+  auto everything = repo.all();
+  auto page = repo.page(1, 2);
+  assert(page.size() == 2u && page[0].path == everything[1].path && page[1].path == everything[2].path);
+  assert(repo.page(4, 0).size() == 1u && repo.page(9, 3).empty());
+  assert(repo.by_fingerprint(100).size() == 0u && repo.by_fingerprint(101).size() == 2u && repo.by_fingerprint(102).size() == 2u);
+  for (const auto& r : repo.all())
+    assert(repo.by_path(r.path)->id == r.id && repo.by_id(r.id));
+  appimage_manager::infrastructure::JsonRegistryRepository reread(tmp.string());
+  assert(reread.all().size() == 5u && reread.by_id("id2b"));
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_registry_remove_keeps_page_order() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-registry-order";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  appimage_manager::infrastructure::JsonRegistryRepository repo(tmp.string());
+  for (int i = 0; i < 5; ++i) {
+    appimage_manager::domain::AppImageRecord r;
+    r.id = "id" + std::to_string(i);
+    r.path = "/opt/App" + std::to_string(i) + ".AppImage";
+    repo.save(r);
+  }
+  auto first = repo.page(0, 2);
+  repo.remove("id1");
+  auto rest = repo.page(1, 0);
+  assert(first.size() == 2u && first[0].id == "id0" && first[1].id == "id1");
+  assert(rest.size() == 3u && rest[0].id == "id2" && rest[1].id == "id3" && rest[2].id == "id4");
+  for (const auto& r : repo.all())
+    assert(repo.by_id(r.id)->path == r.path && repo.by_path(r.path)->id == r.id);
+  fs::remove_all(tmp);
+  return 0;
+}
+
 using test_fn = int (*)();
 static const test_fn tests[] = {
   test_registry_round_trip,
@@ -117,6 +307,12 @@ static const test_fn tests[] = {
   test_registry_remove_by_id,
   test_registry_empty_dir_returns_empty,
   test_registry_invalid_json_returns_empty,
+  test_registry_reloads_after_external_change,
+  test_registry_batch_writes_once_on_commit,
+  test_registry_metadata_round_trip,
+  test_registry_in_directory,
+  test_registry_indexes_follow_mutations,
+  test_registry_remove_keeps_page_order,
 };
 static constexpr std::size_t num_tests = sizeof(tests) / sizeof(tests[0]);
 
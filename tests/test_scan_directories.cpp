@@ -1,17 +1,54 @@
 #include "tests.hpp"
 #include <domain/entities/config.hpp>
 #include <application/scan_directories.hpp>
+#include <application/reconcile_directory.hpp>
+#include <application/directory_reader.hpp>
+#include <application/scan_pipeline.hpp>
 #include <infrastructure/json/json_registry_repository.hpp>
+#include <infrastructure/json/json_directory_snapshot_repository.hpp>
+#include <infrastructure/json/json_appimage_probe_cache.hpp>
+#include <chrono>
 #include <cassert>
 #include <cstdlib>
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
 
 namespace fs = std::filesystem;
 
 namespace {
 
+void put(std::string& out, std::size_t pos, std::uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i)
+    out[pos + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+std::string fake_appimage(std::uint64_t bytes_used) {
+  std::string content(4096, '\0');
+  content.replace(0, 4, "\x7f" "ELF");
+  content[4] = 2;
+  content[5] = 1;
+  put(content, 0x20, 64, 8);
+  put(content, 0x36, 56, 2);
+  put(content, 0x38, 1, 2);
+  put(content, 64, 1, 4);
+  put(content, 64 + 32, 4096, 8);
+  std::string sb(96, '\0');
+  sb.replace(0, 4, "hsqs");
+  put(sb, 12, 131072, 4);
+  put(sb, 20, 1, 2);
+  put(sb, 22, 17, 2);
+  put(sb, 28, 4, 2);
+  put(sb, 40, bytes_used, 8);
+  content += sb;
+  content.resize(4096 + bytes_used, '\0');
+  return content;
+}
+
 int test_scan_directories_finds_appimage_and_saves_to_registry() {
   fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-scan";
   fs::create_directories(tmp);
@@ -94,12 +131,412 @@ int test_scan_directories_skips_self_path() {
   return 0;
 }
 
+int test_scan_directories_execute_file_adds_single_file() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-scan-file";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  std::string app_path = (tmp / "Single.AppImage").string();
+  std::ofstream(app_path).put('x');
+  std::ofstream(tmp / "Other.AppImage").put('x');
+  appimage_manager::infrastructure::JsonRegistryRepository registry(tmp.string());
+  appimage_manager::application::ScanDirectories scan(registry);
+  int added = 0;
+  int ensured = 0;
+  auto on_added = [&added](const appimage_manager::domain::AppImageRecord&) { ++added; };
+  auto on_ensure = [&ensured](const appimage_manager::domain::AppImageRecord&) { ++ensured; };
+  auto record = scan.execute_file(app_path, on_added, "", on_ensure);
+  assert(record && record->path == app_path && record->name == "Single");
+  assert(added == 1 && ensured == 0);
+  assert(registry.all().size() == 1u);
+  auto again = scan.execute_file(app_path, on_added, "", on_ensure);
+  assert(again && again->id == record->id);
+  assert(added == 1 && ensured == 1);
+  auto partial = scan.execute_file((tmp / "Single.AppImage.part").string(), on_added);
+  auto missing = scan.execute_file((tmp / "missing.AppImage").string(), on_added);
+  auto self = scan.execute_file(app_path, on_added, app_path);
+  assert(!partial && !missing && !self);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_scan_directories_recursive_respects_depth_and_exclude() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-scan-recursive";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "a" / "b" / "c");
+  fs::create_directories(tmp / "skip");
+  std::ofstream((tmp / "top.AppImage").string()).put('x');
+  std::ofstream((tmp / "a" / "one.AppImage").string()).put('x');
+  std::ofstream((tmp / "a" / "b" / "two.AppImage").string()).put('x');
+  std::ofstream((tmp / "a" / "b" / "c" / "three.AppImage").string()).put('x');
+  std::ofstream((tmp / "skip" / "hidden.AppImage").string()).put('x');
+  std::ofstream((tmp / "a" / "old.AppImage").string()).put('x');
+  fs::create_directory_symlink(tmp, tmp / "a" / "loop");
+  appimage_manager::infrastructure::JsonRegistryRepository registry(tmp.string());
+  appimage_manager::application::ScanDirectories scan(registry);
+  appimage_manager::domain::Config config;
+  config.watch_directories.push_back(tmp.string());
+  auto top_level = scan.execute(config, nullptr);
+  assert(top_level.size() == 1u);
+  config.recursive = true;
+  config.max_depth = 2;
+  config.exclude = {"skip", "*/a/old.*"};
+  auto records = scan.execute(config, nullptr);
+  assert(records.size() == 3u);
+  assert(registry.by_path((tmp / "a" / "b" / "two.AppImage").string()));
+  assert(!registry.by_path((tmp / "a" / "b" / "c" / "three.AppImage").string()));
+  assert(!registry.by_path((tmp / "skip" / "hidden.AppImage").string()));
+  assert(!registry.by_path((tmp / "a" / "old.AppImage").string()));
+  config.max_depth = 0;
+  auto unlimited = scan.execute(config, nullptr);
+  assert(unlimited.size() == 4u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_scan_directories_skips_unchanged_directory_with_snapshot() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-scan-snapshot";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "apps");
+  fs::create_directories(tmp / "cache");
+  fs::path apps = tmp / "apps";
+  std::ofstream((apps / "Known.AppImage").string()).put('x');
+  auto old_time = fs::last_write_time(apps) - std::chrono::hours(1);
+  fs::last_write_time(apps, old_time);
+  appimage_manager::infrastructure::JsonRegistryRepository registry(tmp.string());
+  appimage_manager::application::ScanDirectories scan(registry);
+  appimage_manager::domain::Config config;
+  config.watch_directories.push_back(apps.string());
+  {
+    appimage_manager::infrastructure::JsonDirectorySnapshotRepository snapshots((tmp / "cache").string());
+    scan.set_snapshot_repository(&snapshots);
+    auto first = scan.execute(config, nullptr);
+    assert(first.size() == 1u);
+    auto snapshot = snapshots.load(apps.string());
+    assert(snapshot && snapshot->entries.size() == 1u && snapshot->entries.count("Known.AppImage"));
+  }
+  appimage_manager::infrastructure::JsonDirectorySnapshotRepository snapshots((tmp / "cache").string());
+  scan.set_snapshot_repository(&snapshots);
+  std::ofstream((apps / "Unseen.AppImage").string()).put('x');
+  fs::last_write_time(apps, old_time);
+  registry.remove_by_path((apps / "Known.AppImage").string());
+  int added = 0;
+  auto records = scan.execute(config, [&added](const appimage_manager::domain::AppImageRecord&) { ++added; });
+  assert(records.size() == 1u && added == 1);
+  assert(!registry.by_path((apps / "Unseen.AppImage").string()));
+  fs::last_write_time(apps, fs::file_time_type::clock::now());
+  auto rescanned = scan.execute(config, nullptr);
+  assert(rescanned.size() == 2u);
+  assert(snapshots.load(apps.string())->entries.size() == 2u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_scan_directories_merges_roots_in_config_order() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-scan-roots";
+  fs::remove_all(tmp);
+  std::vector<std::string> expected;
+  appimage_manager::domain::Config config;
+  for (const char* root : {"second", "first", "third"}) {
+    fs::create_directories(tmp / root);
+    config.watch_directories.push_back((tmp / root).string());
+    for (const char* name : {"b.AppImage", "a.AppImage"})
+      std::ofstream((tmp / root / name).string()).put('x');
+    expected.push_back((tmp / root / "a.AppImage").string());
+    expected.push_back((tmp / root / "b.AppImage").string());
+  }
+  config.watch_directories.push_back((tmp / "missing").string());
+  appimage_manager::infrastructure::JsonRegistryRepository registry(tmp.string());
+  appimage_manager::application::ScanDirectories scan(registry);
+  std::vector<std::string> added;
+  auto records = scan.execute(config, [&added](const appimage_manager::domain::AppImageRecord& r) { added.push_back(r.path); });
+  assert(records.size() == expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i)
+    assert(records[i].path == expected[i]);
+  assert(added == expected);
+  assert(registry.all().size() == expected.size());
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_scan_directories_keeps_identity_across_moves() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-scan-moves";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "a");
+  fs::create_directories(tmp / "b");
+  std::string original = (tmp / "a" / "Tool.AppImage").string();
+  std::ofstream(original, std::ios::binary) << fake_appimage(4096);
+  appimage_manager::domain::Config config;
+  config.watch_directories = {(tmp / "a").string(), (tmp / "b").string()};
+  appimage_manager::infrastructure::JsonRegistryRepository registry(tmp.string());
+  appimage_manager::application::ScanDirectories scan(registry);
+  std::vector<std::string> added;
+  std::vector<std::pair<std::string, std::string>> moved;
+  auto on_added = [&added](const appimage_manager::domain::AppImageRecord& r) { added.push_back(r.path); };
+  scan.set_on_moved([&moved](const appimage_manager::domain::AppImageRecord& r,
+                             const appimage_manager::domain::AppImageRecord& previous) {
+    moved.emplace_back(previous.path, r.path);
+  });
+  auto records = scan.execute(config, on_added);
+  assert(records.size() == 1u && added.size() == 1u);
+  auto first = *registry.by_path(original);
+  assert(first.fingerprint != 0u && first.inode != 0u && first.id.size() == 16u);
+  first.metadata.name = "Tool Pro";
+  registry.save(first);
+
+  std::string renamed = (tmp / "b" / "Renamed.AppImage").string();
+  fs::rename(original, renamed);
+  records = scan.execute(config, on_added);
+  assert(records.size() == 1u && added.size() == 1u);
+  assert(moved.size() == 1u && moved[0].first == original && moved[0].second == renamed);
+  assert(!registry.by_path(original));
+  auto relocated = registry.by_path(renamed);
+  assert(relocated && relocated->id == first.id && relocated->metadata.name == "Tool Pro" && relocated->name == "Renamed");
+  assert(!first.added_at.empty() && relocated->added_at == first.added_at);
+
+  std::string copy = (tmp / "a" / "Copy.AppImage").string();
+  fs::copy_file(renamed, copy);
+  records = scan.execute(config, on_added);
+  assert(records.size() == 2u && added.size() == 2u && moved.size() == 1u);
+  auto copied = registry.by_path(copy);
+  assert(copied && copied->fingerprint == first.fingerprint && copied->id != first.id);
+  assert(registry.by_path(renamed)->id == first.id);
+
+  auto custom = *registry.by_path(renamed);
+  custom.name = "My Tool";
+  registry.save(custom);
+  std::string again = (tmp / "b" / "Again.AppImage").string();
+  fs::rename(renamed, again);
+  records = scan.execute(config, on_added);
+  assert(moved.size() == 2u && registry.by_path(again)->id == first.id && registry.by_path(again)->name == "My Tool");
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_reconcile_directory_merges_listing_and_records() {
+  auto record = [](const std::string& path) {
+    appimage_manager::domain::AppImageRecord r;
+    r.id = path;
+    r.path = path;
+    return r;
+  };
+  std::vector<std::pair<std::string, bool>> entries = {
+    {"a.AppImage", true}, {"c.AppImage", false}, {"d.AppImage", false}, {"f.AppImage", true},
+  };
+  auto delta = appimage_manager::application::reconcile_directory("/apps", entries, {
+    record("/apps/g.AppImage"), record("/apps/c.AppImage"), record("/apps/b.AppImage"),
+    record("/apps/a.AppImage"), record("/apps/e.AppImage"),
+  });
+  assert(delta.unchanged.size() == 1u && delta.unchanged[0].path == "/apps/a.AppImage");
+  assert(delta.modified.size() == 1u && delta.modified[0].path == "/apps/c.AppImage");
+  assert((delta.added == std::vector<std::string>{"/apps/d.AppImage", "/apps/f.AppImage"}));
+  assert(delta.removed.size() == 3u);
+  assert(delta.removed[0].path == "/apps/b.AppImage" && delta.removed[1].path == "/apps/e.AppImage" &&
+         delta.removed[2].path == "/apps/g.AppImage");
+  assert(delta.pending() == 4u);
+  auto empty = appimage_manager::application::reconcile_directory("/apps/", {}, {record("/apps/a.AppImage")});
+  assert(empty.pending() == 0u && empty.removed.size() == 1u);
+  return 0;
+}
+
+int test_scan_directories_removes_stale_records() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-scan-stale";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "apps");
+  for (const char* name : {"Keep.AppImage", "Gone.AppImage"})
+    std::ofstream((tmp / "apps" / name).string()).put('x');
+  appimage_manager::domain::Config config;
+  config.watch_directories.push_back((tmp / "apps").string());
+  config.watch_directories.push_back((tmp / "unmounted").string());
+  appimage_manager::infrastructure::JsonRegistryRepository registry(tmp.string());
+  appimage_manager::domain::AppImageRecord offline;
+  offline.id = "offline-id";
+  offline.path = (tmp / "unmounted" / "Offline.AppImage").string();
+  registry.save(offline);
+  appimage_manager::application::ScanDirectories scan(registry);
+  auto initial = scan.execute(config);
+  assert(initial.size() == 2u);
+  fs::remove(tmp / "apps" / "Gone.AppImage");
+  std::vector<std::string> removed;
+  auto records = scan.execute(config, nullptr, "", nullptr,
+    [&removed](const appimage_manager::domain::AppImageRecord& r) { removed.push_back(r.path); });
+  assert(records.size() == 1u && records[0].name == "Keep");
+  assert((removed == std::vector<std::string>{(tmp / "apps" / "Gone.AppImage").string()}));
+  assert(registry.all().size() == 3u);
+  scan.execute(config);
+  assert(registry.all().size() == 2u);
+  assert(registry.by_id("offline-id"));
+
+  appimage_manager::application::ScanDirectories::DirectoryListing unreadable;
+  unreadable.dir = (tmp / "apps").string();
+  unreadable.failed = true;
+  auto delta = scan.reconcile(unreadable);
+  assert(delta.removed.empty() && delta.pending() == 0u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_directory_reader_lists_and_stats_in_batches() {
+  using appimage_manager::application::EntryType;
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-directory-reader";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "sub.AppImage");
+  std::vector<std::string> names;
+  for (int i = 0; i < 300; ++i) {
+    names.push_back("App" + std::to_string(i) + ".AppImage");
+    std::ofstream((tmp / names.back()).string()) << std::string(static_cast<std::size_t>(i), 'x');
+  }
+  fs::create_symlink(tmp / "App7.AppImage", tmp / "Link.AppImage");
+  fs::create_symlink(tmp / "missing", tmp / "Dangling.AppImage");
+
+  appimage_manager::application::DirectoryReader reader(tmp.string());
+  assert(reader.is_open());
+  auto listed = reader.entries();
+  assert(listed);
+  auto& entries = *listed;
+  assert(entries.size() == names.size() + 3u);
+  for (const auto& entry : entries) {
+    assert(entry.name != "." && entry.name != ".." && entry.inode != 0u);
+    if (entry.name == "sub.AppImage")
+      assert(entry.type == EntryType::Directory || entry.type == EntryType::Unknown);
+    else if (entry.name == "Link.AppImage" || entry.name == "Dangling.AppImage")
+      assert(entry.type == EntryType::Symlink || entry.type == EntryType::Unknown);
+    else
+      assert(entry.type == EntryType::Regular || entry.type == EntryType::Unknown);
+  }
+
+  names.push_back("Link.AppImage");
+  names.push_back("Dangling.AppImage");
+  names.push_back("sub.AppImage");
+  names.push_back("Gone.AppImage");
+  auto stats = reader.stat(names);
+  assert(stats.size() == names.size());
+  for (int i = 0; i < 300; ++i)
+    assert(stats[i] && stats[i]->regular && stats[i]->size == i && stats[i]->mtime_ns > 0);
+  assert(stats[300] && stats[300]->regular && stats[300]->size == 7 && stats[300]->inode == stats[7]->inode);
+  assert(!stats[301]);
+  assert(stats[302] && !stats[302]->regular);
+  assert(!stats[303]);
+  auto single = reader.stat({"App3.AppImage"});
+  assert(single.size() == 1u && single[0] && single[0]->size == 3 && single[0]->inode == stats[3]->inode);
+  assert(!appimage_manager::application::DirectoryReader((tmp / "nope").string()).is_open());
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_bounded_queue_blocks_and_drains_after_close() {
+  appimage_manager::application::BoundedQueue<int> queue(2);
+  [[maybe_unused]] bool first = queue.push(1);
+  [[maybe_unused]] bool second = queue.push(2);
+  assert(first && second);
+  std::thread producer([&queue] {
+    for (int i = 3; i <= 6; ++i) {
+      [[maybe_unused]] bool pushed = queue.push(i);
+      assert(pushed);
+    }
+    queue.close();
+  });
+  std::vector<int> popped;
+  while (auto value = queue.pop())
+    popped.push_back(*value);
+  producer.join();
+  assert((popped == std::vector<int>{1, 2, 3, 4, 5, 6}));
+  [[maybe_unused]] auto leftover = queue.try_pop();
+  [[maybe_unused]] bool reopened = queue.push(7);
+  assert(queue.drained() && !leftover && !reopened);
+  return 0;
+}
+
+int test_scan_pipeline_streams_classified_listings() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-scan-pipeline";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "one" / "a");
+  fs::create_directories(tmp / "one" / "b");
+  fs::create_directories(tmp / "two");
+  std::ofstream((tmp / "one" / "Tool.AppImage").string(), std::ios::binary) << fake_appimage(4096);
+  std::ofstream((tmp / "one" / "a" / "Other.AppImage").string(), std::ios::binary) << fake_appimage(8192);
+  std::ofstream((tmp / "two" / "Junk.AppImage").string()).put('x');
+  appimage_manager::domain::Config config;
+  config.watch_directories = {(tmp / "one").string(), (tmp / "two").string(), (tmp / "missing").string()};
+  config.recursive = true;
+  appimage_manager::infrastructure::JsonRegistryRepository registry(tmp.string());
+  appimage_manager::application::ScanDirectories scan(registry);
+  { appimage_manager::application::ScanPipeline abandoned(scan, config, nullptr, 1); }
+
+  int ready = 0;
+  std::vector<std::string> dirs;
+  std::vector<appimage_manager::domain::AppImageRecord> records;
+  {
+    appimage_manager::application::ScanPipeline pipeline(scan, config, [&ready] { ++ready; }, 1);
+    while (auto listing = pipeline.next()) {
+      dirs.push_back(listing->dir);
+      for ([[maybe_unused]] const auto& [path, fingerprint] : listing->fingerprints)
+        assert(fingerprint.inode != 0u && (fingerprint.value != 0u) == (path.find("Junk") == std::string::npos));
+      auto delta = scan.reconcile(*listing);
+      assert(delta.fingerprints.size() == listing->entries.size());
+      scan.apply_delta(delta, records);
+    }
+    auto extra = pipeline.try_next();
+    assert(pipeline.finished() && !extra);
+  }
+  assert(ready == 5);
+  assert((dirs == std::vector<std::string>{(tmp / "one").string(), (tmp / "one" / "a").string(), (tmp / "one" / "b").string(),
+                                           (tmp / "two").string()}));
+  assert(records.size() == 3u);
+  auto tool = registry.by_path((tmp / "one" / "Tool.AppImage").string());
+  auto other = registry.by_path((tmp / "one" / "a" / "Other.AppImage").string());
+  assert(tool && other && tool->fingerprint != 0u && other->fingerprint != 0u && tool->fingerprint != other->fingerprint);
+  assert(registry.by_path((tmp / "two" / "Junk.AppImage").string())->fingerprint == 0u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_scan_directories_fingerprints_through_probe_cache() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-scan-probe-cache";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp / "apps");
+  std::ofstream((tmp / "apps" / "Tool.AppImage").string(), std::ios::binary) << fake_appimage(4096);
+  std::ofstream((tmp / "apps" / "Other.AppImage").string(), std::ios::binary) << fake_appimage(8192);
+  int probes = 0;
+  appimage_manager::infrastructure::JsonAppImageProbeCache cache((tmp / "cache").string(), [&probes](const std::string& path) {
+    ++probes;
+    return appimage_manager::application::probe_appimage(path);
+  });
+  appimage_manager::domain::Config config;
+  config.watch_directories = {(tmp / "apps").string()};
+  appimage_manager::infrastructure::JsonRegistryRepository registry(tmp.string());
+  appimage_manager::application::ScanDirectories scan(registry);
+  scan.set_probe_cache(&cache);
+  [[maybe_unused]] auto found = scan.execute(config);
+  assert(found.size() == 2u && probes == 2);
+  [[maybe_unused]] auto cached = cache.probe((tmp / "apps" / "Tool.AppImage").string());
+  assert(cached && probes == 2 && cached->content_hash == registry.by_path((tmp / "apps" / "Tool.AppImage").string())->fingerprint);
+  fs::remove(tmp / "apps" / "Tool.AppImage");
+  [[maybe_unused]] auto rescanned = scan.execute(config);
+  assert(rescanned.size() == 1u && registry.all().size() == 1u);
+  std::ifstream in(tmp / "cache" / "probe-cache.json");
+  std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  assert(json.find("Other.AppImage") != std::string::npos && json.find("Tool.AppImage") == std::string::npos);
+  fs::remove_all(tmp);
+  return 0;
+}
+
 using test_fn = int (*)();
 static const test_fn tests[] = {
   test_scan_directories_finds_appimage_and_saves_to_registry,
   test_scan_directories_ignores_part_and_crdownload,
   test_scan_directories_sets_executable_on_new_file,
   test_scan_directories_skips_self_path,
+  test_scan_directories_execute_file_adds_single_file,
+  test_scan_directories_recursive_respects_depth_and_exclude,
+  test_scan_directories_skips_unchanged_directory_with_snapshot,
+  test_scan_directories_merges_roots_in_config_order,
+  test_scan_directories_keeps_identity_across_moves,
+  test_reconcile_directory_merges_listing_and_records,
+  test_scan_directories_removes_stale_records,
+  test_directory_reader_lists_and_stats_in_batches,
+  test_bounded_queue_blocks_and_drains_after_close,
+  test_scan_pipeline_streams_classified_listings,
+  test_scan_directories_fingerprints_through_probe_cache,
 };
 static constexpr std::size_t num_tests = sizeof(tests) / sizeof(tests[0]);
 
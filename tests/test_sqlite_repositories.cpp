@@ -0,0 +1,177 @@
+#include "tests.hpp"
+#include <domain/entities/app_image_record.hpp>
+#include <domain/entities/config.hpp>
+#include <domain/entities/launch_settings.hpp>
+#include <infrastructure/json/json_config_repository.hpp>
+#include <infrastructure/json/json_launch_settings_repository.hpp>
+#include <infrastructure/json/json_registry_repository.hpp>
+#include <infrastructure/sqlite/sqlite_database.hpp>
+#include <infrastructure/sqlite/sqlite_config_repository.hpp>
+#include <infrastructure/sqlite/sqlite_launch_settings_repository.hpp>
+#include <infrastructure/sqlite/sqlite_registry_repository.hpp>
+#include <cassert>
+#include <cstdlib>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int test_sqlite_registry_round_trip() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-sqlite-registry";
+  fs::remove_all(tmp);
+  appimage_manager::infrastructure::SqliteDatabase db((tmp / "appimage-manager.db").string());
+  assert(db.is_open());
+  appimage_manager::infrastructure::SqliteRegistryRepository repo(db);
+  appimage_manager::domain::AppImageRecord r;
+  r.id = "id1";
+  r.path = "/opt/App.AppImage";
+  r.name = "App";
+  r.install_type = appimage_manager::domain::InstallType::Direct;
+  r.added_at = "2020-01-01T12:00:00Z";
+  repo.save(r);
+  r.name = "Renamed";
+  r.added_at.clear();
+  r.metadata.name = "App Pro";
+  r.metadata.version = "3.1";
+  r.metadata.categories = {"Graphics"};
+  r.metadata.content_hash = 42;
+  r.fingerprint = 0x8000000000000001ull;
+  r.inode = 1234;
+  repo.save(r);
+  auto all = repo.all();
+  assert(all.size() == 1u);
+  assert(all[0].name == "Renamed" && all[0].added_at == "2020-01-01T12:00:00Z");
+  assert(all[0].install_type == appimage_manager::domain::InstallType::Direct);
+  assert(all[0].metadata == r.metadata);
+  assert(all[0].fingerprint == 0x8000000000000001ull && all[0].inode == 1234u);
+  assert(repo.by_fingerprint(0x8000000000000001ull).size() == 1u && repo.by_fingerprint(42).empty());
+  assert(repo.by_id("id1") && repo.by_path("/opt/App.AppImage"));
+  assert(repo.page(0, 5).size() == 1u && repo.page(0, 0).size() == 1u && repo.page(1, 5).empty());
+  {
+    appimage_manager::domain::RegistryBatch batch(repo);
+    appimage_manager::domain::AppImageRecord other;
+    other.id = "id2";
+    other.path = "/opt/Other.AppImage";
+    other.name = "Other";
+    repo.save(other);
+    repo.remove("id1");
+  }
+  {
+    appimage_manager::domain::AppImageRecord nested;
+    nested.id = "id3";
+    nested.path = "/opt/sub/Nested.AppImage";
+    nested.name = "Nested";
+    repo.save(nested);
+    auto in_opt = repo.in_directory("/opt");
+    assert(in_opt.size() == 1u && in_opt[0].id == "id2");
+    auto in_sub = repo.in_directory("/opt/sub/");
+    assert(in_sub.size() == 1u && in_sub[0].id == "id3");
+    assert(repo.in_directory("/op").empty());
+    repo.remove("id3");
+  }
+  assert(!repo.by_id("id1"));
+  auto other = repo.by_path("/opt/Other.AppImage");
+  assert(other && other->id == "id2" && !other->added_at.empty());
+  repo.remove_by_path("/opt/Other.AppImage");
+  assert(repo.all().empty());
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_sqlite_launch_settings_and_config_round_trip() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-sqlite-settings";
+  fs::remove_all(tmp);
+  appimage_manager::infrastructure::SqliteDatabase db((tmp / "appimage-manager.db").string());
+  appimage_manager::infrastructure::SqliteLaunchSettingsRepository settings_repo(db);
+  appimage_manager::domain::LaunchSettings ls;
+  ls.args = "--debug";
+  ls.env = {"A=1", "B=2"};
+  ls.sandbox = appimage_manager::domain::SandboxMechanism::Bwrap;
+  settings_repo.save("app", ls);
+  auto loaded = settings_repo.load("app");
+  assert(loaded && loaded->args == "--debug" && loaded->env == ls.env);
+  assert(loaded->sandbox == appimage_manager::domain::SandboxMechanism::Bwrap);
+  assert(settings_repo.load_all().size() == 1u);
+  settings_repo.remove("app");
+  assert(!settings_repo.load("app"));
+  appimage_manager::infrastructure::SqliteConfigRepository config_repo(db);
+  appimage_manager::domain::Config config;
+  config.watch_directories = {"/tmp", "/home/user/Apps"};
+  config.registry_backend = "sqlite";
+  config.icon_workers = 2;
+  config.quiet_period_ms = 0;
+  config.recursive = true;
+  config.max_depth = 2;
+  config.exclude = {".*"};
+  config_repo.save(config);
+  auto loaded_config = config_repo.load();
+  assert(loaded_config.watch_directories == config.watch_directories);
+  assert(loaded_config.registry_backend == "sqlite");
+  assert(loaded_config.icon_workers == 2);
+  assert(loaded_config.quiet_period_ms == 0);
+  assert(loaded_config.recursive);
+  assert(loaded_config.max_depth == 2);
+  assert(loaded_config.exclude == config.exclude);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+int test_sqlite_migrates_json_storage_once() {
+  fs::path tmp = fs::temp_directory_path() / "appimage-manager-test-sqlite-migrate";
+  fs::remove_all(tmp);
+  fs::create_directories(tmp);
+  {
+    appimage_manager::infrastructure::JsonConfigRepository config(tmp.string());
+    appimage_manager::domain::Config c;
+    c.watch_directories = {"/opt/apps"};
+    config.save(c);
+    appimage_manager::infrastructure::JsonRegistryRepository registry(tmp.string());
+    appimage_manager::domain::AppImageRecord r;
+    r.id = "json-id";
+    r.path = "/opt/apps/Json.AppImage";
+    r.name = "Json";
+    registry.save(r);
+    appimage_manager::infrastructure::JsonLaunchSettingsRepository launch(tmp.string());
+    appimage_manager::domain::LaunchSettings ls;
+    ls.args = "--x";
+    launch.save("json-id", ls);
+  }
+  appimage_manager::infrastructure::SqliteDatabase db((tmp / "appimage-manager.db").string());
+  [[maybe_unused]] bool migrated = appimage_manager::infrastructure::migrate_json_storage(db, tmp.string());
+  [[maybe_unused]] bool migrated_again = appimage_manager::infrastructure::migrate_json_storage(db, tmp.string());
+  assert(migrated && !migrated_again);
+  appimage_manager::infrastructure::SqliteRegistryRepository registry(db);
+  appimage_manager::infrastructure::SqliteLaunchSettingsRepository launch(db);
+  appimage_manager::infrastructure::SqliteConfigRepository config(db);
+  assert(registry.by_id("json-id"));
+  assert(launch.load("json-id") && launch.load("json-id")->args == "--x");
+  assert(config.load().watch_directories.size() == 1u);
+  fs::remove_all(tmp);
+  return 0;
+}
+
+using test_fn = int (*)();
+static const test_fn tests[] = {
+  test_sqlite_registry_round_trip,
+  test_sqlite_launch_settings_and_config_round_trip,
+  test_sqlite_migrates_json_storage_once,
+};
+static constexpr std::size_t num_tests = sizeof(tests) / sizeof(tests[0]);
+
+}
+
+std::size_t sqlite_repositories_test_count() { return num_tests; }
+
+int run_sqlite_repositories_test(std::size_t i) {
+  if (i >= num_tests) return EXIT_FAILURE;
+  return tests[i]();
+}
+
+int run_sqlite_repositories_tests() {
+  for (std::size_t i = 0; i < num_tests; ++i)
+    if (run_sqlite_repositories_test(i) != 0) return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
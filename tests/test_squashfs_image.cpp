@@ -0,0 +1,347 @@
+#include "tests.hpp"
+#include <application/appimage_metadata.hpp>
+#include <application/squashfs_image.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Node {
+  enum class Kind { File, Dir, Symlink };
+  std::string name;
+  Kind kind{Kind::File};
+  std::string content;
+  std::vector<Node> children;
+};
+
+Node file(const std::string& name, const std::string& content) {
+  return Node{name, Node::Kind::File, content, {}};
+}
+
+Node symlink(const std::string& name, const std::string& target) {
+  return Node{name, Node::Kind::Symlink, target, {}};
+}
+
+Node dir(const std::string& name, std::vector<Node> children) {
+  return Node{name, Node::Kind::Dir, {}, std::move(children)};
+}
+
+void put(std::string& out, std::uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i)
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+class SquashfsBuilder {
+public:
+  explicit SquashfsBuilder(bool compress) : compress_(compress) {}
+
+  std::string build(const Node& root) {
+    image_.assign(96, '\0');
+    std::uint16_t root_offset = add(root, 0).first;
+    std::uint64_t inode_table_start = image_.size();
+    append_metadata(inode_table_);
+    std::uint64_t directory_table_start = image_.size();
+    append_metadata(directory_table_);
+    std::uint64_t id_block = image_.size();
+    std::string ids;
+    put(ids, 0, 4);
+    append_metadata(ids);
+    std::uint64_t id_table_start = image_.size();
+    put(image_, id_block, 8);
+    std::string sb;
+    put(sb, 0x73717368, 4);
+    put(sb, next_inode_ - 1, 4);
+    put(sb, 0, 4);
+    put(sb, block_size, 4);
+    put(sb, 0, 4);
+    put(sb, 1, 2);
+    put(sb, 12, 2);
+    put(sb, compress_ ? 0x10 : 0x1B, 2);
+    put(sb, 1, 2);
+    put(sb, 4, 2);
+    put(sb, 0, 2);
+    put(sb, root_offset, 8);
+    put(sb, image_.size(), 8);
+    put(sb, id_table_start, 8);
+    put(sb, ~0ull, 8);
+    put(sb, inode_table_start, 8);
+    put(sb, directory_table_start, 8);
+    put(sb, ~0ull, 8);
+    put(sb, ~0ull, 8);
+    image_.replace(0, sb.size(), sb);
+    return image_;
+  }
+
+private:
+  static constexpr std::uint32_t block_size = 4096;
+
+  bool compress_;
+  std::string image_;
+  std::string inode_table_;
+  std::string directory_table_;
+  std::uint32_t next_inode_{1};
+
+  std::string deflate(const std::string& data) {
+    uLongf size = compressBound(static_cast<uLong>(data.size()));
+    std::string out(size, '\0');
+    compress2(reinterpret_cast<Bytef*>(out.data()), &size,
+              reinterpret_cast<const Bytef*>(data.data()), static_cast<uLong>(data.size()), 9);
+    out.resize(size);
+    return out;
+  }
+
+  void append_metadata(const std::string& data) {
+    std::string packed = compress_ ? deflate(data) : data;
+    if (compress_ && packed.size() < data.size()) {
+      put(image_, packed.size(), 2);
+      image_ += packed;
+    } else {
+      put(image_, data.size() | 0x8000, 2);
+      image_ += data;
+    }
+  }
+
+  void put_header(std::uint16_t type, std::uint32_t number) {
+    put(inode_table_, type, 2);
+    put(inode_table_, type == 1 ? 0755 : 0644, 2);
+    put(inode_table_, 0, 2);
+    put(inode_table_, 0, 2);
+    put(inode_table_, 0, 4);
+    put(inode_table_, number, 4);
+  }
+
+  std::pair<std::uint16_t, std::uint32_t> add(const Node& node, std::uint32_t parent) {
+    std::uint32_t number = next_inode_++;
+    if (node.kind == Node::Kind::File) {
+      std::uint64_t blocks_start = image_.size();
+      std::vector<std::uint32_t> sizes;
+      for (std::size_t pos = 0; pos < node.content.size(); pos += block_size) {
+        std::string chunk = node.content.substr(pos, block_size);
+        std::string packed = compress_ ? deflate(chunk) : chunk;
+        if (compress_ && packed.size() < chunk.size()) {
+          sizes.push_back(static_cast<std::uint32_t>(packed.size()));
+          image_ += packed;
+        } else {
+          sizes.push_back(static_cast<std::uint32_t>(chunk.size()) | (1u << 24));
+          image_ += chunk;
+        }
+      }
+      auto offset = static_cast<std::uint16_t>(inode_table_.size());
+      put_header(2, number);
+      put(inode_table_, blocks_start, 4);
+      put(inode_table_, 0xFFFFFFFFu, 4);
+      put(inode_table_, 0, 4);
+      put(inode_table_, node.content.size(), 4);
+      for (std::uint32_t s : sizes)
+        put(inode_table_, s, 4);
+      return {offset, number};
+    }
+    if (node.kind == Node::Kind::Symlink) {
+      auto offset = static_cast<std::uint16_t>(inode_table_.size());
+      put_header(3, number);
+      put(inode_table_, 1, 4);
+      put(inode_table_, node.content.size(), 4);
+      inode_table_ += node.content;
+      return {offset, number};
+    }
+    std::vector<Node> children = node.children;
+    std::sort(children.begin(), children.end(),
+      [](const Node& a, const Node& b) { return a.name < b.name; });
+    std::vector<std::pair<std::uint16_t, std::uint32_t>> refs;
+    for (const auto& child : children)
+      refs.push_back(add(child, number));
+    std::size_t listing_offset = directory_table_.size();
+    if (!children.empty()) {
+      put(directory_table_, children.size() - 1, 4);
+      put(directory_table_, 0, 4);
+      put(directory_table_, refs.front().second, 4);
+      for (std::size_t i = 0; i < children.size(); ++i) {
+        std::uint16_t type = children[i].kind == Node::Kind::Dir ? 1 : (children[i].kind == Node::Kind::File ? 2 : 3);
+        put(directory_table_, refs[i].first, 2);
+        put(directory_table_, refs[i].second - refs.front().second, 2);
+        put(directory_table_, type, 2);
+        put(directory_table_, children[i].name.size() - 1, 2);
+        directory_table_ += children[i].name;
+      }
+    }
+    std::size_t listing_size = directory_table_.size() - listing_offset;
+    auto offset = static_cast<std::uint16_t>(inode_table_.size());
+    put_header(1, number);
+    put(inode_table_, 0, 4);
+    put(inode_table_, 2, 4);
+    put(inode_table_, listing_size + 3, 2);
+    put(inode_table_, listing_offset, 2);
+    put(inode_table_, parent ? parent : next_inode_, 4);
+    return {offset, number};
+  }
+};
+
+Node sample_tree(const std::string& icon) {
+  return dir("", {
+    symlink(".DirIcon", "usr/share/icons/app.png"),
+    symlink("app.desktop", "/usr/share/applications/app.desktop"),
+    dir("usr", {
+      dir("share", {
+        dir("applications", {file("app.desktop", "[Desktop Entry]\nName=App\nIcon=app\n")}),
+        dir("icons", {file("app.png", icon)}),
+      }),
+    }),
+  });
+}
+
+std::string sample_icon() {
+  std::string icon = "\x89PNG\r\n\x1a\n";
+  for (int i = 0; icon.size() < 10000; ++i)
+    icon.push_back(static_cast<char>('a' + i % 26));
+  return icon;
+}
+
+fs::path write_image(const std::string& name, const std::string& prefix, const std::string& image) {
+  fs::path path = fs::temp_directory_path() / name;
+  std::ofstream(path, std::ios::binary) << prefix << image;
+  return path;
+}
+
+int test_squashfs_reads_files_and_symlinks() {
+  std::string icon = sample_icon();
+  std::string image = SquashfsBuilder(false).build(sample_tree(icon));
+  std::string prefix(100, 'x');
+  fs::path path = write_image("appimage-manager-test-squashfs-plain", prefix, image);
+  appimage_manager::application::SquashfsImage fs_image(path.string(), prefix.size());
+  assert(fs_image.is_open());
+  auto dir_icon = fs_image.read_file(".DirIcon");
+  assert(dir_icon && *dir_icon == icon);
+  assert(fs_image.resolve(".DirIcon") == std::optional<std::string>("usr/share/icons/app.png"));
+  assert(fs_image.resolve("app.desktop") == std::optional<std::string>("usr/share/applications/app.desktop"));
+  auto desktop = fs_image.read_file("app.desktop");
+  assert(desktop && desktop->find("Icon=app") != std::string::npos);
+  auto listing = fs_image.list();
+  assert(std::find(listing.begin(), listing.end(), "usr/share/applications/app.desktop") != listing.end());
+  assert(std::find(listing.begin(), listing.end(), ".DirIcon") != listing.end());
+  assert((fs_image.list("usr/share/applications/") == std::vector<std::string>{"usr/share/applications/app.desktop"}));
+  auto root = fs_image.list("");
+  assert(root.size() == 3u && std::find(root.begin(), root.end(), "usr") != root.end());
+  assert(fs_image.list("usr/share/metainfo").empty());
+  assert(fs_image.list("app.desktop").empty());
+  assert(!fs_image.read_file("usr"));
+  assert(!fs_image.read_file("missing.png"));
+  fs::remove(path);
+  return 0;
+}
+
+int test_squashfs_reads_gzip_image() {
+  std::string icon = sample_icon();
+  std::string image = SquashfsBuilder(true).build(sample_tree(icon));
+  fs::path path = write_image("appimage-manager-test-squashfs-gzip", {}, image);
+  appimage_manager::application::SquashfsImage fs_image(path.string(), 0);
+  assert(fs_image.is_open());
+  auto content = fs_image.read_file("usr/share/icons/app.png");
+  assert(content && *content == icon);
+  auto dir_icon = fs_image.read_file(".DirIcon");
+  assert(dir_icon && *dir_icon == icon);
+  fs::remove(path);
+  return 0;
+}
+
+int test_squashfs_rejects_invalid_image() {
+  std::string image = SquashfsBuilder(false).build(sample_tree(sample_icon()));
+  fs::path garbage = write_image("appimage-manager-test-squashfs-garbage", std::string(200, 'x'), {});
+  assert(!appimage_manager::application::SquashfsImage(garbage.string(), 0).is_open());
+  fs::path shifted = write_image("appimage-manager-test-squashfs-shifted", std::string(16, 'x'), image);
+  assert(!appimage_manager::application::SquashfsImage(shifted.string(), 0).is_open());
+  assert(appimage_manager::application::SquashfsImage(shifted.string(), 16).is_open());
+  fs::path truncated = write_image("appimage-manager-test-squashfs-truncated", {}, image.substr(0, image.size() - 10));
+  assert(!appimage_manager::application::SquashfsImage(truncated.string(), 0).is_open());
+  assert(!appimage_manager::application::SquashfsImage("/nonexistent/image", 0).is_open());
+  fs::remove(garbage);
+  fs::remove(shifted);
+  fs::remove(truncated);
+  return 0;
+}
+
+int test_read_appimage_contents_collects_metadata_and_icon() {
+  std::string icon = "<svg xmlns=\"http://www.w3.org/2000/svg\"/>";
+  std::string desktop =
+    "[Desktop Entry]\n"
+    "Name=Sample App\n"
+    "Name[de]=Beispiel\n"
+    "Comment=Desktop comment\n"
+    "Icon=sample\n"
+    "Categories=Graphics;Viewer;\n"
+    "MimeType=image/png;image/jpeg;\n"
+    "StartupWMClass=sample-app\n"
+    "X-AppImage-Version=1.4.2\n"
+    "[Desktop Action New]\n"
+    "Name=New Window\n";
+  std::string metainfo =
+    "<?xml version=\"1.0\"?>\n"
+    "<component type=\"desktop-application\">\n"
+    "  <id>org.example.Sample</id>\n"
+    "  <name>Sample</name>\n"
+    "  <summary xml:lang=\"de\">Zeigt Bilder</summary>\n"
+    "  <summary>Views images &amp; photos</summary>\n"
+    "  <releases><release version=\"1.5.0\" date=\"2024-01-01\"/></releases>\n"
+    "</component>\n";
+  Node tree = dir("", {
+    symlink("sample.desktop", "usr/share/applications/sample.desktop"),
+    dir("usr", {
+      dir("share", {
+        dir("applications", {file("sample.desktop", desktop)}),
+        dir("metainfo", {file("org.example.Sample.appdata.xml", metainfo)}),
+        dir("icons", {dir("hicolor", {dir("scalable", {dir("apps", {file("sample.svg", icon)})})})}),
+      }),
+    }),
+  });
+  std::string image = SquashfsBuilder(true).build(tree);
+  fs::path path = write_image("appimage-manager-test-squashfs-contents", {}, image);
+  appimage_manager::application::SquashfsImage fs_image(path.string(), 0);
+  auto contents = appimage_manager::application::read_appimage_contents(fs_image, "/opt/Sample.AppImage");
+  assert(contents);
+  const auto& m = contents->metadata;
+  assert(m.name == "Sample App");
+  assert(m.summary == "Views images & photos");
+  assert(m.version == "1.4.2");
+  assert(m.appstream_id == "org.example.Sample");
+  assert(m.startup_wm_class == "sample-app");
+  assert((m.categories == std::vector<std::string>{"Graphics", "Viewer"}));
+  assert((m.mime_types == std::vector<std::string>{"image/png", "image/jpeg"}));
+  assert(contents->icon_entry == "usr/share/icons/hicolor/scalable/apps/sample.svg");
+  assert(contents->icon_data == icon);
+  fs::remove(path);
+  return 0;
+}
+
+using test_fn = int (*)();
+static const test_fn tests[] = {
+  test_squashfs_reads_files_and_symlinks,
+  test_squashfs_reads_gzip_image,
+  test_squashfs_rejects_invalid_image,
+  test_read_appimage_contents_collects_metadata_and_icon,
+};
+static constexpr std::size_t num_tests = sizeof(tests) / sizeof(tests[0]);
+
+}
+
+std::size_t squashfs_image_test_count() { return num_tests; }
+
+int run_squashfs_image_test(std::size_t i) {
+  if (i >= num_tests) return EXIT_FAILURE;
+  return tests[i]();
+}
+
+int run_squashfs_image_tests() {
+  for (std::size_t i = 0; i < num_tests; ++i)
+    if (run_squashfs_image_test(i) != 0) return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
@@ -29,3 +29,23 @@ std::size_t generate_desktop_test_count();
 int run_dbus_getallrecords_tests();
 int run_dbus_getallrecords_test(std::size_t i);
 std::size_t dbus_getallrecords_test_count();
+
+int run_persistence_tests();
+int run_persistence_test(std::size_t i);
+std::size_t persistence_test_count();
+
+int run_mmap_registry_repository_tests();
+int run_mmap_registry_repository_test(std::size_t i);
+std::size_t mmap_registry_repository_test_count();
+
+int run_sqlite_repositories_tests();
+int run_sqlite_repositories_test(std::size_t i);
+std::size_t sqlite_repositories_test_count();
+
+int run_squashfs_image_tests();
+int run_squashfs_image_test(std::size_t i);
+std::size_t squashfs_image_test_count();
+
+int run_extract_icon_tests();
+int run_extract_icon_test(std::size_t i);
+std::size_t extract_icon_test_count();